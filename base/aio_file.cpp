@@ -0,0 +1,196 @@
+#ifndef _WIN32
+
+#include "base/aio_file.h"
+
+// 内核头文件提供 io_uring 定义（IORING_OP_WRITE 需要 5.6 及以上）时，才编译 io_uring 后端，
+// 直接通过系统调用使用，不依赖 liburing
+#if defined(__linux__) && defined(__has_include)
+    #if __has_include(<linux/io_uring.h>)
+        #include <linux/io_uring.h>
+        #include <sys/mman.h>
+        #include <sys/syscall.h>
+        #if defined(IORING_FEAT_RW_CUR_POS) && defined(__NR_io_uring_setup) && \
+            defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+            #define LEARNLOG_HAS_IO_URING
+        #endif
+    #endif
+#endif
+
+using namespace learnlog;
+using namespace base;
+using namespace aio;
+
+namespace {
+
+#ifdef LEARNLOG_HAS_IO_URING
+
+// io_uring 后端，只提交 IORING_OP_WRITE，提交与收集都在写入线程中进行，
+// 提交后立即返回，收集时只读取完成队列，除非 wait 为 true 否则不进入内核
+class uring_backend final : public backend {
+public:
+    // 创建失败（内核不支持 io_uring、被禁用或不支持 IORING_OP_WRITE）时返回 nullptr
+    static std::unique_ptr<backend> create(size_t entries) {
+        std::unique_ptr<uring_backend> ring(new uring_backend());
+        if (!ring->setup_(static_cast<unsigned>(entries))) {
+            return nullptr;
+        }
+        return std::unique_ptr<backend>(ring.release());
+    }
+
+    ~uring_backend() override {
+        if (sqes_ != nullptr) ::munmap(sqes_, sqes_len_);
+        if (cq_ptr_ != nullptr && cq_ptr_ != sq_ptr_) ::munmap(cq_ptr_, cq_len_);
+        if (sq_ptr_ != nullptr) ::munmap(sq_ptr_, sq_len_);
+        if (ring_fd_ != -1) ::close(ring_fd_);
+    }
+
+    bool is_io_uring() const override { return true; }
+
+    // 在途的写入数不超过创建时的 entries，提交队列不会满；
+    // io_uring_enter 失败时，内核尚未取走的提交项从提交队列中撤回，调用方可以立即复用缓冲区，
+    // 已被取走的提交项视为提交成功，之后照常收集完成结果
+    int submit(size_t tag, int fd, const char* data, size_t size, u_long_long offset) override {
+        unsigned tail = *sq_tail_;
+        unsigned idx = tail & sq_mask_;
+        io_uring_sqe* sqe = &sqes_[idx];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = fd;
+        sqe->addr = static_cast<__u64>(reinterpret_cast<uintptr_t>(data));
+        sqe->len = static_cast<__u32>(std::min<size_t>(size, 0x7ffff000));
+        sqe->off = offset;
+        sqe->user_data = static_cast<__u64>(tag);
+        sq_array_[idx] = idx;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+        while (enter_(1, 0, 0) < 0) {
+            if (errno == EINTR) continue;
+            int err = errno;
+            if (__atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) == tail) {
+                __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+                return err;
+            }
+            break;
+        }
+        return 0;
+    }
+
+    // EINTR、EAGAIN、EBUSY 是暂时的错误，继续等待
+    int reap(std::vector<completion>& out, bool wait) override {
+        size_t old_size = out.size();
+        while (true) {
+            unsigned head = *cq_head_;
+            unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head) {
+                const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+                out.push_back(completion{static_cast<size_t>(cqe.user_data), cqe.res});
+            }
+            __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+            if (!wait || out.size() > old_size) {
+                return 0;
+            }
+            if (enter_(0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+                errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                return errno;
+            }
+        }
+    }
+
+private:
+    uring_backend() = default;
+
+    int enter_(unsigned to_submit, unsigned min_complete, unsigned flags) {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete,
+                                          flags, nullptr, 0));
+    }
+
+    bool setup_(unsigned entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ring_fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (ring_fd_ < 0) {
+            ring_fd_ = -1;
+            return false;
+        }
+        if (!supports_write_()) {
+            return false;
+        }
+
+        sq_len_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_len_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            sq_len_ = cq_len_ = std::max(sq_len_, cq_len_);
+        }
+        sq_ptr_ = map_(sq_len_, IORING_OFF_SQ_RING);
+        if (sq_ptr_ == nullptr) return false;
+        cq_ptr_ = single_mmap ? sq_ptr_ : map_(cq_len_, IORING_OFF_CQ_RING);
+        if (cq_ptr_ == nullptr) return false;
+        sqes_len_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(map_(sqes_len_, IORING_OFF_SQES));
+        if (sqes_ == nullptr) return false;
+
+        char* sq = static_cast<char*>(sq_ptr_);
+        char* cq = static_cast<char*>(cq_ptr_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    // 通过 IORING_REGISTER_PROBE 确认内核支持 IORING_OP_WRITE
+    bool supports_write_() {
+        const unsigned op_num = 256;
+        std::vector<char> buf(sizeof(io_uring_probe) + op_num * sizeof(io_uring_probe_op), 0);
+        io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(buf.data());
+        if (::syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_PROBE, probe, op_num) < 0) {
+            return false;
+        }
+        return probe->last_op >= IORING_OP_WRITE &&
+               (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED) != 0;
+    }
+
+    void* map_(size_t len, off_t offset) {
+        void* ptr = ::mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                           ring_fd_, offset);
+        return ptr == MAP_FAILED ? nullptr : ptr;
+    }
+
+    int ring_fd_{-1};
+    void* sq_ptr_{nullptr};
+    size_t sq_len_{0};
+    void* cq_ptr_{nullptr};
+    size_t cq_len_{0};
+    io_uring_sqe* sqes_{nullptr};
+    size_t sqes_len_{0};
+
+    unsigned* sq_head_{nullptr};
+    unsigned* sq_tail_{nullptr};
+    unsigned sq_mask_{0};
+    unsigned* sq_array_{nullptr};
+    unsigned* cq_head_{nullptr};
+    unsigned* cq_tail_{nullptr};
+    unsigned cq_mask_{0};
+    io_uring_cqe* cqes_{nullptr};
+};
+
+#endif  // LEARNLOG_HAS_IO_URING
+
+}   // namespace
+
+std::unique_ptr<backend> aio::make_io_uring(size_t entries) {
+#ifdef LEARNLOG_HAS_IO_URING
+    return uring_backend::create(entries);
+#else
+    (void)entries;
+    return nullptr;
+#endif
+}
+
+#endif  // _WIN32
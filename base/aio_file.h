@@ -0,0 +1,411 @@
+#pragma once
+
+#include "definitions.h"
+#include "base/exception.h"
+#include "base/os.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace learnlog {
+namespace base {
+
+// aio_file 的选项
+struct aio_file_options {
+    size_t buffer_size{1024 * 1024};    // 每个缓冲区的大小
+    size_t buffer_count{4};             // 缓冲区个数，即最多同时在途的写入数
+    bool use_io_uring{true};            // 为 false 时总是使用 pwrite 线程
+};
+
+namespace aio {
+
+// 一次已完成的写入，res 为写入的字节数，失败时为 -errno
+struct completion {
+    size_t tag;
+    long_long res;
+};
+
+// 异步写入的后端：提交在指定偏移处的写入，之后收集完成结果
+class backend {
+public:
+    virtual ~backend() = default;
+    virtual bool is_io_uring() const = 0;
+    // 提交写入，tag 原样返回在 completion 中，成功返回 0，否则返回 errno，
+    // 失败时保证写入没有提交，调用方可以立即复用缓冲区
+    virtual int submit(size_t tag, int fd, const char* data, size_t size, u_long_long offset) = 0;
+    // 收集已完成的写入追加到 out，wait 为 true 时至少等到一个完成，成功返回 0，否则返回 errno
+    virtual int reap(std::vector<completion>& out, bool wait) = 0;
+};
+
+// 写入 [data, data + size) 到 offset 处，部分写入或被信号中断时继续写入剩余部分
+inline long_long pwrite_all(int fd, const char* data, size_t size, u_long_long offset) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t ret = ::pwrite(fd, data + done, size - done, static_cast<off_t>(offset + done));
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            return -errno;
+        }
+        if (ret == 0) return -EIO;
+        done += static_cast<size_t>(ret);
+    }
+    return static_cast<long_long>(done);
+}
+
+// 不支持 io_uring 时使用的后端：专用线程依次调用 pwrite(2)
+class pwrite_thread final : public backend {
+public:
+    explicit pwrite_thread(size_t max_in_flight) {
+        pending_.reserve(max_in_flight);
+        done_.reserve(max_in_flight);
+        worker_ = std::thread([this, max_in_flight]() { worker_loop_(max_in_flight); });
+    }
+
+    // 等待已提交的写入完成后退出线程
+    ~pwrite_thread() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        pending_cv_.notify_one();
+        worker_.join();
+    }
+
+    bool is_io_uring() const override { return false; }
+
+    int submit(size_t tag, int fd, const char* data, size_t size, u_long_long offset) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_.push_back(request{tag, fd, data, size, offset});
+        }
+        pending_cv_.notify_one();
+        return 0;
+    }
+
+    int reap(std::vector<completion>& out, bool wait) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (wait) {
+            done_cv_.wait(lock, [this]() { return !done_.empty(); });
+        }
+        out.insert(out.end(), done_.begin(), done_.end());
+        done_.clear();
+        return 0;
+    }
+
+private:
+    struct request {
+        size_t tag;
+        int fd;
+        const char* data;
+        size_t size;
+        u_long_long offset;
+    };
+
+    void worker_loop_(size_t max_in_flight) {
+        std::vector<request> reqs;
+        std::vector<completion> results;
+        reqs.reserve(max_in_flight);
+        results.reserve(max_in_flight);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            pending_cv_.wait(lock, [this]() { return stop_ || !pending_.empty(); });
+            if (pending_.empty()) {
+                break;
+            }
+            reqs.swap(pending_);
+            lock.unlock();
+
+            for (auto& r : reqs) {
+                results.push_back(completion{r.tag, pwrite_all(r.fd, r.data, r.size, r.offset)});
+            }
+            reqs.clear();
+
+            lock.lock();
+            done_.insert(done_.end(), results.begin(), results.end());
+            results.clear();
+            done_cv_.notify_all();
+        }
+    }
+
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable pending_cv_;
+    std::condition_variable done_cv_;
+    std::vector<request> pending_;
+    std::vector<completion> done_;
+    bool stop_{false};
+};
+
+// 创建 io_uring 后端（见 aio_file.cpp），编译时或运行时不支持 io_uring 时返回 nullptr
+std::unique_ptr<backend> make_io_uring(size_t entries);
+
+}   // namespace aio
+
+// 异步写入的只追加文件，只支持 unix，
+// 持有 buffer_count 个大小为 buffer_size 的缓冲区，写入的数据先追加到当前缓冲区，
+// 缓冲区写满或调用 flush() 时，把它作为一次在确定文件偏移处的写入提交给后端，然后换用下一个空闲缓冲区，
+// 写入线程不等待写入完成，只有全部缓冲区都在途时才等待其中一个完成；
+// 后端优先使用 io_uring（多个写入同时在途），不可用时退回专用的 pwrite 线程；
+// 写入失败的错误在之后的 write() / flush() / drain() 中以异常抛出；
+// 不是线程安全的，由 sink 加锁保护
+class aio_file {
+public:
+    explicit aio_file(const aio_file_options& opts)
+        : capacity_(std::max<size_t>(opts.buffer_size, 1)),
+          use_io_uring_(opts.use_io_uring),
+          bufs_(std::max<size_t>(opts.buffer_count, 1)) {
+        for (auto& b : bufs_) {
+            b.data.reset(new char[capacity_]);
+        }
+        done_.reserve(bufs_.size());
+    }
+
+    // 析构时等待全部写入完成并关闭文件，忽略失败
+    ~aio_file() {
+        if (fd_ != -1) {
+            close_(false);
+        }
+    }
+
+    aio_file(const aio_file&) = delete;
+    aio_file& operator=(const aio_file&) = delete;
+
+    // 打开文件，首先关闭已有文件，打开文件前先创建父级目录，
+    // 文件不以 O_APPEND 打开，写入位置由 aio_file 维护
+    void open(const filename_t& fname, bool truncate = false) {
+        close();
+        fname_ = fname;
+        os::create_dir(os::get_dir(fname_));
+        int flags = O_CREAT | O_WRONLY | O_CLOEXEC;
+        if (truncate) flags |= O_TRUNC;
+        fd_ = ::open(fname_.c_str(), flags, mode_t(0644));
+        if (fd_ == -1) {
+            throw_error_("open");
+        }
+        long_long file_size = os::fd_filesize(fd_);
+        if (file_size == -1) {
+            ::close(fd_);
+            fd_ = -1;
+            throw_error_("open");
+        }
+        offset_ = static_cast<u_long_long>(file_size);
+
+        if (use_io_uring_) {
+            backend_ = aio::make_io_uring(bufs_.size());
+        }
+        if (backend_ == nullptr) {
+            backend_.reset(new aio::pwrite_thread(bufs_.size()));
+        }
+    }
+
+    // 等待全部写入完成后关闭文件
+    void close() {
+        if (fd_ != -1 && !close_(true)) {
+            throw_error_("close");
+        }
+    }
+
+    void write(const char* data, size_t size) {
+        if (fd_ == -1) return;
+
+        while (size > 0) {
+            buffer& b = bufs_[cur_];
+            size_t n = std::min(size, capacity_ - b.size);
+            std::memcpy(b.data.get() + b.size, data, n);
+            b.size += n;
+            data += n;
+            size -= n;
+            if (b.size == capacity_) {
+                submit_current_();
+            }
+        }
+        check_error_("write");
+    }
+
+    // 提交当前缓冲区，不等待写入完成
+    void flush() {
+        if (fd_ == -1) return;
+        submit_current_();
+        check_error_("flush");
+    }
+
+    // 提交当前缓冲区并等待全部写入完成，之后数据位于文件中（页缓存）
+    void drain() {
+        if (fd_ == -1) return;
+        submit_current_();
+        while (in_flight_ > 0) {
+            reap_(true);
+        }
+        check_error_("drain");
+    }
+
+    // 等待全部写入完成并刷新文件系统缓存，保证文件数据被写入磁盘
+    void sync() {
+        drain();
+        if (fd_ != -1 && !os::fsync_fd(fd_)) {
+            throw_error_("sync");
+        }
+    }
+
+    // 文件大小，包括还未写入文件的部分
+    u_long_long size() const { return offset_ + bufs_[cur_].size; }
+    size_t in_flight() const { return in_flight_; }
+    size_t buffer_count() const { return bufs_.size(); }
+    size_t capacity() const { return capacity_; }
+    // 已经提交的写入次数（不包括部分写入后重新提交的剩余部分）
+    size_t submit_calls() const { return submit_calls_; }
+    bool uses_io_uring() const { return backend_ != nullptr && backend_->is_io_uring(); }
+    bool is_open() const { return fd_ != -1; }
+    const filename_t& filename() const { return fname_; }
+
+private:
+    struct buffer {
+        std::unique_ptr<char[]> data;
+        size_t size{0};             // 已追加的长度
+        size_t written{0};          // 在途时已写入文件的长度
+        u_long_long offset{0};      // 在途时的文件偏移
+        bool in_flight{false};
+    };
+
+    // 提交当前缓冲区（不为空时），并换用下一个空闲缓冲区
+    void submit_current_() {
+        buffer& b = bufs_[cur_];
+        if (b.size == 0) {
+            reap_(false);
+            return;
+        }
+        b.offset = offset_;
+        b.written = 0;
+        b.in_flight = true;
+        offset_ += b.size;
+        ++in_flight_;
+        ++submit_calls_;
+        int err = backend_->submit(cur_, fd_, b.data.get(), b.size, b.offset);
+        if (err != 0) {
+            set_error_(err);
+            offset_ -= b.size;
+            release_(b);
+        }
+        cur_ = next_free_();
+    }
+
+    size_t next_free_() {
+        reap_(false);
+        while (true) {
+            for (size_t i = 1; i <= bufs_.size(); ++i) {
+                size_t idx = (cur_ + i) % bufs_.size();
+                if (!bufs_[idx].in_flight) {
+                    return idx;
+                }
+            }
+            reap_(true);
+        }
+    }
+
+    // 收集完成的写入，部分写入时重新提交剩余部分；
+    // 后端出错时无法再等待在途的写入，视为全部失败，见 abandon_in_flight_()
+    void reap_(bool wait) {
+        done_.clear();
+        int err = backend_->reap(done_, wait);
+        if (err != 0) {
+            set_error_(err);
+            abandon_in_flight_();
+            return;
+        }
+
+        for (const auto& c : done_) {
+            buffer& b = bufs_[c.tag];
+            if (c.res <= 0) {
+                set_error_(c.res == 0 ? EIO : static_cast<int>(-c.res));
+                release_(b);
+                continue;
+            }
+            b.written += static_cast<size_t>(c.res);
+            if (b.written == b.size) {
+                release_(b);
+                continue;
+            }
+            err = backend_->submit(c.tag, fd_, b.data.get() + b.written, b.size - b.written,
+                                   b.offset + b.written);
+            if (err != 0) {
+                set_error_(err);
+                release_(b);
+            }
+        }
+    }
+
+    // 在途的缓冲区可能仍被内核读取，不能复用：有意不释放这些缓冲区，换上新的缓冲区，
+    // 并换用 pwrite 线程继续写入
+    void abandon_in_flight_() {
+        for (auto& b : bufs_) {
+            if (!b.in_flight) continue;
+            b.data.release();
+            b.data.reset(new char[capacity_]);
+            release_(b);
+        }
+        backend_.reset(new aio::pwrite_thread(bufs_.size()));
+    }
+
+    void release_(buffer& b) {
+        b.in_flight = false;
+        b.size = 0;
+        --in_flight_;
+    }
+
+    void set_error_(int err) {
+        if (error_ == 0) error_ = err;
+    }
+
+    void check_error_(const char* op) {
+        if (error_ != 0) {
+            errno = error_;
+            error_ = 0;
+            throw_error_(op);
+        }
+    }
+
+    bool close_(bool check) {
+        submit_current_();
+        while (in_flight_ > 0) {
+            reap_(true);
+        }
+        backend_.reset();
+        bool ok = error_ == 0;
+        error_ = 0;
+        ok = (::close(fd_) == 0) && ok;
+        fd_ = -1;
+        return ok || !check;
+    }
+
+    void throw_error_(const char* op) const {
+        source_loc loc{__FILE__, __LINE__, __func__};
+        std::string fname_str(fname_.begin(), fname_.end());
+        std::string err_str = fmt::format("learnlog::aio_file::{}() failed, filename: '{}'",
+                                          op, fname_str);
+        throw_learnlog_excpt(err_str, os::get_errno(), loc);
+    }
+
+    const size_t capacity_;
+    const bool use_io_uring_;
+    std::vector<buffer> bufs_;
+    size_t cur_{0};                 // 正在追加的缓冲区
+    size_t in_flight_{0};
+    u_long_long offset_{0};         // 当前缓冲区在文件中的偏移
+    size_t submit_calls_{0};
+    int error_{0};                  // 尚未抛出的写入错误（errno）
+    std::vector<aio::completion> done_;
+    std::unique_ptr<aio::backend> backend_;
+    int fd_{-1};
+    filename_t fname_;
+};
+
+}   // namespace base
+}   // namespace learnlog
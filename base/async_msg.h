@@ -1,7 +1,7 @@
 #pragma once
 
 #include "base/log_msg_buf.h"
-#include <future>
+#include "base/payload_pool.h"
 
 namespace learnlog {
 
@@ -11,11 +11,18 @@ namespace base {
 
 enum async_msg_type { log, flush, terminate };
 
-class async_msg : public log_msg_buf {
+static const size_t invalid_logger_handle = static_cast<size_t>(-1);
+
+// logger 以线程池分配的句柄表示，logger 析构时等待以该句柄提交的消息处理完后才注销句柄，
+// 超出内联缓冲区的消息内容从线程池的 payload_pool 申请内存，
+// log 消息记录提交时 logger 纪元的奇偶，处理完后线程池据此减少对应的计数，
+// flush 消息携带线程池分配的序号，处理完成后由线程池通知等待该序号的线程
+class async_msg : public basic_log_msg_buf<payload_allocator> {
 public:
-    async_logger_shr_ptr logger;
+    size_t logger_handle{invalid_logger_handle};
     async_msg_type msg_type{async_msg_type::log};
-    std::promise<void> flush_promise;
+    unsigned epoch_parity{0};
+    std::uint64_t flush_ticket{0};
     
     async_msg() = default;
     ~async_msg() = default;
@@ -25,33 +32,32 @@ public:
     async_msg& operator=(async_msg &&) = default;
 
     // log
-    async_msg(async_logger_shr_ptr&& logger_in, 
+    async_msg(size_t logger_handle_in, 
               async_msg_type type_in, 
-              const log_msg& msg_in)
-        : log_msg_buf{msg_in}, 
-        logger(std::move(logger_in)),
-        msg_type(type_in), 
-        flush_promise{} {}
+              const log_msg& msg_in,
+              payload_allocator alloc = payload_allocator())
+        : basic_log_msg_buf{msg_in, alloc}, 
+        logger_handle(logger_handle_in),
+        msg_type(type_in) {}
 
     // flush
-    async_msg(async_logger_shr_ptr&& logger_in, 
+    async_msg(size_t logger_handle_in, 
               async_msg_type type_in,
-              std::promise<void>&& promise_in)
-        : log_msg_buf{}, 
-        logger(std::move(logger_in)),
+              std::uint64_t flush_ticket_in)
+        : basic_log_msg_buf{}, 
+        logger_handle(logger_handle_in),
         msg_type(type_in), 
-        flush_promise{std::move(promise_in)} {}
+        flush_ticket(flush_ticket_in) {}
 
     // terminate
-    async_msg(async_logger_shr_ptr&& logger_in, 
+    async_msg(size_t logger_handle_in, 
               async_msg_type type_in)
-        : log_msg_buf{}, 
-        logger(std::move(logger_in)),
-        msg_type(type_in), 
-        flush_promise{} {}
+        : basic_log_msg_buf{}, 
+        logger_handle(logger_handle_in),
+        msg_type(type_in) {}
 
     explicit async_msg(async_msg_type type_in)
-        : async_msg(nullptr, type_in) {}
+        : async_msg(invalid_logger_handle, type_in) {}
 };
 
 }   // namespace base
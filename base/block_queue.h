@@ -15,9 +15,11 @@ namespace base {
     1. enqueue_if_have_room: 队列未满时直接入队，队列已满时丢弃；
     2. enqueue: 队列未满时直接入队，队列已满时阻塞，等待有元素出队后再入队；
     3. enqueue_nowait: 无论队列是否已满都入队，从环形队列头部覆盖；
-提供 2 种出队方式：
+提供 4 种出队方式：
     1. dequeue: 队列不空时出队，队列为空时阻塞，等待有元素入队后再出队；
     2. dequeue_for: 在 dequeue 的基础上，设置超时时间，超时后出队失败，返回 false；
+    3. dequeue_bulk: 队列为空时阻塞，不空时一次取出至多 max_items 个元素，返回实际出队个数；
+    4. dequeue_bulk_for: 在 dequeue_bulk 的基础上，设置超时时间，超时后返回 0；
 */
 
 template <typename T>
@@ -86,6 +88,38 @@ public:
         return true;
     }
 
+    // 取出的元素依次写入 popped_items 指向的数组，一次加锁完成多个元素的出队
+    size_t dequeue_bulk(T* popped_items, size_t max_items) {
+        size_t cnt = 0;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            push_cv_.wait(lock, [this] { return !this->queue_.empty(); });
+            while (cnt < max_items && !queue_.empty()) {
+                popped_items[cnt++] = std::move(queue_.front());
+                queue_.pop_front();
+            }
+        }
+        pop_cv_.notify_all();
+        return cnt;
+    }
+
+    size_t dequeue_bulk_for(T* popped_items, size_t max_items, 
+                            std::chrono::milliseconds duration) {
+        size_t cnt = 0;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            if (!push_cv_.wait_for(lock, duration, [this] { return !this->queue_.empty(); })) {
+                return 0;
+            }
+            while (cnt < max_items && !queue_.empty()) {
+                popped_items[cnt++] = std::move(queue_.front());
+                queue_.pop_front();
+            }
+        }
+        pop_cv_.notify_all();
+        return cnt;
+    }
+
 #else
     // 在 mingw 编译下，最后再释放 unique_lock，否则会导致死锁
 
@@ -140,6 +174,35 @@ public:
         return true;
     }
 
+    size_t dequeue_bulk(T* popped_items, size_t max_items) {
+        size_t cnt = 0;
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        push_cv_.wait(lock, [this] { return !this->queue_.empty(); });
+        while (cnt < max_items && !queue_.empty()) {
+            popped_items[cnt++] = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        pop_cv_.notify_all();
+        return cnt;
+    }
+
+    size_t dequeue_bulk_for(T* popped_items, size_t max_items, 
+                            std::chrono::milliseconds duration) {
+        size_t cnt = 0;
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        if (!push_cv_.wait_for(lock, duration, [this] { return !this->queue_.empty(); })) {
+            return 0;
+        }
+        while (cnt < max_items && !queue_.empty()) {
+            popped_items[cnt++] = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        pop_cv_.notify_all();
+        return cnt;
+    }
+
 #endif
 
     // 队列保存的元素个数
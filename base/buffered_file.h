@@ -0,0 +1,162 @@
+#pragma once
+
+#include "definitions.h"
+#include "base/exception.h"
+#include "base/os.h"
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+
+namespace learnlog {
+namespace base {
+
+// 文件 sink 的写合并选项，buffer_size 为 0 时不启用，仍通过 FILE* 写入
+struct file_buffer_options {
+    size_t buffer_size{0};                          // 用户态追加缓冲区的大小，如 1 ~ 8 MB
+    std::chrono::milliseconds flush_interval{0};    // 非 0 时，缓冲区中的数据至多等待该时间后写入文件
+};
+
+// 直接通过文件描述符写入的文件，在用户态持有一块大的追加缓冲区（write-combining），
+// 写入的数据先追加到缓冲区，以下情况才调用 write(2)：
+// 缓冲区放不下新的数据（此时用 writev(2) 把缓冲区与新数据一次写入）、调用 flush()、
+// 或写入时距上次写入文件超过 flush_interval；
+// 本身没有定时器，没有新的写入时由持有者定时调用 flush()（见 sinks::basic_file_sink）；
+// 不是线程安全的，由 sink 加锁保护
+class buffered_file {
+public:
+    explicit buffered_file(const file_buffer_options& opts)
+        : buf_(new char[opts.buffer_size == 0 ? 1 : opts.buffer_size]),
+          capacity_(opts.buffer_size == 0 ? 1 : opts.buffer_size),
+          flush_interval_(opts.flush_interval) {}
+
+    // 析构时写出缓冲区并关闭文件，忽略失败
+    ~buffered_file() {
+        if (fd_ != -1) {
+            write_out_(fd_, nullptr, 0);
+            os::close_fd(fd_);
+        }
+    }
+
+    buffered_file(const buffered_file&) = delete;
+    buffered_file& operator=(const buffered_file&) = delete;
+
+    // 打开文件，首先关闭已有文件，打开文件前先创建父级目录，
+    // 共尝试 try_times 次，每次间隔 try_every_ms 毫秒
+    void open(const filename_t& fname, bool truncate = false,
+              int try_times = 5, unsigned int try_every_ms = 10) {
+        close();
+        fname_ = fname;
+        for (int i = 0; i < try_times; ++i) {
+            os::create_dir(os::get_dir(fname_));
+            if (os::open_fd(&fd_, fname_, truncate)) {
+                last_write_ = std::chrono::steady_clock::now();
+                return;
+            }
+            fd_ = -1;
+            os::sleep_for_ms(try_every_ms);
+        }
+        throw_error_("open");
+    }
+
+    // 写出缓冲区后关闭文件
+    void close() {
+        if (fd_ == -1) return;
+        int fd = fd_;
+        fd_ = -1;
+        bool flushed = write_out_(fd, nullptr, 0);
+        if (!os::close_fd(fd) || !flushed) {
+            throw_error_("close");
+        }
+    }
+
+    void write(const char* data, size_t size) {
+        if (fd_ == -1) return;
+
+        if (size <= capacity_ - size_) {
+            std::memcpy(buf_.get() + size_, data, size);
+            size_ += size;
+        }
+        else if (!write_out_(fd_, data, size)) {
+            throw_error_("write");
+        }
+
+        if (flush_interval_.count() > 0 && size_ > 0 &&
+            std::chrono::steady_clock::now() - last_write_ >= flush_interval_) {
+            flush();
+        }
+    }
+
+    // 将缓冲区写入文件，不保证写入磁盘
+    void flush() {
+        if (fd_ != -1 && !write_out_(fd_, nullptr, 0)) {
+            throw_error_("flush");
+        }
+    }
+
+    // 写出缓冲区并刷新文件系统缓存，保证文件数据被写入磁盘
+    void sync() {
+        flush();
+        if (fd_ != -1 && !os::fsync_fd(fd_)) {
+            throw_error_("sync");
+        }
+    }
+
+    // 文件大小，包括缓冲区中还未写入文件的部分
+    u_long_long size() const {
+        long_long ret = fd_ == -1 ? -1 : os::fd_filesize(fd_);
+        if (ret == -1) {
+            throw_error_("size");
+        }
+        return static_cast<u_long_long>(ret) + size_;
+    }
+
+    bool is_open() const { return fd_ != -1; }
+    size_t buffered() const { return size_; }
+    size_t capacity() const { return capacity_; }
+    // 已经发出的 write() / writev() 调用次数
+    size_t write_calls() const { return write_calls_; }
+    const filename_t& filename() const { return fname_; }
+
+private:
+    // 写出缓冲区与 [data, data + size)，写入失败时丢弃缓冲区中的内容
+    bool write_out_(int fd, const char* data, size_t size) {
+        if (size_ == 0 && size == 0) {
+            return true;
+        }
+        bool ok;
+        if (size_ == 0) {
+            ok = os::write_fd(fd, data, size);
+        }
+        else if (size == 0) {
+            ok = os::write_fd(fd, buf_.get(), size_);
+        }
+        else {
+            ok = os::writev_fd(fd, buf_.get(), size_, data, size);
+        }
+        ++write_calls_;
+        size_ = 0;
+        last_write_ = std::chrono::steady_clock::now();
+        return ok;
+    }
+
+    void throw_error_(const char* op) const {
+        source_loc loc{__FILE__, __LINE__, __func__};
+        std::string fname_str(fname_.begin(), fname_.end());
+        std::string err_str = fmt::format("learnlog::buffered_file::{}() failed, filename: '{}'",
+                                          op, fname_str);
+        throw_learnlog_excpt(err_str, os::get_errno(), loc);
+    }
+
+    std::unique_ptr<char[]> buf_;
+    size_t capacity_;
+    size_t size_{0};
+    std::chrono::milliseconds flush_interval_;
+    std::chrono::steady_clock::time_point last_write_;
+    size_t write_calls_{0};
+    int fd_{-1};
+    filename_t fname_;
+};
+
+}   // namespace base
+}   // namespace learnlog
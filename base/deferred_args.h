@@ -0,0 +1,170 @@
+#pragma once
+
+#include "definitions.h"
+
+#include <cstring>
+#include <string>
+#if __cplusplus >= 201703L
+    #include <string_view>
+#endif
+
+namespace learnlog {
+namespace base {
+
+/*
+延迟格式化使用的参数编码，
+async_logger 开启延迟格式化后，调用线程不再格式化消息，而是把参数按顺序编码进 log_msg::msg，
+后台线程解码后再调用 fmt::vformat_to()，
+支持的参数类型：
+    1. 整数、浮点数、void 指针，按值拷贝；
+    2. C 字符串、std::string、字符串视图，拷贝字符串内容；
+其余类型（例如自定义 formatter 的类型）无法保证在后台线程中仍然有效，只能在调用线程格式化
+*/
+
+template <typename T, typename Enable = void>
+struct deferred_arg {
+    static const bool supported = false;
+};
+
+// 整数、浮点数、void 指针
+template <typename T>
+struct deferred_arg<T, typename std::enable_if<std::is_arithmetic<T>::value ||
+                                               std::is_same<T, const void*>::value ||
+                                               std::is_same<T, void*>::value>::type> {
+    static const bool supported = true;
+    using decoded_type = T;
+
+    static bool valid(const T&) { return true; }
+
+    static void encode(fmt_memory_buf& buf, const T& value) {
+        const char* p = reinterpret_cast<const char*>(&value);
+        buf.append(p, p + sizeof(T));
+    }
+
+    static const char* decode(const char* data, decoded_type& value) {
+        std::memcpy(&value, data, sizeof(T));
+        return data + sizeof(T);
+    }
+};
+
+// 字符串先写入长度，再写入内容
+struct deferred_str_arg {
+    static const bool supported = true;
+    using decoded_type = fmt_string_view;
+
+    static void encode_str(fmt_memory_buf& buf, const char* str, size_t len) {
+        const char* p = reinterpret_cast<const char*>(&len);
+        buf.append(p, p + sizeof(size_t));
+        buf.append(str, str + len);
+    }
+
+    static const char* decode(const char* data, decoded_type& value) {
+        size_t len = 0;
+        std::memcpy(&len, data, sizeof(size_t));
+        value = fmt_string_view(data + sizeof(size_t), len);
+        return data + sizeof(size_t) + len;
+    }
+};
+
+// C 字符串额外写入结尾的 '\0'，解码后仍然是 const char*，与调用线程的格式化结果一致
+template <>
+struct deferred_arg<const char*> {
+    static const bool supported = true;
+    using decoded_type = const char*;
+
+    static bool valid(const char* value) { return value != nullptr; }
+
+    static void encode(fmt_memory_buf& buf, const char* value) {
+        deferred_str_arg::encode_str(buf, value, std::strlen(value) + 1);
+    }
+
+    static const char* decode(const char* data, decoded_type& value) {
+        fmt_string_view strv;
+        data = deferred_str_arg::decode(data, strv);
+        value = strv.data();
+        return data;
+    }
+};
+
+template <>
+struct deferred_arg<char*> : deferred_arg<const char*> {};
+
+template <>
+struct deferred_arg<std::string> : deferred_str_arg {
+    static bool valid(const std::string&) { return true; }
+    static void encode(fmt_memory_buf& buf, const std::string& value) {
+        encode_str(buf, value.data(), value.size());
+    }
+};
+
+template <>
+struct deferred_arg<fmt_string_view> : deferred_str_arg {
+    static bool valid(fmt_string_view) { return true; }
+    static void encode(fmt_memory_buf& buf, fmt_string_view value) {
+        encode_str(buf, value.data(), value.size());
+    }
+};
+
+#if __cplusplus >= 201703L
+template <>
+struct deferred_arg<std::string_view> : deferred_str_arg {
+    static bool valid(std::string_view) { return true; }
+    static void encode(fmt_memory_buf& buf, std::string_view value) {
+        encode_str(buf, value.data(), value.size());
+    }
+};
+#endif
+
+// 按参数顺序逐个编码、解码，Args 均为退化后的类型
+template <typename... Args>
+struct deferred_args;
+
+template <>
+struct deferred_args<> {
+    static const bool supported = true;
+
+    static bool valid() { return true; }
+
+    static void encode(fmt_memory_buf&) {}
+
+    template <typename... Decoded>
+    static void decode_and_format(fmt_string_view fmt_strv, const char*,
+                                  fmt_memory_buf& dest, const Decoded&... values) {
+        fmt::vformat_to(fmt::appender(dest), fmt_strv, fmt::make_format_args(values...));
+    }
+};
+
+template <typename T, typename... Rest>
+struct deferred_args<T, Rest...> {
+    using arg = deferred_arg<T>;
+    using rest = deferred_args<Rest...>;
+    static const bool supported = arg::supported && rest::supported;
+
+    template <typename U, typename... Us>
+    static bool valid(const U& value, const Us&... values) {
+        return arg::valid(value) && rest::valid(values...);
+    }
+
+    template <typename U, typename... Us>
+    static void encode(fmt_memory_buf& buf, const U& value, const Us&... values) {
+        arg::encode(buf, value);
+        rest::encode(buf, values...);
+    }
+
+    template <typename... Decoded>
+    static void decode_and_format(fmt_string_view fmt_strv, const char* data,
+                                  fmt_memory_buf& dest, const Decoded&... values) {
+        typename arg::decoded_type value;
+        data = arg::decode(data, value);
+        rest::decode_and_format(fmt_strv, data, dest, values..., value);
+    }
+};
+
+// 后台线程通过函数指针调用，解码 args 并按 fmt_strv 格式化，结果追加到 dest
+template <typename... Args>
+void format_deferred_args(fmt_string_view fmt_strv, const char* args, fmt_memory_buf& dest) {
+    deferred_args<Args...>::decode_and_format(fmt_strv, args, dest);
+}
+
+}   // namespace base
+}   // namespace learnlog
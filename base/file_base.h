@@ -79,11 +79,11 @@ inline void sync(FILE* fp, const filename_t& fname) {
     }
 }
 
-// 将 buf 的内容写入文件
-inline void write(FILE* fp, const filename_t& fname, const fmt_memory_buf& buf) {
+// 将 [data, data + size) 写入文件
+inline void write(FILE* fp, const filename_t& fname, const char* data, size_t size) {
     if (fp == nullptr) return;
 
-    if (::fwrite(buf.data(), sizeof(char), buf.size(), fp) != buf.size()) {
+    if (::fwrite(data, sizeof(char), size, fp) != size) {
         source_loc loc{__FILE__, __LINE__, __func__};
         std::string fname_str(fname.begin(), fname.end());
         std::string err_str = fmt::format("learnlog::file_base::write() failed, filename: '{}'", fname_str);
@@ -91,6 +91,11 @@ inline void write(FILE* fp, const filename_t& fname, const fmt_memory_buf& buf)
     }
 }
 
+// 将 buf 的内容写入文件
+inline void write(FILE* fp, const filename_t& fname, const fmt_memory_buf& buf) {
+    write(fp, fname, buf.data(), buf.size());
+}
+
 // 获取文件大小（字节），u_long_long 为 64 位无符号整型
 inline u_long_long size(FILE* fp, const filename_t& fname) {
     if (fp == nullptr) {
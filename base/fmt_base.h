@@ -36,38 +36,124 @@ inline void fill_uint_(T n, size_t n_len, size_t fill_len, fmt_memory_buf& dest_
     append_int(n , dest_buf);
 }
 
+// "00" ~ "99" 的两位数字表，digit_pair(n) 指向 n 对应的两个字符，n < 100
+inline const char* digit_pair(size_t n) {
+    static constexpr char table[] =
+        "0001020304050607080910111213141516171819"
+        "2021222324252627282930313233343536373839"
+        "4041424344454647484950515253545556575859"
+        "6061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    return table + n * 2;
+}
+
+inline void write_pair(uint32_t n, char* out) {
+    const char* pair = digit_pair(n);
+    out[0] = pair[0];
+    out[1] = pair[1];
+}
+
+// 将 n 写为 Width 位的十进制数字，不足时以 '0' 为前缀，要求 n < 10^Width；
+// 每两位查一次表，没有逐位的除法与分支，支持 Width 为 2、3、4、6、9
+template <size_t Width>
+inline void write_fixed(uint32_t n, char* out);
+
+template <>
+inline void write_fixed<2>(uint32_t n, char* out) {
+    write_pair(n, out);
+}
+
+template <>
+inline void write_fixed<3>(uint32_t n, char* out) {
+    out[0] = static_cast<char>('0' + n / 100);
+    write_pair(n % 100, out + 1);
+}
+
+template <>
+inline void write_fixed<4>(uint32_t n, char* out) {
+    write_pair(n / 100, out);
+    write_pair(n % 100, out + 2);
+}
+
+template <>
+inline void write_fixed<6>(uint32_t n, char* out) {
+    write_pair(n / 10000, out);
+    write_fixed<4>(n % 10000, out + 2);
+}
+
+template <>
+inline void write_fixed<9>(uint32_t n, char* out) {
+    out[0] = static_cast<char>('0' + n / 100000000);
+    write_fixed<4>(n / 10000 % 10000, out + 1);
+    write_fixed<4>(n % 10000, out + 5);
+}
+
+// 10^Width
+template <size_t Width>
+struct pow10_of {
+    static constexpr uint64_t value = 10 * pow10_of<Width - 1>::value;
+};
+
+template <>
+struct pow10_of<0> {
+    static constexpr uint64_t value = 1;
+};
+
+template <typename T>
+inline bool is_negative(T n, std::true_type) { return n < 0; }
+
+template <typename T>
+inline bool is_negative(T, std::false_type) { return false; }
+
+// 将 n 填入以 '0' 为前缀，长度为 Width 的字符串中，一次加入 dest_buf；
+// n 的位数超过 Width 或为负数时，与 fill_uint_() 相同，直接加入 n
+template <size_t Width, typename T>
+inline void append_fixed(T n, fmt_memory_buf& dest_buf) {
+    if (!is_negative(n, std::is_signed<T>()) &&
+        static_cast<uint64_t>(n) < pow10_of<Width>::value) {
+        char digits[Width];
+        write_fixed<Width>(static_cast<uint32_t>(n), digits);
+        dest_buf.append(digits, digits + Width);
+    }
+    else {
+        append_int(n, dest_buf);
+    }
+}
+
 // 将 n 作为无符号整数填入以 '0' 为前缀，长度为 fill_len 的字符串中，再加入 dest_buf
-// 如果 fill_len <= 3（常见情况），尝试直接通过 push_back 填入，更快
+// 常用长度（2、3、4、6、9，即月日时分秒、毫秒、年、微秒、纳秒）查表写入，其余长度逐个填充 '0'
 template <typename T>
 inline void fill_uint(T n, size_t fill_len, fmt_memory_buf& dest_buf) {
     // static_assert(std::is_unsigned<T>::value, "fill_uint must get unsigned T");
 
     switch (fill_len) {
-        case 2:
-            if( n < 100) {
-                dest_buf.push_back(static_cast<char>(n / 10 + '0'));
-                dest_buf.push_back(static_cast<char>(n % 10 + '0'));
-            }
-            else {  // 如果 n 的实际位数 > 2，通过 append_int() 加入buf
-                append_int(n, dest_buf);
-            }
-            break;
-        case 3:
-            if( n < 1000) {
-                dest_buf.push_back(static_cast<char>(n / 100 + '0'));
-                n = n % 100;
-                dest_buf.push_back(static_cast<char>(n / 10 + '0'));
-                dest_buf.push_back(static_cast<char>(n % 10 + '0'));
-            }
-            else {  // 如果 n 的实际位数 > 3，通过 append_int() 加入buf
-                append_int(n, dest_buf);
-            }
-            break;
+        case 2: append_fixed<2>(n, dest_buf); break;
+        case 3: append_fixed<3>(n, dest_buf); break;
+        case 4: append_fixed<4>(n, dest_buf); break;
+        case 6: append_fixed<6>(n, dest_buf); break;
+        case 9: append_fixed<9>(n, dest_buf); break;
         default:
             fill_uint_(n, count_unsigned_digits(n), fill_len, dest_buf);
     }
 }
 
+// 写入 "HH:MM:SS"，FracWidth > 0 时之后写入 '.' 与 FracWidth 位的秒以下部分 frac，
+// 共 8 + (FracWidth > 0 ? FracWidth + 1 : 0) 个字符；要求各字段不超过对应位数
+template <size_t FracWidth>
+inline size_t write_hms(uint32_t hour, uint32_t min, uint32_t sec, uint32_t frac, char* out) {
+    write_pair(hour, out);
+    out[2] = ':';
+    write_pair(min, out + 3);
+    out[5] = ':';
+    write_pair(sec, out + 6);
+    if (FracWidth == 0) {
+        return 8;
+    }
+    out[8] = '.';
+    write_fixed<FracWidth == 0 ? 2 : FracWidth>(frac, out + 9);
+    return 9 + FracWidth;
+}
+
 // 得到 tp 在秒以下的精确时间
 // Metric 可选类型：milliseconds、microseconds、nanoseconds
 template <typename Metric>
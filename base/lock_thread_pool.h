@@ -8,15 +8,16 @@ namespace learnlog {
 namespace base {
 
 // 使用阻塞队列 block_queue 的线程池，处理 async_msg，
-// q.enqueue() 入队，q.dequeue() 出队
+// q.enqueue() 入队，q.dequeue_bulk() 批量出队
 // 队列的总占用空间不变
 
 class lock_thread_pool final: public thread_pool {
 public:
     lock_thread_pool(size_t queue_size, size_t threads_num, 
                      const std::function<void()>& on_thread_start,
-                     const std::function<void()>& on_thread_stop)
-        : thread_pool(queue_size, lock, threads_num, on_thread_start, on_thread_stop),
+                     const std::function<void()>& on_thread_stop,
+                     const worker_options& opts = worker_options())
+        : thread_pool(queue_size, lock, threads_num, on_thread_start, on_thread_stop, opts),
           msg_q_(msg_q_size_) {
         for (size_t i = 0; i < threads_num_; ++i) {
             threads_.emplace_back([this] {
@@ -40,6 +41,10 @@ public:
         }
     }
 
+    lock_thread_pool(size_t queue_size, size_t threads_num,
+                     const worker_options& opts)
+        : lock_thread_pool(queue_size, threads_num, []{}, []{}, opts) {}
+
     lock_thread_pool(size_t queue_size = default_queue_size,
                      size_t threads_num = default_threads_num)
         : thread_pool(queue_size, lock, threads_num, []{}, []{}),
@@ -54,18 +59,7 @@ public:
     }
 
     ~lock_thread_pool() override {
-        for (size_t i = 0; i < threads_num_; i++) {
-            enqueue_async_msg_(async_msg(async_msg_type::terminate));
-        }
-        try {
-            for(auto &t : threads_){
-                t.join();
-            }
-        }
-        catch(const std::exception& e) {
-            source_loc loc{__FILE__, __LINE__, __func__};
-            throw_learnlog_excpt(e.what(), os::get_errno(), loc);
-        }
+        shutdown_(std::chrono::steady_clock::time_point::max(), shutdown_policy::drain, false);
     }
 
     size_t override_count() { return msg_q_.get_override_count(); }
@@ -78,8 +72,14 @@ private:
         msg_q_.enqueue(std::move(amsg));
     }
 
-    void dequeue_async_msg_(async_msg& amsg) override {
-        msg_q_.dequeue(amsg);
+    void terminate_workers_() override {
+        for (size_t i = 0; i < threads_num_; i++) {
+            enqueue_async_msg_(async_msg(async_msg_type::terminate));
+        }
+    }
+
+    size_t dequeue_async_msgs_(async_msg* amsgs, size_t max_num) override {
+        return msg_q_.dequeue_bulk(amsgs, max_num);
     }
 
     block_queue<async_msg> msg_q_;
@@ -3,6 +3,9 @@
 using namespace learnlog;
 using namespace base;
 
+std::atomic<size_t> lockfree_concurrent_thread_pool::pool_cnt_{0};
+
 #ifdef LEARNLOG_USE_TLS
     thread_local atomic_token* lockfree_concurrent_thread_pool::token_ = nullptr;
+    thread_local size_t lockfree_concurrent_thread_pool::token_pool_id_ = 0;
 #endif
@@ -4,17 +4,30 @@
 #include "concurrentqueue/blockingconcurrentqueue.h"
 #include "async_logger.h"
 #include <unordered_map>
+#include <chrono>
 
 namespace learnlog {
 namespace base {
 
+// 队列为空时，lockfree_concurrent_thread_pool 后台线程的等待策略
+enum class wait_strategy {
+    busy_spin,      // 一直自旋，延迟最低，空闲时占满一个 cpu 核
+    spin_pause,     // 自旋时执行 pause 指令，降低功耗，空闲时仍占满一个 cpu 核
+    spin_yield,     // 短暂自旋后循环让出 cpu
+    spin_park       // 短暂自旋后阻塞在信号量上，生产者只在后台线程阻塞时唤醒（默认）
+};
+
+// 生产者与后台线程共用的 token，每个后台线程只从自己的 token 出队
 struct atomic_token {
     const moodycamel::ProducerToken p_token_;
     std::atomic<bool> enqueuing_;
+    std::atomic<bool> parked_;                      // 后台线程是否（即将）阻塞在 c_sema_ 上
+    moodycamel::LightweightSemaphore c_sema_;
 
     explicit atomic_token(moodycamel::ConcurrentQueue<async_msg>& msg_q)
         : p_token_(msg_q),
-          enqueuing_(false) {}
+          enqueuing_(false),
+          parked_(false) {}
 
     void enqueue_lock() {
         bool expected = false;
@@ -31,7 +44,7 @@ struct atomic_token {
 
 // 使用无锁队列 ConcurrentQueue 的线程池，处理 async_msg，
 // 入队时先尝试 q.try_enqueue()，如果失败再尝试 q.enqueue()，以此循环
-// 出队时循环尝试 q.try_dequeue_from_producer()，
+// 出队时尝试 q.try_dequeue_bulk_from_producer()，一次取出多条消息，队列为空时按照 wait_strategy 等待，
 // 如果在队列占用空间不变的条件下入队失败(try_enqueue)，会额外申请一块内存后再次尝试(enqueue)，
 // 队列的总占用空间只增不减
 
@@ -39,12 +52,14 @@ class lockfree_concurrent_thread_pool final: public thread_pool {
 public:
     lockfree_concurrent_thread_pool(size_t queue_size, size_t threads_num, 
                                     const std::function<void()>& on_thread_start,
-                                    const std::function<void()>& on_thread_stop)
+                                    const std::function<void()>& on_thread_stop,
+                                    const worker_options& opts = worker_options())
         : thread_pool(queue_size, 
                       lockfree_concurrent,
                       threads_num,
                       on_thread_start,
-                      on_thread_stop),
+                      on_thread_stop,
+                      opts),
           msg_q_(msg_q_size_) {
         for (size_t i = 0; i < threads_num_; ++i) {
             atomic_tokens_.emplace_back(new atomic_token(msg_q_));
@@ -62,6 +77,7 @@ public:
                 }
 #ifdef LEARNLOG_USE_TLS
                 token_ = token;
+                token_pool_id_ = pool_id_;
 #else
                 {
                     std::lock_guard<std::mutex> lock(c_mutex_);
@@ -98,6 +114,7 @@ public:
                 }
 #ifdef LEARNLOG_USE_TLS
                 token_ = token;
+                token_pool_id_ = pool_id_;
 #else
                 {
                     std::lock_guard<std::mutex> lock(c_mutex_);
@@ -110,6 +127,10 @@ public:
         }
     }
 
+    lockfree_concurrent_thread_pool(size_t queue_size, size_t threads_num,
+                                    const worker_options& opts)
+        : lockfree_concurrent_thread_pool(queue_size, threads_num, []{}, []{}, opts) {}
+
     lockfree_concurrent_thread_pool(size_t queue_size = default_queue_size,
                                     size_t threads_num = default_threads_num)
         : thread_pool(queue_size,
@@ -134,6 +155,7 @@ public:
                 }
 #ifdef LEARNLOG_USE_TLS
                 token_ = token;
+                token_pool_id_ = pool_id_;
 #else
                 {
                     std::lock_guard<std::mutex> lock(c_mutex_);
@@ -147,58 +169,54 @@ public:
     }
 
     ~lockfree_concurrent_thread_pool() override {
+        shutdown_(std::chrono::steady_clock::time_point::max(), shutdown_policy::drain, false);
         for (auto &token : atomic_tokens_) {
-            producer_sema_.signal();
-            msg_q_.enqueue(token->p_token_,
-                           async_msg(async_msg_type::terminate));
-        }
-        try {
-            for(auto &t : threads_){
-                t.join();
-            }
-            for (auto &token : atomic_tokens_) {
-                delete token;
-                token = nullptr;
-            }
-        }
-        catch(const std::exception& e) {
-            source_loc loc{__FILE__, __LINE__, __func__};
-            throw_learnlog_excpt(e.what(), os::get_errno(), loc);
+            delete token;
+            token = nullptr;
         }
     }
 
     size_t current_msg_count() { return msg_q_.size_approx(); }
 
+    // 切换为自旋策略后生产者不再唤醒阻塞的后台线程，这里先唤醒已阻塞的后台线程
+    void set_wait_strategy(wait_strategy strategy) {
+        strategy_.store(static_cast<int>(strategy), std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (auto &token : atomic_tokens_) {
+            if (token->parked_.exchange(false, std::memory_order_relaxed)) {
+                token->c_sema_.signal();
+            }
+        }
+    }
+    wait_strategy get_wait_strategy() const {
+        return static_cast<wait_strategy>(strategy_.load(std::memory_order_relaxed));
+    }
+
 private:
+    // 每个后台线程只从自己的 token 出队，terminate 消息通过每个 token 入队；
+    // 尚未取得 token 的后台线程先被 producer_sema_ 唤醒
+    void terminate_workers_() override {
+        for (auto &token : atomic_tokens_) {
+            producer_sema_.signal();
+            token->enqueue_lock();
+            msg_q_.enqueue(token->p_token_,
+                           async_msg(async_msg_type::terminate));
+            token->release();
+            token->c_sema_.signal();
+        }
+    }
+
     void enqueue_async_msg_(async_msg&& amsg) override {
         atomic_token* token = nullptr;
 #ifdef LEARNLOG_USE_TLS
-        if (token_ == nullptr) {
-            size_t cnt = producer_cnt_.fetch_add(1, std::memory_order_relaxed);
-            {
-                std::lock_guard<std::mutex> lock(t_mutex_);
-                token_ = atomic_tokens_[cnt % threads_num_];
-            }
-            producer_sema_.signal();
+        // 同一线程可能先后向多个线程池提交消息，缓存的 token 只对 pool_id_ 相同的线程池有效
+        if (token_pool_id_ != pool_id_) {
+            token_ = producer_token_();
+            token_pool_id_ = pool_id_;
         }
         token = token_;
 #else
-        size_t tid = os::thread_id();
-        {
-            std::lock_guard<std::mutex> lock(p_mutex_);
-            if (producer_atomic_tokens_.find(tid) == producer_atomic_tokens_.end()) {
-                size_t cnt = producer_cnt_.fetch_add(1, std::memory_order_relaxed);
-                {
-                    std::lock_guard<std::mutex> lock(t_mutex_);
-                    token = atomic_tokens_[cnt % threads_num_];
-                }
-                producer_atomic_tokens_[tid] = token;
-                producer_sema_.signal();
-            }
-            else {
-                token = producer_atomic_tokens_[tid];
-            }
-        }
+        token = producer_token_();
 #endif
         token->enqueue_lock();
         while (!msg_q_.try_enqueue(token->p_token_, std::move(amsg))) {
@@ -207,9 +225,42 @@ private:
             }
         }
         token->release();
+        notify_consumer_(token);
+    }
+
+    // 只有后台线程已登记为阻塞时才唤醒，队列非空期间生产者不会触碰信号量；
+    // 与 dequeue_park_() 中先登记、再检查队列的顺序配对，seq_cst 栅栏保证二者至少一方看到对方
+    void notify_consumer_(atomic_token* token) {
+        if (get_wait_strategy() != wait_strategy::spin_park) {
+            return;
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (token->parked_.load(std::memory_order_relaxed) &&
+            token->parked_.exchange(false, std::memory_order_relaxed)) {
+            token->c_sema_.signal();
+        }
+    }
+
+    atomic_token* producer_token_() {
+        atomic_token* token = nullptr;
+        size_t tid = os::thread_id();
+        std::lock_guard<std::mutex> lock(p_mutex_);
+        if (producer_atomic_tokens_.find(tid) == producer_atomic_tokens_.end()) {
+            size_t cnt = producer_cnt_.fetch_add(1, std::memory_order_relaxed);
+            {
+                std::lock_guard<std::mutex> lock(t_mutex_);
+                token = atomic_tokens_[cnt % threads_num_];
+            }
+            producer_atomic_tokens_[tid] = token;
+            producer_sema_.signal();
+        }
+        else {
+            token = producer_atomic_tokens_[tid];
+        }
+        return token;
     }
 
-    void dequeue_async_msg_(async_msg& amsg) override {
+    size_t dequeue_async_msgs_(async_msg* amsgs, size_t max_num) override {
         atomic_token* token = nullptr;
 #ifdef LEARNLOG_USE_TLS
         token = token_;
@@ -219,22 +270,70 @@ private:
             token = consumer_atomic_tokens_[os::thread_id()];
         }
 #endif
-        while (!msg_q_.try_dequeue_from_producer(token->p_token_, amsg)) {
-            continue;
+        size_t cnt = msg_q_.try_dequeue_bulk_from_producer(token->p_token_, amsgs, max_num);
+        if (cnt > 0) {
+            return cnt;
         }
+
+        wait_strategy strategy = get_wait_strategy();
+        if (strategy == wait_strategy::spin_park) {
+            return dequeue_park_(token, amsgs, max_num);
+        }
+        // 其余策略一直自旋，每 spin_times_ 次返回 0，由调用方重新出队，期间可以切换等待策略
+        for (size_t i = 0; i < spin_times_; ++i) {
+            cnt = msg_q_.try_dequeue_bulk_from_producer(token->p_token_, amsgs, max_num);
+            if (cnt > 0) {
+                return cnt;
+            }
+            if (strategy == wait_strategy::spin_pause) {
+                os::cpu_relax();
+            }
+            else if (strategy == wait_strategy::spin_yield) {
+                std::this_thread::yield();
+            }
+        }
+        return 0;
+    }
+
+    // 先自旋 spin_times_ 次，仍然为空则登记为阻塞，登记后再检查一次队列，
+    // 避免生产者在登记前入队而错过唤醒
+    size_t dequeue_park_(atomic_token* token, async_msg* amsgs, size_t max_num) {
+        size_t cnt = 0;
+        for (size_t i = 0; i < spin_times_; ++i) {
+            cnt = msg_q_.try_dequeue_bulk_from_producer(token->p_token_, amsgs, max_num);
+            if (cnt > 0) {
+                return cnt;
+            }
+            os::cpu_relax();
+        }
+        token->parked_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cnt = msg_q_.try_dequeue_bulk_from_producer(token->p_token_, amsgs, max_num);
+        if (cnt == 0) {
+            token->c_sema_.wait();
+            cnt = msg_q_.try_dequeue_bulk_from_producer(token->p_token_, amsgs, max_num);
+        }
+        token->parked_.store(false, std::memory_order_relaxed);
+        return cnt;
     }
 
+    static const size_t spin_times_ = 1024;
+
+    std::atomic<int> strategy_{static_cast<int>(wait_strategy::spin_park)};
     std::atomic<size_t> producer_cnt_{0};
     std::atomic<size_t> consumer_cnt_{0};
     moodycamel::LightweightSemaphore producer_sema_;
 
     std::mutex t_mutex_;
     std::vector<atomic_token*> atomic_tokens_;
+    std::mutex p_mutex_;
+    std::unordered_map<size_t, atomic_token*> producer_atomic_tokens_;
+    static std::atomic<size_t> pool_cnt_;
+    const size_t pool_id_{pool_cnt_.fetch_add(1, std::memory_order_relaxed) + 1};
 #ifdef LEARNLOG_USE_TLS
     static thread_local atomic_token* token_;
+    static thread_local size_t token_pool_id_;
 #else
-    std::mutex p_mutex_;
-    std::unordered_map<size_t, atomic_token*> producer_atomic_tokens_;
     std::mutex c_mutex_;
     std::unordered_map<size_t, atomic_token*> consumer_atomic_tokens_;
 #endif
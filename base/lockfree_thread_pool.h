@@ -8,8 +8,18 @@
 namespace learnlog {
 namespace base {
 
+// 队列已满时，lockfree_thread_pool 处理 log 消息入队请求的策略，
+// flush、terminate 消息不受影响，总是按照 block 策略入队
+enum class overflow_policy {
+    block,              // 短暂自旋后阻塞在信号量上，后台线程出队后唤醒，不丢失消息（默认）
+    discard_new,        // 丢弃本次入队的消息，计入 discard_count()
+    drop_queued,        // 从队列中取出并丢弃一条已排队的消息后重试，计入 override_count()，
+                        // 取出的是某个生产者子队列的队首，不保证是全局最早的消息
+    spin_yield          // 短暂自旋后循环让出 cpu，直至入队成功
+};
+
 // 使用无锁阻塞队列 BlockingConcurrentQueue 的线程池，处理 async_msg，
-// 循环尝试 q.try_enqueue() 入队，阻塞等待 q.wait_dequeue() 出队，
+// 尝试 q.try_enqueue() 入队，队满时按照 overflow_policy 处理，阻塞等待 q.wait_dequeue_bulk() 批量出队，
 // 队列的总占用空间不变，初始化后不再额外申请内存
 
 class lockfree_thread_pool final: public thread_pool {
@@ -18,8 +28,9 @@ public:
 
     lockfree_thread_pool(size_t queue_size, size_t threads_num, 
                          const std::function<void()>& on_thread_start,
-                         const std::function<void()>& on_thread_stop)
-        : thread_pool(queue_size, lockfree, threads_num, on_thread_start, on_thread_stop),
+                         const std::function<void()>& on_thread_stop,
+                         const worker_options& opts = worker_options())
+        : thread_pool(queue_size, lockfree, threads_num, on_thread_start, on_thread_stop, opts),
           msg_q_(msg_q_size_) {
         for (size_t i = 0; i < threads_num_; ++i) {
             threads_.emplace_back([this] {
@@ -61,6 +72,16 @@ public:
         }
     }
 
+    lockfree_thread_pool(size_t queue_size, size_t threads_num,
+                         const worker_options& opts)
+        : lockfree_thread_pool(queue_size, threads_num, []{}, []{}, opts) {}
+
+    lockfree_thread_pool(size_t queue_size, size_t threads_num,
+                         const worker_options& opts, overflow_policy policy)
+        : lockfree_thread_pool(queue_size, threads_num, []{}, []{}, opts) {
+        set_overflow_policy(policy);
+    }
+
     lockfree_thread_pool(size_t queue_size = default_queue_size,
                      size_t threads_num = default_threads_num)
         : thread_pool(queue_size, lockfree, threads_num, []{}, []{}),
@@ -84,34 +105,116 @@ public:
     }
 
     ~lockfree_thread_pool() override {
-        while (current_msg_count() != 0) {
-            // os::sleep_for_ms(1);
-        }
+        shutdown_(std::chrono::steady_clock::time_point::max(), shutdown_policy::drain, false);
+    }
+
+    size_t current_msg_count() { return msg_q_.size_approx(); }
+
+    void set_overflow_policy(overflow_policy policy) {
+        policy_.store(static_cast<int>(policy), std::memory_order_relaxed);
+    }
+    overflow_policy get_overflow_policy() const {
+        return static_cast<overflow_policy>(policy_.load(std::memory_order_relaxed));
+    }
+
+    size_t discard_count() const { return discard_cnt_.load(std::memory_order_relaxed); }
+    void reset_discard_count() { discard_cnt_.store(0, std::memory_order_relaxed); }
+    size_t override_count() const { return override_cnt_.load(std::memory_order_relaxed); }
+    void reset_override_count() { override_cnt_.store(0, std::memory_order_relaxed); }
+
+private:
+    // shutdown() 在队列为空后才调用，terminate 消息不会先于其他消息被取走
+    void terminate_workers_() override {
         for (size_t i = 0; i < threads_num_; i++) {
             enqueue_async_msg_(async_msg(async_msg_type::terminate));
         }
-        try {
-            for (auto &t : threads_){
-                t.join();
+    }
+
+    // 预分配的块可能全部被其他生产者未写满的子队列占用，此时新的生产者 try_enqueue() 一直失败；
+    // flush、terminate 消息很少，失败时直接 enqueue()，必要时额外申请一个块，保证 shutdown 不会卡住
+    void enqueue_async_msg_(async_msg&& amsg) override {
+        if (msg_q_.try_enqueue(std::move(amsg))) return;
+
+        if (amsg.msg_type != async_msg_type::log) {
+            while (!msg_q_.enqueue(std::move(amsg))) {
+                std::this_thread::yield();
             }
+            return;
         }
-        catch(const std::exception& e) {
-            source_loc loc{__FILE__, __LINE__, __func__};
-            throw_learnlog_excpt(e.what(), os::get_errno(), loc);
+        overflow_policy policy = get_overflow_policy();
+        switch (policy) {
+            case overflow_policy::discard_new:
+                discard_cnt_.fetch_add(1, std::memory_order_relaxed);
+                drop_pending_(amsg);
+                break;
+            case overflow_policy::drop_queued:
+                enqueue_drop_queued_(std::move(amsg));
+                break;
+            case overflow_policy::spin_yield:
+                enqueue_spin_yield_(std::move(amsg));
+                break;
+            default:
+                enqueue_block_(std::move(amsg));
         }
     }
 
-    size_t current_msg_count() { return msg_q_.size_approx(); }
+    // 先自旋 spin_times_ 次，仍然失败则登记为等待者，阻塞在 room_sema_ 上，
+    // 登记后再尝试一次入队，避免后台线程在登记前出队而错过唤醒；
+    // 等待带有超时，即使唤醒丢失也只会推迟重试
+    void enqueue_block_(async_msg&& amsg) {
+        for (size_t i = 0; i < spin_times_; ++i) {
+            if (msg_q_.try_enqueue(std::move(amsg))) return;
+        }
+        for (;;) {
+            waiting_producers_.fetch_add(1, std::memory_order_seq_cst);
+            bool enqueued = msg_q_.try_enqueue(std::move(amsg));
+            if (!enqueued) {
+                room_sema_.wait(block_wait_usecs_);
+            }
+            waiting_producers_.fetch_sub(1, std::memory_order_seq_cst);
+            if (enqueued || msg_q_.try_enqueue(std::move(amsg))) return;
+        }
+    }
 
-private:
-    void enqueue_async_msg_(async_msg&& amsg) override {
-        while (!msg_q_.try_enqueue(std::move(amsg)))
-            continue;
+    // try_dequeue() 取出任意一个生产者子队列的队首，不一定是全局最早的消息；
+    // 取出的消息如果不是 log 消息（如 flush），重新入队，flush 因此被推迟，
+    // 它之前提交的消息在 flush 入队前已经全部输出
+    void enqueue_drop_queued_(async_msg&& amsg) {
+        async_msg queued;
+        while (!msg_q_.try_enqueue(std::move(amsg))) {
+            if (!msg_q_.try_dequeue(queued)) continue;
+            if (queued.msg_type == async_msg_type::log) {
+                override_cnt_.fetch_add(1, std::memory_order_relaxed);
+                drop_pending_(queued);
+            }
+            else {
+                enqueue_async_msg_(std::move(queued));
+            }
+        }
     }
 
-    void dequeue_async_msg_(async_msg& amsg) override {
+    void enqueue_spin_yield_(async_msg&& amsg) {
+        size_t spin_cnt = 0;
+        while (!msg_q_.try_enqueue(std::move(amsg))) {
+            if (++spin_cnt > spin_times_) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // 有生产者阻塞等待时，按出队个数唤醒
+    void notify_producers_(size_t dequeued_num) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int waiting = waiting_producers_.load(std::memory_order_seq_cst);
+        if (waiting > 0) {
+            room_sema_.signal(static_cast<moodycamel::LightweightSemaphore::ssize_t>(
+                (std::min)(static_cast<size_t>(waiting), dequeued_num)));
+        }
+    }
+
+    size_t dequeue_async_msgs_(async_msg* amsgs, size_t max_num) override {
 #ifdef LEARNLOG_USE_TLS
-        msg_q_.wait_dequeue(*token_, amsg);
+        size_t cnt = msg_q_.wait_dequeue_bulk(*token_, amsgs, max_num);
 #else
         size_t tid = os::thread_id();
         moodycamel::ConsumerToken* token = nullptr;
@@ -119,8 +222,12 @@ private:
             std::lock_guard<std::mutex> lock(hash_mutex_);
             token = tokens_[tid].get();
         }
-        msg_q_.wait_dequeue(*token, amsg);
+        size_t cnt = msg_q_.wait_dequeue_bulk(*token, amsgs, max_num);
 #endif
+        if (cnt > 0) {
+            notify_producers_(cnt);
+        }
+        return cnt;
     }
 
 #ifdef LEARNLOG_USE_TLS
@@ -130,6 +237,15 @@ private:
     std::unordered_map<size_t, c_token_uni_ptr> tokens_;
 #endif
 
+    static const size_t spin_times_ = 128;
+    static const std::int64_t block_wait_usecs_ = 1000;
+
+    std::atomic<int> policy_{static_cast<int>(overflow_policy::block)};
+    std::atomic<size_t> discard_cnt_{0};
+    std::atomic<size_t> override_cnt_{0};
+    std::atomic<int> waiting_producers_{0};
+    moodycamel::LightweightSemaphore room_sema_;
+
     moodycamel::BlockingConcurrentQueue<async_msg> msg_q_;
 };
 
@@ -43,6 +43,12 @@ struct log_msg {
     // 格式化后，上色的字符索引区间
     mutable size_t color_index_start{0};
     mutable size_t color_index_end{0};
+
+    // 延迟格式化：msg 的前 deferred_fmt_size 个字符为格式字符串，之后是编码后的参数，
+    // 由后台线程调用 format_deferred 生成最终的消息内容
+    using deferred_formatter = void (*)(fmt_string_view, const char*, fmt_memory_buf&);
+    deferred_formatter format_deferred{nullptr};
+    size_t deferred_fmt_size{0};
 };
 
 }   // namespace base
@@ -8,27 +8,35 @@ namespace base {
 /*
 对 log_msg 的封装类，
 log_msg 中的 logger_name 和 msg 类型是 fmt_string_view ，保存在栈上，
-log_msg_buf 将 logger_name 和 msg 转存至 fmt_memory_buf
+log_msg_buf 将 logger_name 和 msg 转存至与 fmt_memory_buf 内联容量相同的缓冲区，
+超出内联容量时由 Allocator 申请内存（async_msg 使用线程池的 payload_pool）
 */
 
-class log_msg_buf : public log_msg {
+template <typename Allocator>
+class basic_log_msg_buf : public log_msg {
 public:
-    log_msg_buf() = default;
-    explicit log_msg_buf(const log_msg &init_msg)
-        : log_msg{init_msg} {
+    using buffer_type = fmt::basic_memory_buffer<char, 250, Allocator>;
+
+    basic_log_msg_buf() = default;
+    explicit basic_log_msg_buf(const log_msg &init_msg, 
+                               const Allocator& alloc = Allocator())
+        : log_msg{init_msg},
+          buf_(alloc) {
+        buf_.reserve(logger_name.size() + msg.size());
         buf_.append(logger_name.begin(), logger_name.end());
         buf_.append(msg.begin(), msg.end());
         update_string_view();
     }
     
-    log_msg_buf(const log_msg_buf &other)
-        : log_msg{other} {
+    basic_log_msg_buf(const basic_log_msg_buf &other)
+        : log_msg{other},
+          buf_(other.buf_.get_allocator()) {
         buf_.append(logger_name.begin(), logger_name.end());
         buf_.append(msg.begin(), msg.end());
         update_string_view();
     }
 
-    log_msg_buf& operator=(const log_msg_buf &other) {
+    basic_log_msg_buf& operator=(const basic_log_msg_buf &other) {
         log_msg::operator=(other);
         buf_.clear();
         buf_.append(other.buf_.data(), other.buf_.data() + other.buf_.size());
@@ -36,27 +44,46 @@ public:
         return *this;
     }
 
-    log_msg_buf(log_msg_buf &&other) noexcept
+    basic_log_msg_buf(basic_log_msg_buf &&other) noexcept
         : log_msg{other},
           buf_{std::move(other.buf_)} {
         update_string_view();
     }
 
-    log_msg_buf& operator=(log_msg_buf &&other) noexcept {
+    basic_log_msg_buf& operator=(basic_log_msg_buf &&other) noexcept {
         log_msg::operator=(other);
         buf_ = std::move(other.buf_);
         update_string_view();
         return *this;
     }
 
+    // 在后台线程中完成延迟格式化，用格式化结果替换 msg
+    void apply_deferred_format() {
+        if (format_deferred == nullptr) {
+            return;
+        }
+        fmt_memory_buf formatted;
+        format_deferred(fmt_string_view(msg.data(), deferred_fmt_size),
+                        msg.data() + deferred_fmt_size,
+                        formatted);
+        buf_.resize(logger_name.size());
+        buf_.append(formatted.data(), formatted.data() + formatted.size());
+        log_msg::msg = fmt_string_view(formatted.data(), formatted.size());
+        update_string_view();
+        format_deferred = nullptr;
+        deferred_fmt_size = 0;
+    }
+
 private:
     void update_string_view() {
         log_msg::logger_name = fmt_string_view(buf_.data(), logger_name.size());
         log_msg::msg = fmt_string_view(buf_.data() + logger_name.size(), msg.size());
     }
     
-    fmt_memory_buf buf_;
+    buffer_type buf_;
 };
 
+using log_msg_buf = basic_log_msg_buf<std::allocator<char>>;
+
 }   // namespace base
 }   // namespace learnlog
\ No newline at end of file
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "definitions.h"
+#include "base/exception.h"
+
+#include <atomic>
+#include <chrono>
+
+namespace learnlog {
+namespace base {
+
+// 以下 sampler 供 LEARNLOG_EVERY_N 等宏在每个调用位置各声明一个静态对象，
+// should_log() 判断本次调用是否输出，输出时通过 suppressed 返回上次输出以来被抑制的次数；
+// 构造函数都是 constexpr，常量参数时静态对象在编译期初始化，没有局部静态变量的初始化检查；
+// 多线程同时调用时不加锁，只使用 relaxed 原子操作
+
+// 第 1、n+1、2n+1 ... 次调用输出，n 为 0 时视为 1
+class every_n_sampler {
+public:
+    constexpr explicit every_n_sampler(size_t n) : n_(n == 0 ? 1 : n), count_(0) {}
+
+    bool should_log(size_t& suppressed) {
+        size_t cnt = count_.fetch_add(1, std::memory_order_relaxed);
+        if (cnt % n_ != 0) {
+            return false;
+        }
+        suppressed = cnt == 0 ? 0 : n_ - 1;
+        return true;
+    }
+
+private:
+    const size_t n_;
+    std::atomic<size_t> count_;
+};
+
+// 只输出第一次调用，之后的调用只有一次 relaxed 读取
+class once_sampler {
+public:
+    constexpr once_sampler() : done_(false) {}
+
+    bool should_log(size_t& suppressed) {
+        if (done_.load(std::memory_order_relaxed) ||
+            done_.exchange(true, std::memory_order_relaxed)) {
+            return false;
+        }
+        suppressed = 0;
+        return true;
+    }
+
+private:
+    std::atomic<bool> done_;
+};
+
+inline int64_t steady_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 两次输出之间至少间隔 interval_ms 毫秒，第一次调用总是输出
+class every_ms_sampler {
+public:
+    constexpr explicit every_ms_sampler(int64_t interval_ms)
+        : interval_ns_(interval_ms * 1000000), next_ns_(0), suppressed_(0) {}
+
+    bool should_log(size_t& suppressed) {
+        int64_t now = steady_now_ns();
+        int64_t next = next_ns_.load(std::memory_order_relaxed);
+        // 多个线程同时到期时只有一个线程能更新 next_ns_
+        if (now < next ||
+            !next_ns_.compare_exchange_strong(next, now + interval_ns_, std::memory_order_relaxed)) {
+            suppressed_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    const int64_t interval_ns_;
+    std::atomic<int64_t> next_ns_;
+    std::atomic<size_t> suppressed_;
+};
+
+// 令牌桶：平均每秒最多输出 per_sec 条，允许最多 burst 条的突发，per_sec、burst 为 0 时视为 1；
+// 以 GCRA（理论到达时间）实现，桶的状态只有一个原子变量
+class token_bucket_sampler {
+public:
+    constexpr token_bucket_sampler(size_t per_sec, size_t burst)
+        : interval_ns_(1000000000 / static_cast<int64_t>(per_sec == 0 ? 1 : per_sec)),
+          tolerance_ns_(1000000000 / static_cast<int64_t>(per_sec == 0 ? 1 : per_sec) *
+                        static_cast<int64_t>(burst == 0 ? 0 : burst - 1)),
+          tat_ns_(0), suppressed_(0) {}
+
+    bool should_log(size_t& suppressed) {
+        int64_t now = steady_now_ns();
+        int64_t tat = tat_ns_.load(std::memory_order_relaxed);
+        do {
+            if (now < tat - tolerance_ns_) {
+                suppressed_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        } while (!tat_ns_.compare_exchange_weak(tat, (tat > now ? tat : now) + interval_ns_,
+                                                std::memory_order_relaxed));
+        suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    const int64_t interval_ns_;         // 每个令牌的生成间隔
+    const int64_t tolerance_ns_;        // 允许提前到达的时间，即 burst - 1 个令牌
+    std::atomic<int64_t> tat_ns_;       // 下一条日志的理论到达时间
+    std::atomic<size_t> suppressed_;
+};
+
+// 输出被 sampler 放行的日志，suppressed 不为 0 时在消息末尾附加 " (suppressed N times)"
+template <typename Logger, typename... Args>
+void log_sampled(Logger& logger, source_loc loc, level::level_enum lvl, size_t suppressed,
+                 fmt_format_string<Args...> fmt_fstr, Args &&...args) {
+    if (suppressed == 0) {
+        logger.log(loc, lvl, fmt_fstr, std::forward<Args>(args)...);
+        return;
+    }
+    try {
+        fmt_memory_buf buf;
+        fmt::vformat_to(fmt::appender(buf), fmt_string_view{fmt_fstr}, fmt::make_format_args(args...));
+        fmt::format_to(fmt::appender(buf), " (suppressed {} times)", suppressed);
+        logger.log(loc, lvl, fmt_string_view(buf.data(), buf.size()));
+    }
+    LEARNLOG_CATCH
+}
+
+template <typename Logger, typename T,
+          typename std::enable_if<!is_convertible_to_basic_format_string<const T &>::value,
+                                  int>::type = 0>
+void log_sampled(Logger& logger, source_loc loc, level::level_enum lvl, size_t suppressed,
+                 const T& msg) {
+    log_sampled(logger, loc, lvl, suppressed, "{}", msg);
+}
+
+}   // namespace base
+}   // namespace learnlog
@@ -0,0 +1,299 @@
+#pragma once
+
+#include "definitions.h"
+#include "base/exception.h"
+#include "base/os.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+
+namespace learnlog {
+namespace base {
+
+// 通过内存映射只追加写入的文件，只支持 unix，
+// 文件按 chunk_size（向上取整为页大小的整数倍）分块预分配（fallocate / ftruncate）并映射，
+// 写入只是把数据复制到映射区域，不需要系统调用，数据写入后即位于页缓存中，进程崩溃也不会丢失；
+// 后台线程提前预分配并映射下一块，写满的块交给后台线程解除映射，写入线程只在切换块时短暂加锁；
+// 关闭文件时把文件截断为实际写入的长度，
+// 打开已有文件追加写入时，先去掉上次未正常关闭时遗留在末尾的预分配部分（'\0'）；
+// Linux 以外的平台只用 ftruncate 扩展文件，得到的是稀疏文件，磁盘空间不足时写入映射区域会触发 SIGBUS，
+// 这些平台上需要保证磁盘空间充足，或者改用 basic_file_sink；
+// 不是线程安全的，由 sink 加锁保护
+class mmap_file {
+public:
+    explicit mmap_file(size_t chunk_size) : chunk_size_(round_to_page_(chunk_size)) {}
+
+    // 析构时解除映射、截断并关闭文件，忽略失败
+    ~mmap_file() {
+        if (fd_ != -1) {
+            close_(false);
+        }
+    }
+
+    mmap_file(const mmap_file&) = delete;
+    mmap_file& operator=(const mmap_file&) = delete;
+
+    // 打开文件，首先关闭已有文件，打开文件前先创建父级目录
+    void open(const filename_t& fname, bool truncate = false) {
+        close();
+        fname_ = fname;
+        os::create_dir(os::get_dir(fname_));
+        int flags = O_CREAT | O_RDWR | O_CLOEXEC;
+        if (truncate) flags |= O_TRUNC;
+        fd_ = ::open(fname_.c_str(), flags, mode_t(0644));
+        if (fd_ == -1) {
+            throw_error_("open");
+        }
+
+        try {
+            pos_ = data_end_();
+            u_long_long first = pos_ / chunk_size_ * chunk_size_;
+            cur_ = map_chunk_(first);
+            next_offset_ = first + chunk_size_;
+        }
+        catch (...) {
+            ::close(fd_);
+            fd_ = -1;
+            throw;
+        }
+
+        stop_ = false;
+        next_ready_ = false;
+        mapper_error_ = 0;
+        mapper_ = std::thread([this]() { mapper_loop_(); });
+    }
+
+    // 解除映射，把文件截断为实际写入的长度后关闭
+    void close() {
+        if (fd_ != -1 && !close_(true)) {
+            throw_error_("close");
+        }
+    }
+
+    void write(const char* data, size_t size) {
+        if (fd_ == -1) return;
+
+        while (size > 0) {
+            size_t used = static_cast<size_t>(pos_ - cur_.offset);
+            size_t n = std::min(size, chunk_size_ - used);
+            std::memcpy(cur_.addr + used, data, n);
+            pos_ += n;
+            data += n;
+            size -= n;
+            if (n == chunk_size_ - used) {
+                switch_chunk_();
+            }
+        }
+    }
+
+    // 把当前块中已写入的数据与文件元数据写入磁盘
+    void sync() {
+        if (fd_ == -1) return;
+        if (::msync(cur_.addr, chunk_size_, MS_SYNC) != 0 || ::fsync(fd_) != 0) {
+            throw_error_("sync");
+        }
+    }
+
+    // 实际写入的长度，不包括预分配的部分
+    u_long_long size() const { return pos_; }
+    size_t chunk_size() const { return chunk_size_; }
+    bool is_open() const { return fd_ != -1; }
+    const filename_t& filename() const { return fname_; }
+
+private:
+    struct chunk {
+        char* addr{nullptr};
+        u_long_long offset{0};
+    };
+
+    static size_t round_to_page_(size_t size) {
+        size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        size = std::max(size, page);
+        return (size + page - 1) / page * page;
+    }
+
+    // 文件中有效数据的结尾：跳过末尾连续的 '\0'（上次未正常关闭时遗留的预分配部分）
+    u_long_long data_end_() {
+        long_long file_size = os::fd_filesize(fd_);
+        if (file_size == -1) {
+            throw_error_("open");
+        }
+        u_long_long end = static_cast<u_long_long>(file_size);
+        char block[4096];
+        while (end > 0) {
+            size_t n = static_cast<size_t>(std::min<u_long_long>(end, sizeof(block)));
+            if (::pread(fd_, block, n, static_cast<off_t>(end - n)) != static_cast<ssize_t>(n)) {
+                throw_error_("open");
+            }
+            size_t i = n;
+            while (i > 0 && block[i - 1] == '\0') {
+                --i;
+            }
+            if (i > 0) {
+                return end - n + i;
+            }
+            end -= n;
+        }
+        return 0;
+    }
+
+    // 预分配 [offset, offset + chunk_size_) 并映射，失败时抛出异常
+    chunk map_chunk_(u_long_long offset) {
+        chunk c;
+        int err = prepare_chunk_(offset, c);
+        if (err != 0) {
+            errno = err;
+            throw_error_("map");
+        }
+        return c;
+    }
+
+    // 返回 0 表示成功，否则返回 errno，映射结果写入 out
+    int prepare_chunk_(u_long_long offset, chunk& out) {
+        u_long_long end = offset + chunk_size_;
+        long_long file_size = os::fd_filesize(fd_);
+        if (file_size == -1) return errno;
+        if (static_cast<u_long_long>(file_size) < end) {
+#if defined(__linux__)
+            int ret = 0;
+            do {
+                ret = ::posix_fallocate(fd_, static_cast<off_t>(offset),
+                                        static_cast<off_t>(chunk_size_));
+            } while (ret == EINTR);
+            // 只在文件系统不支持 fallocate 时退回 ftruncate；
+            // 磁盘空间不足等错误直接返回，否则写入没有分配磁盘空间的映射区域会触发 SIGBUS
+            if (ret == EOPNOTSUPP || ret == EINVAL) {
+                if (::ftruncate(fd_, static_cast<off_t>(end)) != 0) return errno;
+            }
+            else if (ret != 0) {
+                return ret;
+            }
+#else
+            if (::ftruncate(fd_, static_cast<off_t>(end)) != 0) return errno;
+#endif
+        }
+        void* addr = ::mmap(nullptr, chunk_size_, PROT_READ | PROT_WRITE, MAP_SHARED,
+                            fd_, static_cast<off_t>(offset));
+        if (addr == MAP_FAILED) return errno;
+
+        out.addr = static_cast<char*>(addr);
+        out.offset = offset;
+        return 0;
+    }
+
+    // 当前块写满，换用后台线程准备好的下一块，当前块交给后台线程解除映射
+    void switch_chunk_() {
+        std::unique_lock<std::mutex> lock(mapper_mutex_);
+        mapper_cv_.wait(lock, [this]() { return next_ready_ || mapper_error_ != 0; });
+        if (!next_ready_) {
+            // 下一次切换时让后台线程重试
+            errno = mapper_error_;
+            mapper_error_ = 0;
+            lock.unlock();
+            mapper_cv_.notify_all();
+            throw_error_("map");
+        }
+        retired_.push_back(cur_);
+        cur_ = next_;
+        next_ready_ = false;
+        lock.unlock();
+        mapper_cv_.notify_all();
+    }
+
+    void mapper_loop_() {
+        std::unique_lock<std::mutex> lock(mapper_mutex_);
+        while (true) {
+            mapper_cv_.wait(lock, [this]() {
+                return stop_ || !retired_.empty() || (!next_ready_ && mapper_error_ == 0);
+            });
+            if (stop_) {
+                break;
+            }
+
+            std::vector<chunk> retired;
+            retired.swap(retired_);
+            bool need_next = !next_ready_ && mapper_error_ == 0;
+            u_long_long offset = next_offset_;
+            lock.unlock();
+
+            for (auto& c : retired) {
+                ::munmap(c.addr, chunk_size_);
+            }
+            chunk next;
+            int err = need_next ? prepare_chunk_(offset, next) : 0;
+
+            lock.lock();
+            if (need_next) {
+                if (err == 0) {
+                    next_ = next;
+                    next_ready_ = true;
+                    next_offset_ += chunk_size_;
+                }
+                else {
+                    mapper_error_ = err;
+                }
+                mapper_cv_.notify_all();
+            }
+        }
+    }
+
+    bool close_(bool check) {
+        {
+            std::lock_guard<std::mutex> lock(mapper_mutex_);
+            stop_ = true;
+        }
+        mapper_cv_.notify_all();
+        if (mapper_.joinable()) {
+            mapper_.join();
+        }
+
+        bool ok = true;
+        ok = (::munmap(cur_.addr, chunk_size_) == 0) && ok;
+        if (next_ready_) {
+            ok = (::munmap(next_.addr, chunk_size_) == 0) && ok;
+            next_ready_ = false;
+        }
+        for (auto& c : retired_) {
+            ok = (::munmap(c.addr, chunk_size_) == 0) && ok;
+        }
+        retired_.clear();
+        ok = (::ftruncate(fd_, static_cast<off_t>(pos_)) == 0) && ok;
+        ok = (::close(fd_) == 0) && ok;
+        fd_ = -1;
+        return ok || !check;
+    }
+
+    void throw_error_(const char* op) const {
+        source_loc loc{__FILE__, __LINE__, __func__};
+        std::string fname_str(fname_.begin(), fname_.end());
+        std::string err_str = fmt::format("learnlog::mmap_file::{}() failed, filename: '{}'",
+                                          op, fname_str);
+        throw_learnlog_excpt(err_str, os::get_errno(), loc);
+    }
+
+    const size_t chunk_size_;
+    int fd_{-1};
+    filename_t fname_;
+    u_long_long pos_{0};            // 下一个写入位置（文件偏移）
+    chunk cur_;                     // 正在写入的块
+
+    // 以下由 mapper_mutex_ 保护，与后台线程共享
+    std::thread mapper_;
+    std::mutex mapper_mutex_;
+    std::condition_variable mapper_cv_;
+    chunk next_;                    // 后台线程准备好的下一块
+    bool next_ready_{false};
+    u_long_long next_offset_{0};    // 下一块的文件偏移
+    std::vector<chunk> retired_;    // 写满、等待解除映射的块
+    int mapper_error_{0};
+    bool stop_{false};
+};
+
+}   // namespace base
+}   // namespace learnlog
@@ -9,10 +9,13 @@
 #include <thread>
 #include <ctime>
 #include <array>
+#include <vector>
 
 #ifdef _WIN32
     #include "win.h"
     #include "io.h"
+    #include <fcntl.h>
+    #include <share.h>
 
     #ifdef __MINGW32__
         #include <share.h>
@@ -21,9 +24,14 @@
 #else  // unix
     #include <fcntl.h>
     #include <unistd.h>
+    #include <sys/uio.h>
+    #include <cerrno>
 
     #ifdef __linux__
         #include <sys/syscall.h>  //gettid() syscall
+        #include <pthread.h>
+        #include <sched.h>
+        #include <sys/resource.h>
     #endif
 
 #endif
@@ -53,6 +61,65 @@ inline std::tm time_point_to_tm(const sys_clock::time_point& tp) noexcept {
     return _time_t_to_tm(time_point_to_time_t(tp));
 }
 
+// 本地时间 tm（由 time_tt 转换得到）相对 UTC 的偏移，单位为秒
+inline long utc_offset_secs(const std::tm& tm, const std::time_t& time_tt) noexcept {
+#ifdef _WIN32
+    std::tm local_tm = tm;
+    return static_cast<long>(::_mkgmtime(&local_tm) - time_tt);
+#else
+    (void)time_tt;
+    return static_cast<long>(tm.tm_gmtoff);
+#endif
+}
+
+// 将 time_tt 换算为相对 UTC 偏移 offset_secs 秒的日期时间，offset_secs 为 0 时即 UTC；
+// 日历换算使用 civil_from_days 算法（Howard Hinnant），只有整数运算，
+// 不调用 localtime_r() / gmtime_r()，不获取时区锁，也不受运行时修改 TZ 的影响
+inline std::tm time_t_to_tm_offset(const std::time_t& time_tt, long offset_secs) noexcept {
+    const int64_t secs_per_day = 86400;
+    int64_t local_secs = static_cast<int64_t>(time_tt) + offset_secs;
+    int64_t days = local_secs / secs_per_day;
+    int64_t day_secs = local_secs % secs_per_day;
+    if (day_secs < 0) {
+        day_secs += secs_per_day;
+        --days;
+    }
+
+    // 以 0000-03-01 为起点，每 400 年（146097 天）为一个周期
+    int64_t z = days + 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    int64_t doe = z - era * 146097;                                     // [0, 146096]
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;  // [0, 399]
+    int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);              // 从 3 月 1 日起，[0, 365]
+    int64_t mp = (5 * doy + 2) / 153;                                   // 从 3 月起，[0, 11]
+    int64_t mday = doy - (153 * mp + 2) / 5 + 1;
+    int64_t month = mp < 10 ? mp + 3 : mp - 9;                          // [1, 12]
+    int64_t year = yoe + era * 400 + (month <= 2 ? 1 : 0);
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+
+    std::tm tm{};
+    tm.tm_year = static_cast<int>(year - 1900);
+    tm.tm_mon = static_cast<int>(month - 1);
+    tm.tm_mday = static_cast<int>(mday);
+    tm.tm_hour = static_cast<int>(day_secs / 3600);
+    tm.tm_min = static_cast<int>(day_secs % 3600 / 60);
+    tm.tm_sec = static_cast<int>(day_secs % 60);
+    // 1970-01-01 为星期四
+    tm.tm_wday = static_cast<int>(((days % 7) + 11) % 7);
+    tm.tm_yday = static_cast<int>(doy >= 306 ? doy - 306 : doy + 59 + (leap ? 1 : 0));
+    tm.tm_isdst = 0;
+#ifndef _WIN32
+    tm.tm_gmtoff = offset_secs;
+#endif
+    return tm;
+}
+
+// 当前本地时间相对 UTC 的偏移，单位为秒
+inline long current_utc_offset_secs() noexcept {
+    std::time_t now_tt = std::time(nullptr);
+    return utc_offset_secs(_time_t_to_tm(now_tt), now_tt);
+}
+
 inline void time_point_to_datetime_sec(char* dt_buf, size_t buf_len, const sys_clock::time_point& tp) noexcept {
     std::tm tm = time_point_to_tm(tp);
     std::strftime(dt_buf, buf_len, "%Y-%m-%d %H:%M:%S", &tm);
@@ -78,7 +145,7 @@ inline void sleep_for_ms(size_t ms) noexcept {
 #ifdef _WIN32
     ::Sleep(static_cast<DWORD>(ms));
 #else
-    std::this_thread::sleep_for(microseconds{ms});
+    std::this_thread::sleep_for(milliseconds{ms});
 #endif
 }
 
@@ -154,6 +221,17 @@ inline size_t thread_id() noexcept {
 #endif 
 }
 
+// 自旋等待时调用，提示 cpu 当前处于忙等待，降低功耗并把流水线让给同一核心的其他超线程
+inline void cpu_relax() noexcept {
+#ifdef _WIN32
+    YieldProcessor();
+#elif defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
 inline int get_errno() noexcept {
 #ifdef _WIN32
     return static_cast<int>(::GetLastError());
@@ -164,6 +242,69 @@ inline int get_errno() noexcept {
 
 // ====================================id===========================================
 
+// ====================================thread=======================================
+
+// 以下函数只作用于调用线程，成功返回 true，平台不支持或调用失败返回 false
+
+// 线程名超出平台限制（Linux 为 15 个字符）时截断
+inline bool set_thread_name(const std::string& name) noexcept {
+#if defined(__linux__)
+    std::string truncated = name.substr(0, 15);
+    return ::pthread_setname_np(::pthread_self(), truncated.c_str()) == 0;
+#else
+    (void)name;
+    return false;
+#endif
+}
+
+inline bool set_thread_affinity(const std::vector<size_t>& cpus) noexcept {
+#ifdef _WIN32
+    DWORD_PTR mask = 0;
+    for (size_t cpu : cpus) {
+        if (cpu < sizeof(DWORD_PTR) * 8) { mask |= static_cast<DWORD_PTR>(1) << cpu; }
+    }
+    return mask != 0 && ::SetThreadAffinityMask(::GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (size_t cpu : cpus) {
+        if (cpu < CPU_SETSIZE) { CPU_SET(cpu, &cpu_set); }
+    }
+    return CPU_COUNT(&cpu_set) != 0 &&
+           ::pthread_setaffinity_np(::pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+// Linux 下 nice 值对单个线程生效，Windows 下按正负映射为低于、高于普通的线程优先级
+inline bool set_thread_nice(int nice) noexcept {
+#ifdef _WIN32
+    int priority = nice > 0 ? THREAD_PRIORITY_BELOW_NORMAL :
+                   nice < 0 ? THREAD_PRIORITY_ABOVE_NORMAL : THREAD_PRIORITY_NORMAL;
+    return ::SetThreadPriority(::GetCurrentThread(), priority) != 0;
+#elif defined(__linux__)
+    return ::setpriority(PRIO_PROCESS, static_cast<id_t>(os::_thread_id()), nice) == 0;
+#else
+    (void)nice;
+    return false;
+#endif
+}
+
+// 使用 SCHED_BATCH 调度策略：调度器视为 cpu 密集型线程，减少其抢占其他线程的机会，只在 Linux 下支持
+inline bool set_thread_sched_batch() noexcept {
+#if defined(__linux__)
+    struct sched_param param;
+    param.sched_priority = 0;
+    return ::sched_setscheduler(0, SCHED_BATCH, &param) == 0;
+#else
+    return false;
+#endif
+}
+
+// ====================================thread=======================================
+
 // ====================================file=========================================
 
 // 判断路径（目录或文件）是否存在
@@ -306,6 +447,102 @@ inline bool fsync(FILE* fp) {
 #endif
 }
 
+// 以下函数直接操作文件描述符，绕过 FILE* 的缓冲区
+
+// 以追加模式打开文件描述符，保存到 *fd，truncate 为 true 时清空已有内容，
+// 禁止子进程直接继承父进程的 fd，成功返回 true
+inline bool open_fd(int* fd, const filename_t& filename, bool truncate) {
+#ifdef _WIN32
+    int flags = _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY | _O_NOINHERIT;
+    if (truncate) flags |= _O_TRUNC;
+    return ::_wsopen_s(fd, filename.c_str(), flags, _SH_DENYNO, _S_IREAD | _S_IWRITE) == 0;
+#else
+    int flags = O_CREAT | O_WRONLY | O_APPEND | O_CLOEXEC;
+    if (truncate) flags |= O_TRUNC;
+    *fd = ::open(filename.c_str(), flags, mode_t(0644));
+    return *fd != -1;
+#endif
+}
+
+inline bool close_fd(int fd) {
+#ifdef _WIN32
+    return ::_close(fd) == 0;
+#else
+    return ::close(fd) == 0;
+#endif
+}
+
+// 写入 [data, data + size)，部分写入或被信号中断时继续写入剩余部分，失败返回 false
+inline bool write_fd(int fd, const char* data, size_t size) {
+    while (size > 0) {
+#ifdef _WIN32
+        unsigned int chunk = size > 0x40000000 ? 0x40000000u : static_cast<unsigned int>(size);
+        int ret = ::_write(fd, data, chunk);
+        if (ret < 0) return false;
+#else
+        ssize_t ret = ::write(fd, data, size);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+#endif
+        data += ret;
+        size -= static_cast<size_t>(ret);
+    }
+    return true;
+}
+
+// 依次写入 [data1, data1 + size1) 与 [data2, data2 + size2)，
+// unix 下以一次 writev() 完成，部分写入时对剩余部分继续写入，失败返回 false
+inline bool writev_fd(int fd, const char* data1, size_t size1, const char* data2, size_t size2) {
+#ifdef _WIN32
+    return write_fd(fd, data1, size1) && write_fd(fd, data2, size2);
+#else
+    while (size1 > 0) {
+        struct iovec iov[2];
+        iov[0].iov_base = const_cast<char*>(data1);
+        iov[0].iov_len = size1;
+        iov[1].iov_base = const_cast<char*>(data2);
+        iov[1].iov_len = size2;
+        ssize_t ret = ::writev(fd, iov, 2);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        size_t written = static_cast<size_t>(ret);
+        if (written >= size1) {
+            written -= size1;
+            return write_fd(fd, data2 + written, size2 - written);
+        }
+        data1 += written;
+        size1 -= written;
+    }
+    return write_fd(fd, data2, size2);
+#endif
+}
+
+// 获取文件大小（字节），获取失败返回 -1
+inline long_long fd_filesize(int fd) {
+#ifdef _WIN32
+    long long ret = ::_filelengthi64(fd);
+    return ret >= 0 ? ret : -1;
+#else
+    struct stat buf;
+    if (::fstat(fd, &buf) == 0) {
+        return static_cast<long_long>(buf.st_size);
+    }
+    return -1;
+#endif
+}
+
+inline bool fsync_fd(int fd) {
+#ifdef _WIN32
+    return FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(fd))) != 0;
+#else
+    return ::fsync(fd) == 0;
+#endif
+}
+
 // ====================================file=========================================
 
 }   // namespace os
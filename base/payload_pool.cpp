@@ -0,0 +1,44 @@
+#include "base/payload_pool.h"
+
+using namespace learnlog;
+using namespace base;
+
+payload_pool::~payload_pool() {
+    char* block = nullptr;
+    for (size_t i = 0; i < class_num; ++i) {
+        while (free_lists_[i].try_dequeue(block)) {
+            delete[] block;
+        }
+    }
+}
+
+char* payload_pool::allocate(size_t n) {
+    size_t idx = class_index_(n);
+    if (idx == class_num) {
+        miss_cnt_.fetch_add(1, std::memory_order_relaxed);
+        return new char[n];
+    }
+
+    char* block = nullptr;
+    if (free_lists_[idx].try_dequeue(block)) {
+        cached_cnts_[idx].fetch_sub(1, std::memory_order_relaxed);
+        hit_cnt_.fetch_add(1, std::memory_order_relaxed);
+        return block;
+    }
+    miss_cnt_.fetch_add(1, std::memory_order_relaxed);
+    return new char[min_class_size << idx];
+}
+
+// fmt::basic_memory_buffer 归还内存时传入的 n 与申请时相同，因此落在同一等级
+void payload_pool::deallocate(char* p, size_t n) {
+    size_t idx = class_index_(n);
+    if (idx < class_num &&
+        cached_cnts_[idx].load(std::memory_order_relaxed) < max_cached_bytes / (min_class_size << idx)) {
+        cached_cnts_[idx].fetch_add(1, std::memory_order_relaxed);
+        if (free_lists_[idx].enqueue(p)) {
+            return;
+        }
+        cached_cnts_[idx].fetch_sub(1, std::memory_order_relaxed);
+    }
+    delete[] p;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "concurrentqueue/concurrentqueue.h"
+
+#include <atomic>
+#include <memory>
+
+namespace learnlog {
+namespace base {
+
+/*
+async_msg 超出内联缓冲区（250 字节）的消息内容使用的内存池，每个线程池一个，
+按 2 的幂划分大小等级（512B ~ 64KB），每个等级一个无锁空闲链表 ConcurrentQueue<char*>，
+生产者入队时从空闲链表取内存块（命中），空闲链表为空时才 new（未命中），
+后台线程处理完消息后把内存块归还到空闲链表，达到缓存上限或超过最大等级的内存块直接 delete
+*/
+
+class payload_pool {
+public:
+    static const size_t min_class_size = 512;
+    static const size_t class_num = 8;
+    static const size_t max_class_size = min_class_size << (class_num - 1);
+    static const size_t max_cached_bytes = 1024 * 1024;     // 每个等级最多缓存的字节数
+
+    payload_pool() = default;
+    ~payload_pool();
+
+    payload_pool(const payload_pool&) = delete;
+    payload_pool& operator=(const payload_pool&) = delete;
+
+    char* allocate(size_t n);
+    void deallocate(char* p, size_t n);
+
+    size_t hit_count() const { return hit_cnt_.load(std::memory_order_relaxed); }
+    size_t miss_count() const { return miss_cnt_.load(std::memory_order_relaxed); }
+    void reset_counts() {
+        hit_cnt_.store(0, std::memory_order_relaxed);
+        miss_cnt_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    // 返回 n 所属的等级，超过最大等级时返回 class_num
+    static size_t class_index_(size_t n) {
+        size_t idx = 0;
+        size_t class_size = min_class_size;
+        while (class_size < n && idx < class_num) {
+            class_size <<= 1;
+            ++idx;
+        }
+        return idx;
+    }
+
+    moodycamel::ConcurrentQueue<char*> free_lists_[class_num];
+    std::atomic<size_t> cached_cnts_[class_num]{};
+    std::atomic<size_t> hit_cnt_{0};
+    std::atomic<size_t> miss_cnt_{0};
+};
+
+// 供 fmt::basic_memory_buffer 使用的分配器，pool_ 为空时直接使用 new/delete
+class payload_allocator {
+public:
+    using value_type = char;
+
+    payload_allocator() = default;
+    explicit payload_allocator(payload_pool* pool) : pool_(pool) {}
+
+    char* allocate(size_t n) {
+        return pool_ != nullptr ? pool_->allocate(n) : std::allocator<char>().allocate(n);
+    }
+
+    void deallocate(char* p, size_t n) {
+        if (pool_ != nullptr) {
+            pool_->deallocate(p, n);
+        }
+        else {
+            std::allocator<char>().deallocate(p, n);
+        }
+    }
+
+    bool operator==(const payload_allocator& other) const { return pool_ == other.pool_; }
+    bool operator!=(const payload_allocator& other) const { return pool_ != other.pool_; }
+
+private:
+    payload_pool* pool_{nullptr};
+};
+
+}   // namespace base
+}   // namespace learnlog
@@ -50,9 +50,12 @@ public:
         global_flusher_ = learnlog::make_unique<periodic_function>(func, interval);
     }
 
-    template <typename Threadpool>
-    void initialize_thread_pool(size_t msg_queue_size, size_t thread_num) {
-        auto tp = std::make_shared<Threadpool>(msg_queue_size, thread_num);
+    template <typename Threadpool, typename... PoolArgs>
+    void initialize_thread_pool(size_t msg_queue_size, size_t thread_num,
+                                const worker_options& opts = worker_options(),
+                                PoolArgs&&... pool_args) {
+        auto tp = std::make_shared<Threadpool>(msg_queue_size, thread_num, opts,
+                                               std::forward<PoolArgs>(pool_args)...);
         register_thread_pool(std::move(tp));
     }
     
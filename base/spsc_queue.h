@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+namespace learnlog {
+namespace base {
+
+/*
+单生产者、单消费者的无锁环形队列，容量向上取整为 2 的幂，初始化后不再申请内存，
+生产者只写 tail_，消费者只写 head_，入队、出队都是 wait-free 的；
+双方各自缓存对方的下标，只在缓存的下标显示队满（队空）时才重新读取对方的原子变量，
+head_ 与 tail_ 之间用填充隔开，避免伪共享
+*/
+
+template <typename T>
+class spsc_queue
+{
+public:
+    using value_type = T;
+
+    explicit spsc_queue(size_t max_items)
+        : mask_(round_up_pow2_(max_items) - 1),
+          slots_(new T[mask_ + 1]) {}
+
+    spsc_queue(const spsc_queue &) = delete;
+    spsc_queue& operator=(const spsc_queue &) = delete;
+
+    // 只能由生产者调用，队满时返回 false
+    bool try_enqueue(T &&item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ > mask_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ > mask_) {
+                return false;
+            }
+        }
+        slots_[tail & mask_] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 只能由消费者调用，至多取出 max_items 个元素，返回实际出队个数
+    size_t try_dequeue_bulk(T* items, size_t max_items) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (cached_tail_ == head) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (cached_tail_ == head) {
+                return 0;
+            }
+        }
+        size_t cnt = (std::min)(cached_tail_ - head, max_items);
+        for (size_t i = 0; i < cnt; ++i) {
+            items[i] = std::move(slots_[(head + i) & mask_]);
+        }
+        head_.store(head + cnt, std::memory_order_release);
+        return cnt;
+    }
+
+    // 任意线程都可调用，结果只是近似值
+    size_t size_approx() const {
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        return tail - head;
+    }
+
+    bool empty() const { return size_approx() == 0; }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    static size_t round_up_pow2_(size_t n) {
+        size_t cap = 2;
+        while (cap < n) {
+            cap <<= 1;
+        }
+        return cap;
+    }
+
+    static const size_t cacheline_size = 64;
+
+    const size_t mask_;
+    std::unique_ptr<T[]> slots_;
+    char pad0_[cacheline_size];
+
+    std::atomic<size_t> head_{0};       // 消费者写
+    size_t cached_tail_{0};             // 消费者读到的 tail_
+    char pad1_[cacheline_size];
+
+    std::atomic<size_t> tail_{0};       // 生产者写
+    size_t cached_head_{0};             // 生产者读到的 head_
+    char pad2_[cacheline_size];
+};
+
+}   // namespace base
+}   // namespace learnlog
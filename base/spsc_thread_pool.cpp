@@ -0,0 +1,158 @@
+#include "base/spsc_thread_pool.h"
+
+using namespace learnlog;
+using namespace base;
+
+std::atomic<size_t> spsc_thread_pool::pool_cnt_{0};
+
+#ifdef LEARNLOG_USE_TLS
+    thread_local spsc_thread_pool::producer_queues_holder spsc_thread_pool::holder_;
+    thread_local producer_queue* spsc_thread_pool::cached_queue_ = nullptr;
+    thread_local size_t spsc_thread_pool::cached_pool_id_ = 0;
+    thread_local spsc_consumer* spsc_thread_pool::consumer_ = nullptr;
+#endif
+
+// 同一线程可能先后向多个线程池提交消息，缓存的队列只对 pool_id_ 相同的线程池有效
+producer_queue* spsc_thread_pool::producer_queue_() {
+#ifdef LEARNLOG_USE_TLS
+    if (cached_pool_id_ == pool_id_) {
+        return cached_queue_;
+    }
+    producer_queue* pq = nullptr;
+    auto &queues = holder_.queues;
+    for (auto &entry : queues) {
+        if (entry.first == pool_id_) {
+            pq = entry.second.get();
+            break;
+        }
+    }
+    if (pq == nullptr) {
+        // 只被当前线程引用的队列所属的线程池已经析构
+        queues.erase(std::remove_if(queues.begin(), queues.end(),
+                         [](const std::pair<size_t, std::shared_ptr<producer_queue>>& entry) {
+                             return entry.second.use_count() == 1;
+                         }),
+                     queues.end());
+        queues.emplace_back(pool_id_, register_producer_());
+        pq = queues.back().second.get();
+    }
+    cached_pool_id_ = pool_id_;
+    cached_queue_ = pq;
+    return pq;
+#else
+    size_t tid = os::thread_id();
+    std::lock_guard<std::mutex> lock(p_mutex_);
+    auto it = producer_queues_.find(tid);
+    if (it == producer_queues_.end()) {
+        it = producer_queues_.emplace(tid, register_producer_()).first;
+    }
+    return it->second.get();
+#endif
+}
+
+std::shared_ptr<producer_queue> spsc_thread_pool::register_producer_() {
+    size_t idx = producer_cnt_.fetch_add(1, std::memory_order_relaxed) % threads_num_;
+    auto pq = std::make_shared<producer_queue>(msg_q_size_, idx);
+    spsc_consumer* consumer = consumers_[idx].get();
+    {
+        std::lock_guard<std::mutex> lock(consumer->mutex_);
+        consumer->queues_.push_back(pq);
+        consumer->version_.fetch_add(1, std::memory_order_release);
+    }
+    return pq;
+}
+
+// 队列全部为空时先自旋 spin_times_ 次，仍然为空则登记为阻塞，登记后再检查一次，
+// 避免生产者在登记前入队而错过唤醒；
+// 线程池析构时，取完所有队列中的消息后返回 1 条 terminate 消息
+size_t spsc_thread_pool::dequeue_async_msgs_(async_msg* amsgs, size_t max_num) {
+    spsc_consumer* consumer = nullptr;
+#ifdef LEARNLOG_USE_TLS
+    consumer = consumer_;
+#else
+    {
+        std::lock_guard<std::mutex> lock(c_mutex_);
+        consumer = consumer_map_[os::thread_id()];
+    }
+#endif
+    size_t cnt = sweep_(consumer, amsgs, max_num);
+    if (cnt > 0) {
+        return cnt;
+    }
+
+    if (stopping_.load(std::memory_order_seq_cst)) {
+        refresh_queues_(consumer);
+        cnt = sweep_(consumer, amsgs, max_num);
+        if (cnt == 0) {
+            amsgs[0] = async_msg(async_msg_type::terminate);
+            cnt = 1;
+        }
+        return cnt;
+    }
+
+    for (size_t i = 0; i < spin_times_; ++i) {
+        cnt = sweep_(consumer, amsgs, max_num);
+        if (cnt > 0) {
+            return cnt;
+        }
+        os::cpu_relax();
+    }
+
+    consumer->parked_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    cnt = sweep_(consumer, amsgs, max_num);
+    if (cnt == 0 && !stopping_.load(std::memory_order_seq_cst)) {
+        consumer->sema_.wait();
+        cnt = sweep_(consumer, amsgs, max_num);
+    }
+    consumer->parked_.store(false, std::memory_order_relaxed);
+    return cnt;
+}
+
+// 先读 closed_ 再出队：读到 closed_ 后生产者的所有入队都可见，出队为空说明该队列不会再有消息
+size_t spsc_thread_pool::sweep_(spsc_consumer* consumer, async_msg* amsgs, size_t max_num) {
+    if (consumer->version_.load(std::memory_order_acquire) != consumer->local_version_) {
+        refresh_queues_(consumer);
+    }
+    auto &queues = consumer->local_queues_;
+    bool has_closed = false;
+    for (size_t i = 0; i < queues.size(); ++i) {
+        producer_queue* pq = queues[consumer->next_].get();
+        consumer->next_ = (consumer->next_ + 1) % queues.size();
+        bool closed = pq->closed_.load(std::memory_order_acquire);
+        size_t cnt = pq->q_.try_dequeue_bulk(amsgs, max_num);
+        if (cnt > 0) {
+            return cnt;
+        }
+        has_closed = has_closed || closed;
+    }
+    if (has_closed) {
+        prune_queues_(consumer);
+    }
+    return 0;
+}
+
+void spsc_thread_pool::refresh_queues_(spsc_consumer* consumer) {
+    std::lock_guard<std::mutex> lock(consumer->mutex_);
+    consumer->local_queues_ = consumer->queues_;
+    consumer->local_version_ = consumer->version_.load(std::memory_order_relaxed);
+    if (consumer->next_ >= consumer->local_queues_.size()) {
+        consumer->next_ = 0;
+    }
+}
+
+// 只由负责这些队列的后台线程调用，已注销且为空的队列不会再有消息，可以释放
+void spsc_thread_pool::prune_queues_(spsc_consumer* consumer) {
+    {
+        std::lock_guard<std::mutex> lock(consumer->mutex_);
+        auto &queues = consumer->queues_;
+        queues.erase(std::remove_if(queues.begin(), queues.end(),
+                         [](const std::shared_ptr<producer_queue>& pq) {
+                             return pq->closed_.load(std::memory_order_acquire) &&
+                                    pq->q_.empty();
+                         }),
+                     queues.end());
+        consumer->version_.fetch_add(1, std::memory_order_release);
+    }
+    refresh_queues_(consumer);
+}
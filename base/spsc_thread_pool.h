@@ -0,0 +1,202 @@
+#pragma once
+
+#include "base/thread_pool.h"
+#include "base/spsc_queue.h"
+#include "concurrentqueue/lightweightsemaphore.h"
+#include "async_logger.h"
+#include <unordered_map>
+
+namespace learnlog {
+namespace base {
+
+// 每个生产者队列的默认容量，队列初始化时一次性申请 queue_size 个 async_msg，
+// 1024 个约占 440KB（64 位 Linux），远小于其他线程池共用的 default_queue_size
+static const size_t default_spsc_queue_size = 1024;
+
+// 每个生产者线程独占的队列，只由 consumer_idx 对应的后台线程出队
+struct producer_queue {
+    spsc_queue<async_msg> q_;
+    const size_t consumer_idx_;
+    std::atomic<bool> closed_;      // 生产者线程已退出，不会再有消息入队
+
+    producer_queue(size_t queue_size, size_t consumer_idx)
+        : q_(queue_size),
+          consumer_idx_(consumer_idx),
+          closed_(false) {}
+};
+
+// 后台线程负责的所有生产者队列，
+// queues_ 由 mutex_ 保护，后台线程在 version_ 变化时把它复制到 local_queues_，之后无锁遍历
+struct spsc_consumer {
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<producer_queue>> queues_;
+    std::atomic<size_t> version_{0};
+    std::atomic<bool> parked_{false};   // 后台线程是否（即将）阻塞在 sema_ 上
+    moodycamel::LightweightSemaphore sema_;
+
+    std::vector<std::shared_ptr<producer_queue>> local_queues_;
+    size_t local_version_{0};
+    size_t next_{0};                    // 下一次从 local_queues_ 的哪个队列开始出队
+};
+
+// 每个生产者线程一个单生产者、单消费者队列 spsc_queue 的线程池，处理 async_msg，
+// 生产者线程第一次提交消息时登记自己的队列，按登记顺序轮流分配给后台线程，
+// 线程退出时注销，后台线程取完队列中剩余的消息后释放该队列；
+// 入队时不需要 CAS，也不会申请内存，队满时自旋等待；
+// 后台线程轮流从自己负责的队列中批量出队，全部为空时短暂自旋后阻塞，生产者只在后台线程阻塞时唤醒；
+// 每个队列只有一个后台线程出队，对于任意数量的后台线程，都能保证线程内日志有序；
+// queue_size 为每个生产者队列的容量（默认 default_spsc_queue_size），
+// 总占用空间约为 生产者线程数 × queue_size × sizeof(async_msg)，写日志的线程很多时应减小 queue_size
+
+class spsc_thread_pool final: public thread_pool {
+public:
+    spsc_thread_pool(size_t queue_size, size_t threads_num,
+                     const std::function<void()>& on_thread_start,
+                     const std::function<void()>& on_thread_stop,
+                     const worker_options& opts = worker_options())
+        : thread_pool(queue_size, spsc, threads_num, on_thread_start, on_thread_stop, opts) {
+        start_workers_();
+    }
+
+    spsc_thread_pool(size_t queue_size, size_t threads_num,
+                     const std::function<void()>& on_thread_start)
+        : thread_pool(queue_size, spsc, threads_num, on_thread_start, []{}) {
+        start_workers_();
+    }
+
+    spsc_thread_pool(size_t queue_size, size_t threads_num,
+                     const worker_options& opts)
+        : spsc_thread_pool(queue_size, threads_num, []{}, []{}, opts) {}
+
+    spsc_thread_pool(size_t queue_size = default_spsc_queue_size,
+                     size_t threads_num = default_threads_num)
+        : thread_pool(queue_size, spsc, threads_num, []{}, []{}) {
+        start_workers_();
+    }
+
+    ~spsc_thread_pool() override {
+        shutdown_(std::chrono::steady_clock::time_point::max(), shutdown_policy::drain, false);
+    }
+
+    size_t current_msg_count() {
+        size_t cnt = 0;
+        for (auto &consumer : consumers_) {
+            std::lock_guard<std::mutex> lock(consumer->mutex_);
+            for (auto &pq : consumer->queues_) {
+                cnt += pq->q_.size_approx();
+            }
+        }
+        return cnt;
+    }
+
+    // 当前登记的生产者队列个数（包括已注销但仍有消息未取完的队列）
+    size_t producer_count() {
+        size_t cnt = 0;
+        for (auto &consumer : consumers_) {
+            std::lock_guard<std::mutex> lock(consumer->mutex_);
+            cnt += consumer->queues_.size();
+        }
+        return cnt;
+    }
+
+private:
+    void start_workers_() {
+        for (size_t i = 0; i < threads_num_; ++i) {
+            consumers_.emplace_back(new spsc_consumer());
+        }
+        for (size_t i = 0; i < threads_num_; ++i) {
+            threads_.emplace_back([this, i] {
+                start_func_();
+#ifdef LEARNLOG_USE_TLS
+                consumer_ = consumers_[i].get();
+#else
+                {
+                    std::lock_guard<std::mutex> lock(c_mutex_);
+                    consumer_map_[os::thread_id()] = consumers_[i].get();
+                }
+#endif
+                this->thread_pool::worker_loop_();
+                stop_func_();
+            });
+        }
+    }
+
+    // 后台线程取完所有队列中的消息后退出
+    void terminate_workers_() override {
+        stopping_.store(true, std::memory_order_seq_cst);
+        for (auto &consumer : consumers_) {
+            consumer->sema_.signal();
+        }
+    }
+
+    void enqueue_async_msg_(async_msg&& amsg) override {
+        producer_queue* pq = producer_queue_();
+        if (!pq->q_.try_enqueue(std::move(amsg))) {
+            notify_consumer_(pq->consumer_idx_);
+            size_t spin_cnt = 0;
+            while (!pq->q_.try_enqueue(std::move(amsg))) {
+                if (++spin_cnt > spin_times_) {
+                    std::this_thread::yield();
+                }
+                else {
+                    os::cpu_relax();
+                }
+            }
+        }
+        notify_consumer_(pq->consumer_idx_);
+    }
+
+    producer_queue* producer_queue_();
+    std::shared_ptr<producer_queue> register_producer_();
+
+    // 与 dequeue_async_msgs_() 中先登记阻塞、再检查队列的顺序配对，
+    // seq_cst 栅栏保证二者至少一方看到对方
+    void notify_consumer_(size_t consumer_idx) {
+        spsc_consumer* consumer = consumers_[consumer_idx].get();
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (consumer->parked_.load(std::memory_order_relaxed) &&
+            consumer->parked_.exchange(false, std::memory_order_relaxed)) {
+            consumer->sema_.signal();
+        }
+    }
+
+    size_t dequeue_async_msgs_(async_msg* amsgs, size_t max_num) override;
+
+    // 从上次停下的位置开始轮流尝试每个队列，返回第一个非空队列的出队个数
+    size_t sweep_(spsc_consumer* consumer, async_msg* amsgs, size_t max_num);
+    void refresh_queues_(spsc_consumer* consumer);
+    void prune_queues_(spsc_consumer* consumer);
+
+    static const size_t spin_times_ = 1024;
+
+    std::vector<std::unique_ptr<spsc_consumer>> consumers_;
+    std::atomic<size_t> producer_cnt_{0};
+    std::atomic<bool> stopping_{false};
+
+    static std::atomic<size_t> pool_cnt_;
+    const size_t pool_id_{pool_cnt_.fetch_add(1, std::memory_order_relaxed) + 1};
+#ifdef LEARNLOG_USE_TLS
+    // 线程退出时析构，注销该线程在各个线程池中登记的队列
+    struct producer_queues_holder {
+        std::vector<std::pair<size_t, std::shared_ptr<producer_queue>>> queues;
+        ~producer_queues_holder() {
+            for (auto &pq : queues) {
+                pq.second->closed_.store(true, std::memory_order_release);
+            }
+        }
+    };
+    static thread_local producer_queues_holder holder_;
+    static thread_local producer_queue* cached_queue_;
+    static thread_local size_t cached_pool_id_;
+    static thread_local spsc_consumer* consumer_;
+#else
+    // 无法感知线程退出，登记的队列在线程池析构时才释放
+    std::mutex p_mutex_;
+    std::unordered_map<size_t, std::shared_ptr<producer_queue>> producer_queues_;
+    std::mutex c_mutex_;
+    std::unordered_map<size_t, spsc_consumer*> consumer_map_;
+#endif
+};
+
+}   // namespace base
+}   // namespace learnlog
@@ -1,19 +1,28 @@
 #include "base/thread_pool.h"
 #include "base/exception.h"
+#include "base/os.h"
 #include "async_logger.h"
 
+#include <algorithm>
+#include <chrono>
+
 using namespace learnlog;
 using namespace base;
 
 thread_pool::thread_pool(size_t queue_size, msg_queue_type q_type,
                          size_t threads_num, 
                          const std::function<void()>& on_thread_start,
-                         const std::function<void()>& on_thread_stop) :
+                         const std::function<void()>& on_thread_stop,
+                         const worker_options& opts) :
     msg_q_size_(queue_size),
     msg_q_type_(q_type),
     threads_num_(threads_num),
-    start_func_(on_thread_start),
-    stop_func_(on_thread_stop)
+    start_func_([this, on_thread_start] {
+        apply_worker_options_();
+        on_thread_start();
+    }),
+    stop_func_(on_thread_stop),
+    worker_opts_(opts)
 {
     if(threads_num_ <= 0 || threads_num_ > 1024) {
         std::string err_str = 
@@ -21,48 +30,515 @@ thread_pool::thread_pool(size_t queue_size, msg_queue_type q_type,
                         "(valid range is 1-1024)", threads_num_);
         throw_learnlog_excpt(err_str);
     }
+    slot_chunks_[0].reset(new logger_slot[first_slot_chunk_size]);
 }
 
-void thread_pool::enqueue_log(async_logger_shr_ptr&& logger,
-                              const log_msg& msg) {
-    async_msg amsg(std::move(logger), async_msg_type::log, msg);
-    enqueue_async_msg_(std::move(amsg));
+void thread_pool::apply_worker_options_() {
+    size_t idx = started_workers_.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(loggers_mutex_);
+        worker_ids_.push_back(std::this_thread::get_id());
+    }
+    std::string failed;
+    if (!worker_opts_.name.empty() &&
+        !os::set_thread_name(fmt::format("{}-{:d}", worker_opts_.name, idx))) {
+        failed += " name";
+    }
+    if (!worker_opts_.cpus.empty()) {
+        std::vector<size_t> cpus = worker_opts_.cpus;
+        if (worker_opts_.pin_per_worker) {
+            cpus.assign(1, worker_opts_.cpus[idx % worker_opts_.cpus.size()]);
+        }
+        if (!os::set_thread_affinity(cpus)) {
+            failed += " affinity";
+        }
+    }
+    if (worker_opts_.nice != 0 && !os::set_thread_nice(worker_opts_.nice)) {
+        failed += " nice";
+    }
+    if (worker_opts_.sched_batch && !os::set_thread_sched_batch()) {
+        failed += " sched_batch";
+    }
+    if (!failed.empty()) {
+        try {
+            std::string err_str = 
+                fmt::format("learnlog::thread_pool: failed to apply worker options"
+                            "{} on worker {:d}", failed, idx);
+            throw_learnlog_excpt(err_str);
+        }
+        LEARNLOG_CATCH
+    }
 }
 
-std::future<void> thread_pool::enqueue_flush(async_logger_shr_ptr&& logger) {
-    std::promise<void> promise;
-    std::future<void> future = promise.get_future();
-    async_msg amsg(std::move(logger), async_msg_type::flush, std::move(promise));
+bool thread_pool::is_worker_thread_() {
+    std::lock_guard<std::mutex> lock(loggers_mutex_);
+    return std::find(worker_ids_.begin(), worker_ids_.end(), std::this_thread::get_id()) !=
+           worker_ids_.end();
+}
+
+// 槽位用完时分配下一块，已分配的块不移动，后台线程持有的槽位引用始终有效；
+// 在后台线程中注销的句柄，消息全部处理完后才能复用
+size_t thread_pool::register_logger(async_logger* logger) {
+    std::lock_guard<std::mutex> lock(loggers_mutex_);
+    for (size_t handle = 0; handle < loggers_end_; ++handle) {
+        if (slot_(handle).logger.load(std::memory_order_relaxed) == logger) {
+            return handle;
+        }
+    }
+
+    for (auto it = retired_handles_.begin(); it != retired_handles_.end(); ) {
+        logger_slot& slot = slot_(*it);
+        if (slot.pending[0].load(std::memory_order_acquire) == 0 &&
+            slot.pending[1].load(std::memory_order_acquire) == 0) {
+            free_handles_.push_back(*it);
+            it = retired_handles_.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    size_t handle = 0;
+    if (!free_handles_.empty()) {
+        handle = free_handles_.back();
+        free_handles_.pop_back();
+    }
+    else {
+        handle = loggers_end_;
+        size_t chunk = slot_chunk_(handle);
+        if (chunk >= max_slot_chunks) {
+            throw_learnlog_excpt("learnlog::thread_pool::register_logger(): too many loggers");
+        }
+        if (slot_chunks_[chunk] == nullptr) {
+            slot_chunks_[chunk].reset(new logger_slot[first_slot_chunk_size << chunk]);
+        }
+        ++loggers_end_;
+    }
+    slot_(handle).logger.store(logger, std::memory_order_release);
+    return handle;
+}
+
+// logger 析构时调用，此时不会再有该 logger 的消息入队；
+// 先等待已提交的消息处理完，后台线程不会再访问该 logger，再回收句柄；
+// 在后台线程中等待会阻塞该线程自己要处理的消息，改为 retire_logger_()
+void thread_pool::deregister_logger(size_t logger_handle) {
+    if (is_worker_thread_()) {
+        retire_logger_(logger_handle);
+        return;
+    }
+    logger_slot& slot = slot_(logger_handle);
+    wait_pending_(slot.pending[0]);
+    wait_pending_(slot.pending[1]);
+
+    std::lock_guard<std::mutex> lock(loggers_mutex_);
+    slot.logger.store(nullptr, std::memory_order_relaxed);
+    free_handles_.push_back(logger_handle);
+}
+
+// 与后台线程先增加 users、再读取 logger 的顺序配对：
+// 要么后台线程读到 nullptr 并丢弃消息，要么这里等到它用完 logger
+void thread_pool::retire_logger_(size_t logger_handle) {
+    logger_slot& slot = slot_(logger_handle);
+    slot.logger.store(nullptr, std::memory_order_seq_cst);
+    while (slot.users.load(std::memory_order_seq_cst) != 0) {
+        std::this_thread::yield();
+    }
+    std::lock_guard<std::mutex> lock(loggers_mutex_);
+    retired_handles_.push_back(logger_handle);
+}
+
+size_t thread_pool::logger_count() {
+    std::lock_guard<std::mutex> lock(loggers_mutex_);
+    size_t cnt = 0;
+    for (size_t handle = 0; handle < loggers_end_; ++handle) {
+        if (slot_(handle).logger.load(std::memory_order_relaxed) != nullptr) { ++cnt; }
+    }
+    return cnt;
+}
+
+// 先读取纪元再增加对应的计数，之后重新读取纪元：
+// 纪元未变，则 flush 切换纪元之后一定能看到这次增加；纪元已变，撤销后按新纪元重试
+unsigned thread_pool::enter_epoch_(logger_slot& slot) {
+    for (;;) {
+        unsigned epoch = slot.epoch.load(std::memory_order_relaxed);
+        slot.pending[epoch & 1].fetch_add(1, std::memory_order_seq_cst);
+        if (slot.epoch.load(std::memory_order_seq_cst) == epoch) {
+            return epoch & 1;
+        }
+        slot.pending[epoch & 1].fetch_sub(1, std::memory_order_release);
+        notify_pending_waiters_();
+    }
+}
+
+// 计数通常很快降为 0，先让出 cpu 自旋 flush_spin_times 次，再阻塞
+void thread_pool::wait_pending_(const std::atomic<size_t>& pending) {
+    for (size_t i = 0; i < flush_spin_times; ++i) {
+        if (pending.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+    std::unique_lock<std::mutex> lock(pending_mutex_);
+    pending_waiters_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    pending_cv_.wait(lock, [this, &pending] {
+        return pending.load(std::memory_order_acquire) == 0 || workers_exited_;
+    });
+    pending_waiters_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+// 与等待者先登记、再检查 pending 的顺序配对，seq_cst 栅栏保证二者至少一方看到对方
+void thread_pool::notify_pending_waiters_() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (pending_waiters_.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending_cv_.notify_all();
+    }
+}
+
+void thread_pool::release_pending_(const std::vector<async_msg>& amsgs, size_t msg_cnt) {
+    size_t handle = invalid_logger_handle;
+    unsigned parity = 0;
+    size_t cnt = 0;
+    for (size_t i = 0; i < msg_cnt; ++i) {
+        if (amsgs[i].msg_type != async_msg_type::log) {
+            continue;
+        }
+        if (amsgs[i].logger_handle != handle || amsgs[i].epoch_parity != parity) {
+            if (cnt > 0) {
+                slot_(handle).pending[parity].fetch_sub(cnt, std::memory_order_release);
+            }
+            handle = amsgs[i].logger_handle;
+            parity = amsgs[i].epoch_parity;
+            cnt = 0;
+        }
+        ++cnt;
+    }
+    if (cnt == 0) {
+        return;
+    }
+    slot_(handle).pending[parity].fetch_sub(cnt, std::memory_order_release);
+    notify_pending_waiters_();
+}
+
+void thread_pool::drop_pending_(const async_msg& amsg) {
+    if (amsg.msg_type != async_msg_type::log) {
+        return;
+    }
+    slot_(amsg.logger_handle).pending[amsg.epoch_parity].fetch_sub(1, std::memory_order_release);
+    notify_pending_waiters_();
+}
+
+size_t thread_pool::pending_msg_count_() {
+    size_t cnt = 0;
+    size_t end = 0;
+    {
+        std::lock_guard<std::mutex> lock(loggers_mutex_);
+        end = loggers_end_;
+    }
+    for (size_t handle = 0; handle < end; ++handle) {
+        cnt += slot_(handle).pending[0].load(std::memory_order_acquire) +
+               slot_(handle).pending[1].load(std::memory_order_acquire);
+    }
+    return cnt;
+}
+
+// 先增加计数、再检查 stopped_，与 shutdown 先设置 stopped_、再检查计数的顺序配对：
+// 要么 shutdown 等待这条消息处理完，要么这里看到 stopped_ 并丢弃消息
+void thread_pool::enqueue_log(size_t logger_handle, const log_msg& msg) {
+    if (stopped_.load(std::memory_order_relaxed)) {
+        shutdown_discarded_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    async_msg amsg(logger_handle, async_msg_type::log, msg, 
+                   payload_allocator(&payload_pool_));
+    amsg.epoch_parity = enter_epoch_(slot_(logger_handle));
+    if (stopped_.load(std::memory_order_seq_cst)) {
+        shutdown_discarded_.fetch_add(1, std::memory_order_relaxed);
+        drop_pending_(amsg);
+        return;
+    }
     enqueue_async_msg_(std::move(amsg));
-    
-    return future;
 }
 
-bool thread_pool::process_async_msg_() {
-    async_msg msg_popped;
-    dequeue_async_msg_(msg_popped);
+// 多个线程提交的消息可能被不同的后台线程取走，或者在无锁队列中不按提交顺序出队，
+// 因此不依赖 flush 消息在队列中的位置：先切换纪元，等待切换前提交的消息全部输出，再提交 flush 消息；
+// 线程池已停止时返回 0，wait_flush(0) 立即返回；
+// 取得序号后才看到 stopped_ 时直接完成该序号，未看到时由 shutdown 在后台线程退出后完成
+std::uint64_t thread_pool::enqueue_flush(size_t logger_handle) {
+    if (stopped_.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+    logger_slot& slot = slot_(logger_handle);
+    {
+        std::lock_guard<std::mutex> lock(slot.flush_mutex);
+        unsigned epoch = slot.epoch.fetch_add(1, std::memory_order_seq_cst);
+        wait_pending_(slot.pending[epoch & 1]);
+    }
+    std::uint64_t ticket = flush_ticket_.fetch_add(1, std::memory_order_seq_cst) + 1;
+    if (stopped_.load(std::memory_order_seq_cst)) {
+        complete_flush_(ticket);
+        return ticket;
+    }
+    enqueue_async_msg_(async_msg(logger_handle, async_msg_type::flush, ticket));
+    return ticket;
+}
+
+// flush 通常在 sink 刷新后很快完成，先自旋避免线程切换，超过 flush_spin_times 次再阻塞
+void thread_pool::wait_flush(std::uint64_t ticket) {
+    for (size_t i = 0; i < flush_spin_times; ++i) {
+        if (flush_done_.load(std::memory_order_acquire) >= ticket) {
+            return;
+        }
+    }
+    std::unique_lock<std::mutex> lock(flush_mutex_);
+    ++flush_waiters_;
+    flush_cv_.wait(lock, [this, ticket] {
+        return flush_done_.load(std::memory_order_relaxed) >= ticket;
+    });
+    --flush_waiters_;
+}
+
+// 等待者在 flush_mutex_ 保护下登记，完成方持有同一把锁检查等待者，不会错过唤醒；
+// 不大于 flush_done_ 的序号已由 shutdown 统一完成，直接忽略
+void thread_pool::complete_flush_(std::uint64_t ticket) {
+    std::lock_guard<std::mutex> lock(flush_mutex_);
+    std::uint64_t done = flush_done_.load(std::memory_order_relaxed);
+    if (ticket <= done) {
+        return;
+    }
+    if (ticket != done + 1) {
+        flush_pending_.push_back(ticket);
+        return;
+    }
+    advance_flush_done_(ticket);
+}
+
+// shutdown 在后台线程退出后调用，不大于 ticket 的序号全部视为完成，
+// 其中包括未被处理的 flush 消息，以及看到 stopped_ 之前取得序号、尚未入队的 flush 消息
+void thread_pool::complete_flushes_upto_(std::uint64_t ticket) {
+    std::lock_guard<std::mutex> lock(flush_mutex_);
+    if (ticket <= flush_done_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    flush_pending_.erase(std::remove_if(flush_pending_.begin(), flush_pending_.end(),
+                                        [ticket](std::uint64_t t) { return t <= ticket; }),
+                         flush_pending_.end());
+    advance_flush_done_(ticket);
+}
+
+// 调用方持有 flush_mutex_，done 之后连续的暂存序号一并完成
+void thread_pool::advance_flush_done_(std::uint64_t done) {
+    for (auto it = std::find(flush_pending_.begin(), flush_pending_.end(), done + 1);
+         it != flush_pending_.end();
+         it = std::find(flush_pending_.begin(), flush_pending_.end(), done + 1)) {
+        flush_pending_.erase(it);
+        ++done;
+    }
+    flush_done_.store(done, std::memory_order_release);
+    if (flush_waiters_ > 0) {
+        flush_cv_.notify_all();
+    }
+}
+
+// 批量出队后按顺序处理，连续且属于同一 logger 的 log 消息合并为一批，交给 sink 一次性输出；
+// 同一批中可能取到多条 terminate 消息（例如 lock_thread_pool 有多个后台线程时），
+// 当前线程只消耗其中 1 条，其余重新入队，保证每个后台线程都能退出；
+// 使用 logger 期间增加所在槽位的 users，logger 已在后台线程中注销时丢弃它的消息
+bool thread_pool::process_async_msg_(std::vector<async_msg>& amsgs, size_t msg_cnt,
+                                     sink_batch_buffers& bufs) {
+    size_t terminate_cnt = 0;
+    logger_slot* batch_slot = nullptr;
+    async_logger* batch_logger = nullptr;
+    bool shutting_down = shutting_down_.load(std::memory_order_acquire);
+    bool discard_all = shutting_down && discard_all_.load(std::memory_order_relaxed);
+    int drop_level = shutting_down ? drop_level_.load(std::memory_order_relaxed) : -1;
+    size_t flushed_cnt = 0;
+    size_t discarded_cnt = 0;
 
-    switch (msg_popped.msg_type) {
-        case async_msg_type::log: {
-            msg_popped.logger->do_sink_log_(msg_popped);
-            return true;
+    std::vector<const log_msg*>& batch = bufs.batch;
+    auto sink_batch = [&bufs, &batch, &batch_slot, &batch_logger] {
+        if (!batch.empty()) {
+            batch_logger->do_sink_log_(batch.data(), batch.size(), bufs);
+            batch.clear();
         }
-        case async_msg_type::flush: {
-            msg_popped.logger->do_flush_sink_();
-            msg_popped.flush_promise.set_value();
-            return true;
+        if (batch_slot != nullptr) {
+            batch_slot->users.fetch_sub(1, std::memory_order_release);
+            batch_slot = nullptr;
+            batch_logger = nullptr;
         }
-        case async_msg_type::terminate: {
-            return false;
+    };
+    auto use_logger = [](logger_slot& slot) -> async_logger* {
+        slot.users.fetch_add(1, std::memory_order_seq_cst);
+        async_logger* logger = slot.logger.load(std::memory_order_seq_cst);
+        if (logger == nullptr) {
+            slot.users.fetch_sub(1, std::memory_order_release);
         }
-        default: {
-            assert(false);
+        return logger;
+    };
+
+    for (size_t i = 0; i < msg_cnt; ++i) {
+        async_msg& msg_popped = amsgs[i];
+        switch (msg_popped.msg_type) {
+            case async_msg_type::log: {
+                if (discard_all || static_cast<int>(msg_popped.level) <= drop_level) {
+                    ++discarded_cnt;
+                    break;
+                }
+                if (msg_popped.format_deferred != nullptr) {
+                    try { msg_popped.apply_deferred_format(); }
+                    LEARNLOG_CATCH
+                    if (msg_popped.format_deferred != nullptr) {
+                        break;      // 格式化失败，丢弃该消息
+                    }
+                }
+                logger_slot& slot = slot_(msg_popped.logger_handle);
+                if (&slot != batch_slot) {
+                    sink_batch();
+                    batch_logger = use_logger(slot);
+                    if (batch_logger == nullptr) {
+                        ++discarded_cnt;
+                        break;
+                    }
+                    batch_slot = &slot;
+                }
+                batch.push_back(&msg_popped);
+                ++flushed_cnt;
+                break;
+            }
+            case async_msg_type::flush: {
+                sink_batch();
+                logger_slot& slot = slot_(msg_popped.logger_handle);
+                async_logger* logger = use_logger(slot);
+                if (logger != nullptr) {
+                    logger->do_flush_sink_();
+                    slot.users.fetch_sub(1, std::memory_order_release);
+                }
+                complete_flush_(msg_popped.flush_ticket);
+                break;
+            }
+            case async_msg_type::terminate: {
+                sink_batch();
+                ++terminate_cnt;
+                break;
+            }
+            default: {
+                assert(false);
+            }
         }
     }
+    sink_batch();
+
+    if (shutting_down) {
+        shutdown_flushed_.fetch_add(flushed_cnt, std::memory_order_relaxed);
+        shutdown_discarded_.fetch_add(discarded_cnt, std::memory_order_relaxed);
+    }
 
-    return true;
+    for (size_t i = 1; i < terminate_cnt; ++i) {
+        enqueue_async_msg_(async_msg(async_msg_type::terminate));
+    }
+
+    return terminate_cnt == 0;
 }
 
 void thread_pool::worker_loop_() {
-    while( process_async_msg_() ) {}
-}
\ No newline at end of file
+    std::vector<async_msg> amsgs(default_batch_size);
+    sink_batch_buffers bufs;
+    bufs.batch.reserve(default_batch_size);
+    bufs.filtered.reserve(default_batch_size);
+    bufs.offsets.reserve(default_batch_size + 1);
+    bufs.views.reserve(default_batch_size);
+    bufs.filtered_views.reserve(default_batch_size);
+    for (;;) {
+        size_t msg_cnt = dequeue_async_msgs_(amsgs.data(), amsgs.size());
+        if (msg_cnt == 0) {
+            continue;
+        }
+        bool running = process_async_msg_(amsgs, msg_cnt, bufs);
+        release_pending_(amsgs, msg_cnt);
+        if (!running) {
+            break;
+        }
+    }
+}
+
+// 后台线程退出后调用，清零所有 logger 未处理的消息数并计入丢弃数，唤醒等待注销的线程
+void thread_pool::release_leftover_() {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    size_t end = 0;
+    {
+        std::lock_guard<std::mutex> loggers_lock(loggers_mutex_);
+        end = loggers_end_;
+    }
+    for (size_t handle = 0; handle < end; ++handle) {
+        for (auto &pending : slot_(handle).pending) {
+            shutdown_discarded_.fetch_add(pending.exchange(0, std::memory_order_acq_rel),
+                                          std::memory_order_relaxed);
+        }
+    }
+    workers_exited_ = true;
+    pending_cv_.notify_all();
+}
+
+// 先设置 stopped_，之后提交的消息被丢弃，再等待已提交的消息全部处理完，
+// 才通知后台线程退出，避免 terminate 消息先于其他消息被取走；
+// 超时后后台线程丢弃剩余的消息，仍然等到计数降为 0，正在入队的生产者因此不会阻塞在已满的队列上；
+// 等待期间每 1ms 检查一次，不占用 cpu；后台线程退出后完成所有已分配的 flush 序号
+shutdown_result thread_pool::shutdown_(std::chrono::steady_clock::time_point deadline,
+                                       shutdown_policy policy, bool flush_sinks) {
+    std::lock_guard<std::mutex> lock(shutdown_mutex_);
+    if (stopped_.load(std::memory_order_relaxed)) {
+        shutdown_result_.discarded_msgs = shutdown_discarded_.load(std::memory_order_relaxed);
+        return shutdown_result_;
+    }
+
+    shutdown_flushed_.store(0, std::memory_order_relaxed);
+    shutdown_discarded_.store(0, std::memory_order_relaxed);
+    if (policy == shutdown_policy::drop_low_levels) {
+        drop_level_.store(static_cast<int>(level::debug), std::memory_order_relaxed);
+    }
+    shutting_down_.store(true, std::memory_order_release);
+    stopped_.store(true, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    while (pending_msg_count_() != 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    bool timed_out = pending_msg_count_() != 0;
+    if (timed_out) {
+        discard_all_.store(true, std::memory_order_relaxed);
+        while (pending_msg_count_() != 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    terminate_workers_();
+    try {
+        for (auto &t : threads_) {
+            if (t.joinable()) {
+                t.join();
+            }
+        }
+    }
+    catch(const std::exception& e) {
+        source_loc loc{__FILE__, __LINE__, __func__};
+        throw_learnlog_excpt(e.what(), os::get_errno(), loc);
+    }
+    release_leftover_();
+    complete_flushes_upto_(flush_ticket_.load(std::memory_order_seq_cst));
+
+    if (flush_sinks) {
+        std::lock_guard<std::mutex> loggers_lock(loggers_mutex_);
+        for (size_t handle = 0; handle < loggers_end_; ++handle) {
+            async_logger* logger = slot_(handle).logger.load(std::memory_order_relaxed);
+            if (logger != nullptr) {
+                logger->do_flush_sink_();
+            }
+        }
+    }
+
+    shutdown_result_.flushed_msgs = shutdown_flushed_.load(std::memory_order_relaxed);
+    shutdown_result_.discarded_msgs = shutdown_discarded_.load(std::memory_order_relaxed);
+    shutdown_result_.timed_out = timed_out;
+    return shutdown_result_;
+}
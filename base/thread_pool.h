@@ -5,38 +5,143 @@
 #include <thread>
 #include <vector>
 #include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <string>
 
 namespace learnlog {
 namespace base {
 
 static const size_t default_queue_size = 8192;
 static const size_t default_threads_num = 1;
+static const size_t default_batch_size = 64;     // 后台线程每次最多出队的消息数
+static const size_t first_slot_chunk_size = 64; // 登记 logger 的槽位按块分配，第 k 块有 64 << k 个槽位
+static const size_t max_slot_chunks = 24;
+static const size_t flush_spin_times = 1024;     // 等待 flush 完成时阻塞前的自旋次数
 
-enum msg_queue_type { lock, lockfree, lockfree_concurrent };
+enum msg_queue_type { lock, lockfree, lockfree_concurrent, spsc };
+
+// shutdown() 处理队列中剩余 log 消息的策略，flush 消息不受影响
+enum class shutdown_policy {
+    drain,              // 截止时间前输出全部消息（默认）
+    drop_low_levels     // 丢弃 debug 及以下等级的消息，其余消息按 drain 处理
+};
+
+struct shutdown_result {
+    size_t flushed_msgs{0};     // shutdown 期间输出到 sink 的消息数
+    size_t discarded_msgs{0};   // shutdown 期间及之后丢弃的消息数
+    bool timed_out{false};      // 截止时间前未能清空队列，剩余消息全部丢弃
+};
+
+// 后台线程的运行选项，在 on_thread_start 之前应用，设置失败时输出异常信息，线程继续运行；
+// 例如把后台线程绑定到专门处理 I/O 的 cpu 上，与处理请求的 cpu 隔离
+struct worker_options {
+    std::string name;               // 非空时线程名为 "name-序号"，Linux 下至多 15 个字符
+    std::vector<size_t> cpus;       // 非空时绑定的 cpu 编号
+    bool pin_per_worker{false};     // 为 true 时第 i 个后台线程只绑定 cpus[i % cpus.size()]
+    int nice{0};                    // 非 0 时设置线程的 nice 值
+    bool sched_batch{false};        // 为 true 时使用 SCHED_BATCH 调度策略（只在 Linux 下支持）
+};
+
+// 后台线程输出一批消息时使用的缓冲区，每个后台线程一份，跨批次复用，不再每批重新申请内存
+struct sink_batch_buffers {
+    std::vector<const log_msg*> batch;              // 同一 logger 连续的 log 消息
+    std::vector<const log_msg*> filtered;           // 经 sink 等级过滤后的消息
+    fmt_memory_buf formatted;                       // 同组 sink 共享的格式化结果
+    std::vector<size_t> offsets;                    // 每条消息在 formatted 中的起始位置
+    std::vector<fmt_string_view> views;
+    std::vector<fmt_string_view> filtered_views;
+};
 
 class thread_pool {
 public:
     thread_pool(size_t queue_size, msg_queue_type q_type,
                 size_t threads_num, 
                 const std::function<void()>& on_thread_start,
-                const std::function<void()>& on_thread_stop);
+                const std::function<void()>& on_thread_stop,
+                const worker_options& opts = worker_options());
     virtual ~thread_pool() = default;
     
     thread_pool(const thread_pool&) = delete;
     thread_pool& operator=(const thread_pool&) = delete;
 
-    void enqueue_log(async_logger_shr_ptr&& logger, const log_msg& msg);
-    std::future<void> enqueue_flush(async_logger_shr_ptr&& logger);
+    // logger 第一次向线程池提交消息前登记，返回句柄，同一个 logger 重复登记返回同一句柄；
+    // 线程池不持有 logger 的引用，logger 析构时注销：
+    // 先等待该 logger 已提交的消息全部处理完，再回收句柄；
+    // 在后台线程中注销（如 sink 释放了 logger 的最后一个引用）时不等待，剩余的消息被丢弃，
+    // 句柄在这些消息处理完后才回收
+    size_t register_logger(async_logger* logger);
+    void deregister_logger(size_t logger_handle);
+    size_t logger_count();
+
+    void enqueue_log(size_t logger_handle, const log_msg& msg);
+    // flush 屏障：enqueue_flush() 先等待该 logger 此前已提交的消息全部输出（无论由哪个线程提交、
+    // 被哪个后台线程取走），再提交 flush 消息并返回递增的序号，
+    // wait_flush() 先自旋、再阻塞，直到不大于该序号的 flush 全部完成
+    std::uint64_t enqueue_flush(size_t logger_handle);
+    void wait_flush(std::uint64_t ticket);
+    std::uint64_t completed_flush_ticket() const {
+        return flush_done_.load(std::memory_order_acquire);
+    }
+
+    // 超出内联缓冲区的消息内容复用内存块的次数（命中）与重新申请内存的次数（未命中）
+    size_t payload_hit_count() const { return payload_pool_.hit_count(); }
+    size_t payload_miss_count() const { return payload_pool_.miss_count(); }
+    void reset_payload_counts() { payload_pool_.reset_counts(); }
+
+    // 停止线程池：等待后台线程处理完队列中的消息，至多等到 deadline，
+    // 超时后后台线程直接丢弃剩余的 log 消息；之后后台线程退出，刷新所有 logger 的 sink；
+    // shutdown 开始之后提交的 log 消息被丢弃，flush 立即返回；
+    // 重复调用直接返回第一次的结果，其中丢弃数包括之后提交的消息
+    shutdown_result shutdown(std::chrono::steady_clock::time_point deadline,
+                             shutdown_policy policy = shutdown_policy::drain) {
+        return shutdown_(deadline, policy, true);
+    }
+    shutdown_result shutdown(std::chrono::milliseconds timeout,
+                             shutdown_policy policy = shutdown_policy::drain) {
+        return shutdown(std::chrono::steady_clock::now() + timeout, policy);
+    }
+    bool is_shutdown() const { return stopped_.load(std::memory_order_acquire); }
 
     size_t message_queue_size() { return msg_q_size_; }
     msg_queue_type message_queue_type() { return msg_q_type_; }
     size_t threads_size() { return threads_num_; }
+    const worker_options& worker_opts() const { return worker_opts_; }
 
 protected:
-    bool process_async_msg_();
+    // 后台线程启动时调用，按启动顺序分配序号，并记录线程 id
+    void apply_worker_options_();
+    bool is_worker_thread_();
+    bool process_async_msg_(std::vector<async_msg>& amsgs, size_t msg_cnt,
+                            sink_batch_buffers& bufs);
     void worker_loop_();
+    struct logger_slot;
+    // 提交 log 消息前调用，在当前纪元的计数上加 1，返回纪元的奇偶
+    unsigned enter_epoch_(logger_slot& slot);
+    // 等待计数降为 0 或后台线程已退出
+    void wait_pending_(const std::atomic<size_t>& pending);
+    void notify_pending_waiters_();
+    // 一批消息处理完后，按句柄与纪元减少已提交、尚未处理完的消息数，有线程等待时唤醒
+    void release_pending_(const std::vector<async_msg>& amsgs, size_t msg_cnt);
+    // 消息入队失败或被覆盖而不会被处理时调用
+    void drop_pending_(const async_msg& amsg);
+    size_t pending_msg_count_();
+    void release_leftover_();
+    void complete_flush_(std::uint64_t ticket);
+    void complete_flushes_upto_(std::uint64_t ticket);
+    void advance_flush_done_(std::uint64_t done);
+    // 派生类析构时以不设截止时间的 drain 策略调用，此时 sink 可能已经析构，不刷新 sink
+    shutdown_result shutdown_(std::chrono::steady_clock::time_point deadline,
+                              shutdown_policy policy, bool flush_sinks);
+    // 通知所有后台线程处理完已入队的消息后退出，只由 shutdown() 调用一次
+    virtual void terminate_workers_() = 0;
     virtual void enqueue_async_msg_(async_msg&& amsg) = 0;
-    virtual void dequeue_async_msg_(async_msg& amsg) = 0;
+    // 至多取出 max_num 条消息，依次写入 amsgs，返回实际出队个数，队列为空时阻塞等待，
+    // 可能返回 0（如自旋等待的线程池）
+    virtual size_t dequeue_async_msgs_(async_msg* amsgs, size_t max_num) = 0;
 
     size_t msg_q_size_;
     msg_queue_type msg_q_type_;
@@ -44,6 +149,72 @@ protected:
     std::function<void()> start_func_;
     std::function<void()> stop_func_;
     std::vector<std::thread> threads_;
+    worker_options worker_opts_;
+    std::atomic<size_t> started_workers_{0};
+
+    // 在派生类的消息队列之后析构，队列中消息的内存先归还
+    payload_pool payload_pool_;
+
+    // 句柄按顺序映射到各块中的槽位，块一经分配不再移动，后台线程按句柄读取时无需加锁；
+    // pending 为该 logger 已提交、尚未处理完的 log 消息数，按纪元的奇偶分为两组，入队前增加，整批处理完后减少；
+    // flush 时切换纪元，之后提交的消息计入另一组，等待原来一组降为 0 即可，不会被持续提交的消息拖住；
+    // users 为正在使用 logger 的后台线程数，在后台线程中注销时等待其降为 0
+    struct logger_slot {
+        std::atomic<async_logger*> logger{nullptr};
+        std::atomic<unsigned> users{0};
+        std::atomic<unsigned> epoch{0};
+        std::atomic<size_t> pending[2];
+        std::mutex flush_mutex;             // 同一 logger 的 flush 依次切换纪元
+        logger_slot() {
+            pending[0].store(0, std::memory_order_relaxed);
+            pending[1].store(0, std::memory_order_relaxed);
+        }
+    };
+    static size_t slot_chunk_(size_t handle) {
+        size_t chunk = 0;
+        while (handle + first_slot_chunk_size >= (first_slot_chunk_size << (chunk + 1))) {
+            ++chunk;
+        }
+        return chunk;
+    }
+    logger_slot& slot_(size_t handle) {
+        size_t chunk = slot_chunk_(handle);
+        return slot_chunks_[chunk][handle + first_slot_chunk_size - (first_slot_chunk_size << chunk)];
+    }
+    // 在后台线程中注销 logger：不等待已提交的消息，等其他后台线程不再使用该 logger 后返回
+    void retire_logger_(size_t logger_handle);
+
+    std::mutex loggers_mutex_;
+    std::unique_ptr<logger_slot[]> slot_chunks_[max_slot_chunks];
+    size_t loggers_end_{0};
+    std::vector<size_t> free_handles_;
+    std::vector<size_t> retired_handles_;           // 在后台线程中注销、消息尚未处理完的句柄
+    std::vector<std::thread::id> worker_ids_;       // 由 loggers_mutex_ 保护
+
+    // 等待 pending 减少（flush、注销 logger）的线程数，后台线程只在有等待者时加锁唤醒
+    std::atomic<size_t> pending_waiters_{0};
+    std::mutex pending_mutex_;
+    std::condition_variable pending_cv_;
+    bool workers_exited_{false};            // 由 pending_mutex_ 保护
+
+    // flush_ticket_ 为已分配的最大序号，flush_done_ 为连续完成的最大序号，
+    // 多个后台线程时 flush 可能乱序完成，提前完成的序号暂存在 flush_pending_ 中
+    std::atomic<std::uint64_t> flush_ticket_{0};
+    std::atomic<std::uint64_t> flush_done_{0};
+    std::mutex flush_mutex_;
+    std::condition_variable flush_cv_;
+    std::vector<std::uint64_t> flush_pending_;
+    size_t flush_waiters_{0};
+
+    // shutdown 状态，后台线程每批消息只读取一次
+    std::mutex shutdown_mutex_;
+    shutdown_result shutdown_result_;
+    std::atomic<bool> shutting_down_{false};
+    std::atomic<bool> discard_all_{false};
+    std::atomic<int> drop_level_{-1};           // 不高于该等级的消息被丢弃，-1 表示不丢弃
+    std::atomic<bool> stopped_{false};
+    std::atomic<size_t> shutdown_flushed_{0};
+    std::atomic<size_t> shutdown_discarded_{0};
 };
 
 }   // namespace base
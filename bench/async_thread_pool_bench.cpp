@@ -1,5 +1,7 @@
 #include "learnlog.h"
 #include "sinks/basic_file_sink.h"
+#include <ctime>
+#include <algorithm>
 
 
 template <typename Threadpool>
@@ -26,6 +28,30 @@ void bench_cthread(int q_size,
                    const learnlog::filename_t& filename,
                    std::string&& logger_name);
 
+template <typename Threadpool>
+void bench_long_msg(int q_size,
+                    size_t msg_num,
+                    const std::vector<size_t>& msg_sizes,
+                    int pthread_num,
+                    int cthread_num,
+                    const learnlog::filename_t& filename,
+                    std::string&& logger_name);
+
+void bench_wait_strategy(int q_size,
+                         size_t msg_num,
+                         int pthread_num,
+                         int cthread_num,
+                         const learnlog::filename_t& filename);
+
+template <typename Threadpool>
+void bench_affinity(int q_size,
+                    size_t msg_num,
+                    int pthread_num,
+                    int cthread_num,
+                    const std::vector<learnlog::base::worker_options>& affinities,
+                    const learnlog::filename_t& filename,
+                    std::string&& logger_name);
+
 int main(int argc, char *argv[]) {
     int q_size = 8192;
     int iters = 3;
@@ -97,6 +123,7 @@ int main(int argc, char *argv[]) {
             bench_msg<learnlog::base::lock_thread_pool>(q_size, msg_fill_ratios, pthread_num, cthread_num, fname, "lock");
             bench_msg<learnlog::base::lockfree_thread_pool>(q_size, msg_fill_ratios, pthread_num, cthread_num, fname, "lockfree");
             bench_msg<learnlog::base::lockfree_concurrent_thread_pool>(q_size, msg_fill_ratios, pthread_num, cthread_num, fname, "lockfree_concurrent");
+            bench_msg<learnlog::base::spsc_thread_pool>(q_size, msg_fill_ratios, pthread_num, cthread_num, fname, "spsc");
         }
 
         learnlog::debug("\n");
@@ -126,6 +153,7 @@ int main(int argc, char *argv[]) {
             bench_pthread<learnlog::base::lock_thread_pool>(q_size, msg_num, pthread_nums, cthread_num, fname, "lock");
             bench_pthread<learnlog::base::lockfree_thread_pool>(q_size, msg_num, pthread_nums, cthread_num, fname, "lockfree");
             bench_pthread<learnlog::base::lockfree_concurrent_thread_pool>(q_size, msg_num, pthread_nums, cthread_num, fname, "lockfree_concurrent");
+            bench_pthread<learnlog::base::spsc_thread_pool>(q_size, msg_num, pthread_nums, cthread_num, fname, "spsc");
         }
 
         learnlog::debug("\n");
@@ -155,6 +183,107 @@ int main(int argc, char *argv[]) {
             bench_cthread<learnlog::base::lock_thread_pool>(q_size, msg_num, pthread_num, cthread_nums, fname, "lock");
             bench_cthread<learnlog::base::lockfree_thread_pool>(q_size, msg_num, pthread_num, cthread_nums, fname, "lockfree");
             bench_cthread<learnlog::base::lockfree_concurrent_thread_pool>(q_size, msg_num, pthread_num, cthread_nums, fname, "lockfree_concurrent");
+            bench_cthread<learnlog::base::spsc_thread_pool>(q_size, msg_num, pthread_num, cthread_nums, fname, "spsc");
+        }
+
+        std::vector<size_t> msg_sizes{1024, 2048, 4096};
+        learnlog::debug("\n");
+        learnlog::info("*********************************");
+        learnlog::info("Change message size (throughput | msg/ms, payload pool hit rate | %)");
+        learnlog::info("*********************************");
+        learnlog::info("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~");
+        learnlog::info("Message queue size          : {:L}", q_size);
+        learnlog::info("Iterations                  : {:L}", iters);
+        learnlog::info("Total messages              : {:L}", msg_num);
+        learnlog::info("Produce threads             : {:L}", pthread_num);
+        learnlog::info("Consume threads             : {:L}", cthread_num);
+        learnlog::info("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~");
+        learnlog::debug("tp: thread pool");
+        learnlog::debug("msg_size: bytes of each message, larger than the 250 bytes inline buffer");
+
+        for (int i = 1; i <= iters; i++) {
+            learnlog::info("~~~~~~~~~~~~~~~~~~~");
+            learnlog::info("Iteration: {}", i);
+            learnlog::info("~~~~~~~~~~~~~~~~~~~");
+            learnlog::info("-------------------------------------------------");
+            learnlog::info("{:24s}| {:<20d}| {:<20d}| {:<20d}",
+                           "tp\\msg_size",
+                           msg_sizes[0], msg_sizes[1], msg_sizes[2]);
+            learnlog::info("-------------------------------------------------");
+
+            bench_long_msg<learnlog::base::lock_thread_pool>(q_size, msg_num, msg_sizes, pthread_num, cthread_num, fname, "lock");
+            bench_long_msg<learnlog::base::lockfree_thread_pool>(q_size, msg_num, msg_sizes, pthread_num, cthread_num, fname, "lockfree");
+            bench_long_msg<learnlog::base::lockfree_concurrent_thread_pool>(q_size, msg_num, msg_sizes, pthread_num, cthread_num, fname, "lockfree_concurrent");
+            bench_long_msg<learnlog::base::spsc_thread_pool>(q_size, msg_num, msg_sizes, pthread_num, cthread_num, fname, "spsc");
+        }
+
+        learnlog::debug("\n");
+        learnlog::info("*********************************");
+        learnlog::info("Change lockfree_concurrent wait strategy (throughput | msg/ms, idle cpu | %)");
+        learnlog::info("*********************************");
+        learnlog::info("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~");
+        learnlog::info("Message queue size          : {:L}", q_size);
+        learnlog::info("Iterations                  : {:L}", iters);
+        learnlog::info("Total messages              : {:L}", msg_num);
+        learnlog::info("Produce threads             : {:L}", pthread_num);
+        learnlog::info("Consume threads             : {:L}", cthread_num);
+        learnlog::info("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~");
+        learnlog::debug("idle cpu: process cpu time / wall time while no message is logged");
+
+        for (int i = 1; i <= iters; i++) {
+            learnlog::info("~~~~~~~~~~~~~~~~~~~");
+            learnlog::info("Iteration: {}", i);
+            learnlog::info("~~~~~~~~~~~~~~~~~~~");
+            learnlog::info("-------------------------------------------------");
+            learnlog::info("{:24s}| {:<12s}| {:<12s}", "wait_strategy", "throughput", "idle cpu");
+            learnlog::info("-------------------------------------------------");
+
+            bench_wait_strategy(q_size, msg_num, pthread_num, cthread_num, fname);
+        }
+
+        // 前台线程不绑定 cpu，后台线程依次：不绑定、全部绑定到 cpu 0、每个线程绑定一个 cpu、全部绑定到最后一个 cpu
+        size_t cpu_num = std::max(std::thread::hardware_concurrency(), 1u);
+        std::vector<size_t> all_cpus;
+        for (size_t cpu = 0; cpu < cpu_num; ++cpu) {
+            all_cpus.push_back(cpu);
+        }
+        std::vector<learnlog::base::worker_options> affinities(4);
+        affinities[1].cpus = {0};
+        affinities[2].cpus = all_cpus;
+        affinities[2].pin_per_worker = true;
+        affinities[3].cpus = {cpu_num - 1};
+        for (auto &opts : affinities) {
+            opts.name = "bench-log";
+        }
+
+        learnlog::debug("\n");
+        learnlog::info("*********************************");
+        learnlog::info("Change consume threads cpu affinity (throughput | msg/ms)");
+        learnlog::info("*********************************");
+        learnlog::info("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~");
+        learnlog::info("Message queue size          : {:L}", q_size);
+        learnlog::info("Iterations                  : {:L}", iters);
+        learnlog::info("Total messages              : {:L}", msg_num);
+        learnlog::info("Produce threads             : {:L}", pthread_num);
+        learnlog::info("Consume threads             : {:L}", cthread_num);
+        learnlog::info("CPUs                        : {:L}", cpu_num);
+        learnlog::info("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~");
+        learnlog::debug("tp: thread pool");
+        learnlog::debug("affinity: none | all consume threads on cpu 0 | one cpu per consume thread | all on the last cpu");
+
+        for (int i = 1; i <= iters; i++) {
+            learnlog::info("~~~~~~~~~~~~~~~~~~~");
+            learnlog::info("Iteration: {}", i);
+            learnlog::info("~~~~~~~~~~~~~~~~~~~");
+            learnlog::info("-------------------------------------------------");
+            learnlog::info("{:24s}| {:<12s}| {:<12s}| {:<12s}| {:<12s}",
+                           "tp\\affinity", "none", "cpu0", "spread", "last_cpu");
+            learnlog::info("-------------------------------------------------");
+
+            bench_affinity<learnlog::base::lock_thread_pool>(q_size, msg_num, pthread_num, cthread_num, affinities, fname, "lock");
+            bench_affinity<learnlog::base::lockfree_thread_pool>(q_size, msg_num, pthread_num, cthread_num, affinities, fname, "lockfree");
+            bench_affinity<learnlog::base::lockfree_concurrent_thread_pool>(q_size, msg_num, pthread_num, cthread_num, affinities, fname, "lockfree_concurrent");
+            bench_affinity<learnlog::base::spsc_thread_pool>(q_size, msg_num, pthread_num, cthread_num, affinities, fname, "spsc");
         }
     }
     LEARNLOG_CATCH
@@ -263,4 +392,116 @@ void bench_cthread(int q_size,
                     throughputs[2],
                     throughputs[3],
                     throughputs[4]);
-}
\ No newline at end of file
+}
+template <typename Threadpool>
+void bench_long_msg(int q_size,
+                    size_t msg_num,
+                    const std::vector<size_t>& msg_sizes,
+                    int pthread_num,
+                    int cthread_num,
+                    const learnlog::filename_t& filename,
+                    std::string&& logger_name) {
+    std::vector<std::string> results;
+    for (auto &msg_size : msg_sizes) {
+        auto tp = std::make_shared<Threadpool>(q_size, cthread_num);
+        auto sink = std::make_shared<learnlog::sinks::basic_file_sink_mt>(filename, true);
+        auto logger = std::make_shared<learnlog::async_logger>(logger_name, 
+                                                               std::move(sink), 
+                                                               tp);
+        logger->set_pattern("[%n]: %v");
+        std::string msg(msg_size, 'x');
+        auto thread_func = [&logger, &msg] (size_t msg_num_pt) {
+            for (size_t i = 0; i < msg_num_pt; i++) {
+                logger->info(msg);
+            }
+        };
+
+        size_t msg_num_per_thread = msg_num / pthread_num;
+        size_t msg_num_mod = msg_num % pthread_num;
+        std::vector<std::thread> threads;
+
+        auto start_tp = learnlog::sys_clock::now();
+
+        threads.emplace_back(thread_func, msg_num_per_thread + msg_num_mod);
+        for (int i = 1; i < pthread_num; i++) {
+            threads.emplace_back(thread_func, msg_num_per_thread);
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        auto delta = learnlog::sys_clock::now() - start_tp;
+        size_t throughput = msg_num * 1000000 / static_cast<size_t>(delta.count());
+        size_t hit_cnt = tp->payload_hit_count();
+        size_t total_cnt = hit_cnt + tp->payload_miss_count();
+        double hit_rate = total_cnt == 0 ? 0.0 : 100.0 * static_cast<double>(hit_cnt) / static_cast<double>(total_cnt);
+        results.push_back(fmt::format("{:L} ({:.1f}%)", throughput, hit_rate));
+    }
+    learnlog::info( "{:24s}| {:<20s}| {:<20s}| {:<20s}",
+                    std::move(logger_name),
+                    results[0],
+                    results[1],
+                    results[2]);
+}
+
+void bench_wait_strategy(int q_size,
+                         size_t msg_num,
+                         int pthread_num,
+                         int cthread_num,
+                         const learnlog::filename_t& filename) {
+    using learnlog::base::wait_strategy;
+    const std::vector<std::pair<wait_strategy, std::string>> strategies{
+        {wait_strategy::busy_spin, "busy_spin"},
+        {wait_strategy::spin_pause, "spin_pause"},
+        {wait_strategy::spin_yield, "spin_yield"},
+        {wait_strategy::spin_park, "spin_park"}
+    };
+    const int idle_ms = 500;
+
+    for (auto &strategy : strategies) {
+        auto tp = std::make_shared<learnlog::base::lockfree_concurrent_thread_pool>(q_size, 
+                                                                                    cthread_num);
+        tp->set_wait_strategy(strategy.first);
+        auto sink = std::make_shared<learnlog::sinks::basic_file_sink_mt>(filename, true);
+        auto logger = std::make_shared<learnlog::async_logger>(strategy.second, 
+                                                               std::move(sink), 
+                                                               tp);
+        logger->set_pattern("[%n]: %v");
+        size_t throughput = bench_(msg_num, logger, pthread_num);
+        logger->flush();
+
+        // 没有消息提交时，进程消耗的 cpu 时间几乎全部来自后台线程的等待
+        std::clock_t cpu_start = std::clock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(idle_ms));
+        double cpu_ms = 1000.0 * static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+        double idle_cpu = 100.0 * cpu_ms / idle_ms;
+
+        learnlog::info("{:24s}| {:<12L}| {:<12.1f}", strategy.second, throughput, idle_cpu);
+    }
+}
+
+template <typename Threadpool>
+void bench_affinity(int q_size,
+                    size_t msg_num,
+                    int pthread_num,
+                    int cthread_num,
+                    const std::vector<learnlog::base::worker_options>& affinities,
+                    const learnlog::filename_t& filename,
+                    std::string&& logger_name) {
+    std::vector<size_t> throughputs;
+    for (auto &opts : affinities) {
+        auto tp = std::make_shared<Threadpool>(q_size, cthread_num, opts);
+        auto sink = std::make_shared<learnlog::sinks::basic_file_sink_mt>(filename, true);
+        auto logger = std::make_shared<learnlog::async_logger>(logger_name, 
+                                                               std::move(sink), 
+                                                               std::move(tp));
+        logger->set_pattern("[%n]: %v");
+        throughputs.push_back(bench_(msg_num, std::move(logger), pthread_num));
+    }
+    learnlog::info( "{:24s}| {:<12L}| {:<12L}| {:<12L}| {:<12L}",
+                    std::move(logger_name),
+                    throughputs[0],
+                    throughputs[1],
+                    throughputs[2],
+                    throughputs[3]);
+}
@@ -0,0 +1,145 @@
+#include "learnlog.h"
+#include "sinks/basic_file_sink.h"
+#ifndef _WIN32
+    #include "sinks/mmap_file_sink.h"
+    #include "sinks/aio_file_sink.h"
+#endif
+
+#include <chrono>
+#include <fstream>
+
+enum class sink_kind { basic, mmap, aio_uring, aio_pwrite };
+
+struct file_sink_mode {
+    std::string name;
+    size_t buffer_size;     // basic 时 0 表示通过 FILE* 写入，mmap 时为块大小，aio 时为每个缓冲区的大小
+    sink_kind kind;
+};
+
+void bench_file_sink(const file_sink_mode& mode, size_t msg_num, size_t msg_size,
+                     const learnlog::filename_t& filename);
+long long write_syscalls();
+
+int main(int argc, char *argv[]) {
+    size_t msg_num = 1000000;
+
+    try {
+        learnlog::set_global_pattern("[%^%l%$] %v");
+        learnlog::set_global_log_level(learnlog::level::debug);
+
+        if (argc > 1) {
+            msg_num = static_cast<size_t>(atoll(argv[1]));
+        }
+        if (argc > 2) {
+            learnlog::error("Unknown args! Usage: {} <msg_num>", argv[0]);
+            return 0;
+        }
+
+#ifdef _WIN32
+        learnlog::filename_t fname = L"bench_tmp/file_sink.log";
+#else
+        learnlog::filename_t fname = "bench_tmp/file_sink.log";
+#endif
+
+        const std::vector<file_sink_mode> modes = {
+            {"FILE* (stdio)", 0, sink_kind::basic},
+            {"buffered 64 KB", 64 * 1024, sink_kind::basic},
+            {"buffered 1 MB", 1024 * 1024, sink_kind::basic},
+            {"buffered 8 MB", 8 * 1024 * 1024, sink_kind::basic},
+#ifndef _WIN32
+            {"mmap 8 MB chunk", 8 * 1024 * 1024, sink_kind::mmap},
+            {"io_uring 4x1 MB", 1024 * 1024, sink_kind::aio_uring},
+            {"pwrite thd 4x1 MB", 1024 * 1024, sink_kind::aio_pwrite},
+#endif
+        };
+
+        learnlog::info("*********************************");
+        learnlog::info("file sink write modes (sync logger, single thread)");
+        learnlog::info("*********************************");
+        learnlog::info("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~");
+        learnlog::info("Messages            : {:L}", msg_num);
+        learnlog::info("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~");
+        learnlog::debug("write syscalls are read from /proc/self/io (syscw), -1 when unavailable");
+        learnlog::info("-------------------------------------------------");
+        learnlog::info("{:10s}| {:18s}| {:<10s}| {:<10s}| {:<12s}| {:<10s}",
+                       "msg size", "mode", "ns/msg", "MB/s", "write calls", "KB/call");
+        learnlog::info("-------------------------------------------------");
+
+        for (size_t msg_size : {64, 256}) {
+            for (auto& mode : modes) {
+                bench_file_sink(mode, msg_num, msg_size, fname);
+            }
+        }
+    }
+    LEARNLOG_CATCH
+
+    return 0;
+}
+
+// 当前进程已发出的 write 类系统调用次数
+long long write_syscalls() {
+    std::ifstream ifs("/proc/self/io");
+    std::string key;
+    long long value = 0;
+    while (ifs >> key >> value) {
+        if (key == "syscw:") {
+            return value;
+        }
+    }
+    return -1;
+}
+
+void bench_file_sink(const file_sink_mode& mode, size_t msg_num, size_t msg_size,
+                     const learnlog::filename_t& filename) {
+    using std::chrono::steady_clock;
+
+    learnlog::sink_shr_ptr sink;
+#ifndef _WIN32
+    std::shared_ptr<learnlog::sinks::aio_file_sink_st> aio_sink;
+    if (mode.kind == sink_kind::mmap) {
+        sink = std::make_shared<learnlog::sinks::mmap_file_sink_st>(filename, true, mode.buffer_size);
+    }
+    else if (mode.kind == sink_kind::aio_uring || mode.kind == sink_kind::aio_pwrite) {
+        learnlog::base::aio_file_options opts;
+        opts.buffer_size = mode.buffer_size;
+        opts.use_io_uring = mode.kind == sink_kind::aio_uring;
+        aio_sink = std::make_shared<learnlog::sinks::aio_file_sink_st>(filename, true, opts);
+        sink = aio_sink;
+    }
+#endif
+    if (sink == nullptr) {
+        learnlog::base::file_buffer_options opts;
+        opts.buffer_size = mode.buffer_size;
+        sink = std::make_shared<learnlog::sinks::basic_file_sink_st>(filename, true, opts);
+    }
+    learnlog::logger logger("file_sink_bench", sink);
+    const std::string pattern = "[%T.%F] [%l] %v";
+    logger.set_pattern(pattern);
+    std::string text(msg_size, 'x');
+
+    // 每行的长度不随时间变化，格式化一条得到写入的总字节数
+    learnlog::fmt_memory_buf line;
+    learnlog::sinks::pattern_formatter(pattern).format(
+        learnlog::base::log_msg(learnlog::level::info, text, logger.name()), line);
+    double bytes = static_cast<double>(line.size() * msg_num);
+
+    long long syscalls_before = write_syscalls();
+    auto start_tp = steady_clock::now();
+    for (size_t i = 0; i < msg_num; ++i) {
+        logger.info(learnlog::fmt_string_view(text));
+    }
+    logger.flush();
+#ifndef _WIN32
+    // aio_file_sink 的 flush() 不等待写入完成
+    if (aio_sink != nullptr) {
+        aio_sink->drain();
+    }
+#endif
+    double secs = std::chrono::duration<double>(steady_clock::now() - start_tp).count();
+    long long syscalls = syscalls_before < 0 ? -1 : write_syscalls() - syscalls_before;
+
+    learnlog::info("{:10d}| {:18s}| {:<10.1f}| {:<10.1f}| {:<12d}| {:<10.1f}",
+                   msg_size, mode.name, secs * 1e9 / static_cast<double>(msg_num),
+                   bytes / secs / 1024 / 1024, syscalls,
+                   syscalls > 0 ? bytes / static_cast<double>(syscalls) / 1024 : 0.0);
+}
@@ -0,0 +1,302 @@
+#include "learnlog.h"
+#include "sinks/formatters/pattern_formatter.h"
+#include "sinks/formatters/static_pattern_formatter.h"
+#include "sinks/formatters/json_formatter.h"
+
+#include <chrono>
+
+using namespace learnlog;
+using namespace sinks;
+
+// 格式模板中的一段：先是普通字符 literal，之后是格式字符 flag（为 0 时没有格式字符）
+struct pattern_token {
+    std::string literal;
+    char flag;
+    std::string spaces;
+    spaces_info sp_info;
+};
+
+struct bench_case {
+    std::string name;
+    std::vector<pattern_token> tokens;
+};
+
+std::unique_ptr<flag_formatter> make_flag_formatter(char flag, const spaces_info& sp_info);
+std::string make_pattern(const std::vector<pattern_token>& tokens);
+std::vector<std::unique_ptr<flag_formatter>> make_flag_chain(const std::vector<pattern_token>& tokens);
+void bench_formatter(const bench_case& bcase, size_t iters);
+double bench_format_ns(formatter& f, size_t iters,
+                       fmt_string_view text = "formatter bench message");
+void bench_json(const std::string& name, const std::string& text, size_t iters);
+
+template <typename Pattern>
+void bench_static_pattern(size_t iters);
+
+LEARNLOG_STATIC_PATTERN(bench_pattern_default, "[%y-%m-%d %T.%E] [%n] [%^%l%$] %v");
+LEARNLOG_STATIC_PATTERN(bench_pattern_full, "%+");
+LEARNLOG_STATIC_PATTERN(bench_pattern_padded, "[%T.%F] [%-8l] [%t] %v");
+
+// 自定义格式字符，通过 custom 指令调用
+class custom_flag_bench final : public custom_flag_formatter {
+public:
+    void format(const base::log_msg& msg, const std::tm&, fmt_memory_buf& dest_buf) override {
+        filler f(msg.logger_name.size(), spaces_info_, dest_buf);
+        f.fill_msg(msg.logger_name);
+    }
+    std::unique_ptr<custom_flag_formatter> clone() const override {
+        return learnlog::make_unique<custom_flag_bench>();
+    }
+};
+
+int main(int argc, char *argv[]) {
+    size_t iters = 1000000;
+
+    try {
+        learnlog::set_global_pattern("[%^%l%$] %v");
+        learnlog::set_global_log_level(learnlog::level::debug);
+
+        if (argc > 1) {
+            iters = static_cast<size_t>(atoll(argv[1]));
+        }
+        if (argc > 2) {
+            learnlog::error("Unknown args! Usage: {} <iters>", argv[0]);
+            return 0;
+        }
+
+        const spaces_info no_spaces{};
+        const spaces_info pad_right{16, spaces_info::fill_side::right, false};
+        const spaces_info pad_center{16, spaces_info::fill_side::center, false};
+        const spaces_info trunc_left{3, spaces_info::fill_side::left, true};
+
+        std::vector<bench_case> cases;
+        const std::string flags = "nlabcymdHMSEFGTXptv@ABC+";
+        for (char flag : flags) {
+            cases.push_back(bench_case{std::string("%") + flag, {{"", flag, "", no_spaces}}});
+        }
+        cases.push_back(bench_case{"%-16v", {{"", 'v', "-16", pad_right}}});
+        cases.push_back(bench_case{"%=16n", {{"", 'n', "=16", pad_center}}});
+        cases.push_back(bench_case{"%3!l", {{"", 'l', "3!", trunc_left}}});
+        cases.push_back(bench_case{"%-16k (custom)", {{"", 'k', "-16", pad_right}}});
+        cases.push_back(bench_case{"[%T.%E] [%n] [%^%l%$] %v",
+                                   {{"[", 'T', "", no_spaces},
+                                    {".", 'E', "", no_spaces},
+                                    {"] [", 'n', "", no_spaces},
+                                    {"] [", '^', "", no_spaces},
+                                    {"", 'l', "", no_spaces},
+                                    {"", '$', "", no_spaces},
+                                    {"] ", 'v', "", no_spaces}}});
+
+        learnlog::info("*********************************");
+        learnlog::info("Single flag formatting (latency | ns/msg)");
+        learnlog::info("*********************************");
+        learnlog::info("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~");
+        learnlog::info("Iterations          : {:L}", iters);
+        learnlog::info("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~");
+        learnlog::debug("virtual: one flag_formatter per flag, one virtual call each");
+        learnlog::debug("compiled: pattern_formatter, flat instructions with switch dispatch");
+        learnlog::info("-------------------------------------------------");
+        learnlog::info("{:28s}| {:<12s}| {:<12s}| {:<8s}", "pattern", "virtual", "compiled", "speedup");
+        learnlog::info("-------------------------------------------------");
+
+        for (auto &bcase : cases) {
+            bench_formatter(bcase, iters);
+        }
+
+        learnlog::debug("\n");
+        learnlog::info("*********************************");
+        learnlog::info("Fixed pattern formatting (latency | ns/msg)");
+        learnlog::info("*********************************");
+        learnlog::debug("compiled: pattern_formatter, pattern parsed at runtime");
+        learnlog::debug("static: static_pattern_formatter, pattern parsed at compile time");
+        learnlog::info("-------------------------------------------------");
+        learnlog::info("{:36s}| {:<12s}| {:<12s}| {:<8s}", "pattern", "compiled", "static", "speedup");
+        learnlog::info("-------------------------------------------------");
+
+        bench_static_pattern<bench_pattern_default>(iters);
+        bench_static_pattern<bench_pattern_full>(iters);
+        bench_static_pattern<bench_pattern_padded>(iters);
+
+        learnlog::debug("\n");
+        learnlog::info("*********************************");
+        learnlog::info("JSON formatting (throughput | MB/s of message text)");
+        learnlog::info("*********************************");
+        learnlog::debug("pattern: pattern_formatter with the same fields as json, message copied as is");
+        learnlog::debug("scalar / sse2 / avx2: json_formatter, message escaped with each isa");
+        learnlog::debug("best isa on this cpu: {}", static_cast<int>(best_json_escape_isa()));
+        learnlog::info("-------------------------------------------------");
+        learnlog::info("{:20s}| {:<10s}| {:<10s}| {:<10s}| {:<10s}",
+                       "message", "pattern", "scalar", "sse2", "avx2");
+        learnlog::info("-------------------------------------------------");
+
+        std::string escaped_text;
+        for (int i = 0; i < 32; ++i) {
+            escaped_text += "key=\"value\"\t";
+        }
+        bench_json("32 bytes", std::string(32, 'x'), iters);
+        bench_json("256 bytes", std::string(256, 'x'), iters);
+        bench_json("1024 bytes", std::string(1024, 'x'), iters);
+        bench_json("escaped 384 bytes", escaped_text, iters);
+    }
+    LEARNLOG_CATCH
+
+    return 0;
+}
+
+std::string make_pattern(const std::vector<pattern_token>& tokens) {
+    std::string pattern;
+    for (auto &token : tokens) {
+        pattern += token.literal;
+        if (token.flag != 0) {
+            pattern += '%';
+            pattern += token.spaces;
+            pattern += token.flag;
+        }
+    }
+    return pattern;
+}
+
+std::vector<std::unique_ptr<flag_formatter>> make_flag_chain(const std::vector<pattern_token>& tokens) {
+    std::vector<std::unique_ptr<flag_formatter>> chain;
+    for (auto &token : tokens) {
+        if (!token.literal.empty()) {
+            auto literal = learnlog::make_unique<aggregate_formatter>();
+            for (char ch : token.literal) {
+                literal->add_ch(ch);
+            }
+            chain.push_back(std::move(literal));
+        }
+        if (token.flag == 'k') {
+            auto custom = learnlog::make_unique<custom_flag_bench>();
+            custom->set_spaces_info(token.sp_info);
+            chain.push_back(std::move(custom));
+        }
+        else if (token.flag != 0) {
+            chain.push_back(make_flag_formatter(token.flag, token.sp_info));
+        }
+    }
+    auto eol = learnlog::make_unique<aggregate_formatter>();
+    for (char ch : std::string(DEFAULT_EOL)) {
+        eol->add_ch(ch);
+    }
+    chain.push_back(std::move(eol));
+    return chain;
+}
+
+void bench_formatter(const bench_case& bcase, size_t iters) {
+    using std::chrono::steady_clock;
+
+    source_loc loc("formatter_bench.cpp", 123, "bench_formatter");
+    base::log_msg msg(sys_clock::now(), loc, level::info,
+                      "formatter bench message", "bench_logger");
+    fmt_memory_buf buf;
+
+    auto chain = make_flag_chain(bcase.tokens);
+    auto start_tp = steady_clock::now();
+    for (size_t i = 0; i < iters; ++i) {
+        buf.clear();
+        std::tm msg_tm = base::os::time_point_to_tm(msg.time);
+        for (auto &f : chain) {
+            f->format(msg, msg_tm, buf);
+        }
+    }
+    double virtual_ns = static_cast<double>(
+        std::chrono::duration_cast<nanoseconds>(steady_clock::now() - start_tp).count()) /
+        static_cast<double>(iters);
+
+    pattern_formatter compiled("");
+    compiled.add_custom_flag<custom_flag_bench>('k');
+    compiled.set_pattern(make_pattern(bcase.tokens));
+    double compiled_ns = bench_format_ns(compiled, iters);
+
+    learnlog::info("{:28s}| {:<12.1f}| {:<12.1f}| {:<8.2f}",
+                   bcase.name, virtual_ns, compiled_ns, virtual_ns / compiled_ns);
+}
+
+double bench_format_ns(formatter& f, size_t iters, fmt_string_view text) {
+    using std::chrono::steady_clock;
+
+    source_loc loc("formatter_bench.cpp", 123, "bench_formatter");
+    base::log_msg msg(sys_clock::now(), loc, level::info, text, "bench_logger");
+    fmt_memory_buf buf;
+
+    auto start_tp = steady_clock::now();
+    for (size_t i = 0; i < iters; ++i) {
+        buf.clear();
+        f.format(msg, buf);
+    }
+    return static_cast<double>(
+        std::chrono::duration_cast<nanoseconds>(steady_clock::now() - start_tp).count()) /
+        static_cast<double>(iters);
+}
+
+template <typename Pattern>
+void bench_static_pattern(size_t iters) {
+    pattern_formatter compiled(Pattern::value());
+    static_pattern_formatter<Pattern> static_formatter;
+    double compiled_ns = bench_format_ns(compiled, iters);
+    double static_ns = bench_format_ns(static_formatter, iters);
+
+    learnlog::info("{:36s}| {:<12.1f}| {:<12.1f}| {:<8.2f}",
+                   Pattern::value(), compiled_ns, static_ns, compiled_ns / static_ns);
+}
+
+// 每秒格式化的消息正文字节数，单位 MB/s
+void bench_json(const std::string& name, const std::string& text, size_t iters) {
+    auto mb_per_sec = [&text](double ns_per_msg) {
+        return static_cast<double>(text.size()) / ns_per_msg * 1e9 / (1024 * 1024);
+    };
+
+    // 与 json_formatter 字段相同，但不转义
+    pattern_formatter pattern("{\"time\":\"%Y-%m-%dT%T.%F\",\"level\":\"%l\",\"logger\":\"%n\","
+                              "\"tid\":%t,\"file\":\"%A\",\"line\":%B,\"func\":\"%C\",\"message\":\"%v\"}",
+                              "\n");
+    json_formatter scalar("\n", json_escape_isa::scalar);
+    json_formatter sse2("\n", json_escape_isa::sse2);
+    json_formatter avx2("\n", json_escape_isa::avx2);
+    double pattern_ns = bench_format_ns(pattern, iters, text);
+    double scalar_ns = bench_format_ns(scalar, iters, text);
+    double sse2_ns = bench_format_ns(sse2, iters, text);
+    double avx2_ns = bench_format_ns(avx2, iters, text);
+
+    learnlog::info("{:20s}| {:<10.1f}| {:<10.1f}| {:<10.1f}| {:<10.1f}", name,
+                   mb_per_sec(pattern_ns), mb_per_sec(scalar_ns),
+                   mb_per_sec(sse2_ns), mb_per_sec(avx2_ns));
+}
+
+std::unique_ptr<flag_formatter> make_flag_formatter(char flag, const spaces_info& sp_info) {
+    switch (flag) {
+        case '+': return learnlog::make_unique<full_formatter>(sp_info);
+        case 'n': return learnlog::make_unique<name_formatter>(sp_info);
+        case 'l': return learnlog::make_unique<level_formatter>(sp_info);
+        case 'a': return learnlog::make_unique<a_formatter>(sp_info);
+        case 'b': return learnlog::make_unique<b_formatter>(sp_info);
+        case 'c': return learnlog::make_unique<c_formatter>(sp_info);
+        case 'y': return learnlog::make_unique<y_formatter>(sp_info);
+        case 'm': return learnlog::make_unique<m_formatter>(sp_info);
+        case 'd': return learnlog::make_unique<d_formatter>(sp_info);
+        case 'H': return learnlog::make_unique<H_formatter>(sp_info);
+        case 'M': return learnlog::make_unique<M_formatter>(sp_info);
+        case 'S': return learnlog::make_unique<S_formatter>(sp_info);
+        case 'E': return learnlog::make_unique<E_formatter>(sp_info);
+        case 'F': return learnlog::make_unique<F_formatter>(sp_info);
+        case 'G': return learnlog::make_unique<G_formatter>(sp_info);
+        case 'T': return learnlog::make_unique<T_formatter>(sp_info);
+        case 'X': return learnlog::make_unique<duration_formatter<microseconds> >(sp_info);
+        case 'p': return learnlog::make_unique<p_formatter>(sp_info);
+        case 't': return learnlog::make_unique<t_formatter>(sp_info);
+        case 'v': return learnlog::make_unique<v_formatter>(sp_info);
+        case '^': return learnlog::make_unique<color_start_formatter>(sp_info);
+        case '$': return learnlog::make_unique<color_end_formatter>(sp_info);
+        case '@': return learnlog::make_unique<source_loc_formatter>(sp_info);
+        case 'A': return learnlog::make_unique<source_filename_formatter>(sp_info);
+        case 'B': return learnlog::make_unique<source_linenum_formatter>(sp_info);
+        case 'C': return learnlog::make_unique<source_funcname_formatter>(sp_info);
+        default: {
+            auto unknown_flag = learnlog::make_unique<aggregate_formatter>();
+            unknown_flag->add_ch('%');
+            unknown_flag->add_ch(flag);
+            std::unique_ptr<flag_formatter> result = std::move(unknown_flag);
+            return result;
+        }
+    }
+}
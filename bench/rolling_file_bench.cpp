@@ -0,0 +1,118 @@
+#include "learnlog.h"
+#include "sinks/basic_file_sink.h"
+#include "sinks/rolling_file_sink.h"
+#include "sinks/time_rolling_file_sink.h"
+
+#include <algorithm>
+#include <chrono>
+
+struct rolling_mode {
+    std::string name;
+    size_t max_file_size;   // 0 表示不滚动，使用 basic_file_sink 作为对照
+    size_t max_file_num;
+    bool hourly;            // 使用 time_rolling_file_sink 按小时滚动，测试中不会发生滚动
+};
+
+void bench_rolling(const rolling_mode& mode, size_t msg_num, size_t msg_size);
+
+int main(int argc, char *argv[]) {
+    size_t msg_num = 1000000;
+
+    try {
+        learnlog::set_global_pattern("[%^%l%$] %v");
+        learnlog::set_global_log_level(learnlog::level::debug);
+
+        if (argc > 1) {
+            msg_num = static_cast<size_t>(atoll(argv[1]));
+        }
+        if (argc > 2) {
+            learnlog::error("Unknown args! Usage: {} <msg_num>", argv[0]);
+            return 0;
+        }
+
+        const std::vector<rolling_mode> modes = {
+            {"no rolling", 0, 0, false},
+            {"hourly (no roll)", 0, 0, true},
+            {"roll 1 MB x 4", 1024 * 1024, 4, false},
+            {"roll 256 KB x 4", 256 * 1024, 4, false},
+            {"roll 64 KB x 4", 64 * 1024, 4, false},
+            {"roll 64 KB x 10000", 64 * 1024, 10000, false},
+        };
+
+        learnlog::info("*********************************");
+        learnlog::info("rolling_file_sink latency per log call (sync logger, single thread)");
+        learnlog::info("*********************************");
+        learnlog::info("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~");
+        learnlog::info("Messages            : {:L}", msg_num);
+        learnlog::info("~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~");
+        learnlog::info("-------------------------------------------------");
+        learnlog::info("{:19s}| {:<8s}| {:<8s}| {:<8s}| {:<9s}| {:<10s}| {:<8s}",
+                       "mode", "rolls", "p50 ns", "p99 ns", "p99.9 ns", "max ns", "avg ns");
+        learnlog::info("-------------------------------------------------");
+
+        for (auto& mode : modes) {
+            bench_rolling(mode, msg_num, 128);
+        }
+    }
+    LEARNLOG_CATCH
+
+    return 0;
+}
+
+void bench_rolling(const rolling_mode& mode, size_t msg_num, size_t msg_size) {
+    using std::chrono::steady_clock;
+
+#ifdef _WIN32
+    learnlog::filename_t fname = L"bench_tmp/rolling.log";
+#else
+    learnlog::filename_t fname = "bench_tmp/rolling.log";
+#endif
+    learnlog::base::os::remove_file_if_exist(fname);
+
+    learnlog::sink_shr_ptr sink;
+    if (mode.hourly) {
+#ifdef _WIN32
+        learnlog::filename_t pattern = L"bench_tmp/rolling_%Y%m%d_%H.log";
+#else
+        learnlog::filename_t pattern = "bench_tmp/rolling_%Y%m%d_%H.log";
+#endif
+        sink = std::make_shared<learnlog::sinks::time_rolling_file_sink_st>(
+            pattern, learnlog::sinks::rolling_period::hourly, 0, true);
+    }
+    else if (mode.max_file_size == 0) {
+        sink = std::make_shared<learnlog::sinks::basic_file_sink_st>(fname, true);
+    }
+    else {
+        sink = std::make_shared<learnlog::sinks::rolling_file_sink_st>(fname, mode.max_file_size,
+                                                                       mode.max_file_num);
+    }
+    learnlog::logger logger("rolling_file_bench", sink);
+    const std::string pattern = "[%T.%F] [%l] %v";
+    logger.set_pattern(pattern);
+    std::string text(msg_size, 'x');
+
+    learnlog::fmt_memory_buf line;
+    learnlog::sinks::pattern_formatter(pattern).format(
+        learnlog::base::log_msg(learnlog::level::info, text, logger.name()), line);
+    size_t rolls = mode.max_file_size == 0 ? 0 : line.size() * msg_num / mode.max_file_size;
+
+    std::vector<long long> latencies(msg_num);
+    auto total_start = steady_clock::now();
+    for (size_t i = 0; i < msg_num; ++i) {
+        auto start_tp = steady_clock::now();
+        logger.info(learnlog::fmt_string_view(text));
+        latencies[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            steady_clock::now() - start_tp).count();
+    }
+    double avg = std::chrono::duration<double, std::nano>(steady_clock::now() - total_start).count() /
+                 static_cast<double>(msg_num);
+    logger.flush();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+        return latencies[static_cast<size_t>(p * static_cast<double>(latencies.size() - 1))];
+    };
+    learnlog::info("{:19s}| {:<8d}| {:<8d}| {:<8d}| {:<9d}| {:<10d}| {:<8.1f}",
+                   mode.name, rolls, percentile(0.5), percentile(0.99), percentile(0.999),
+                   latencies.back(), avg);
+}
@@ -51,6 +51,11 @@ void use_default_logger() {
     learnlog::debug("前六个字符会被输出");
     
     learnlog::set_global_pattern("%+");
+
+    // 自动填入发生位置的宏，低于 LEARNLOG_ACTIVE_LEVEL 的宏在编译期被移除
+    learnlog::set_global_pattern("[%T] [%l] [%A:%B %C] %v");
+    LEARNLOG_INFO("Source location is filled in by {}", "LEARNLOG_INFO");
+    learnlog::set_global_pattern("%+");
 }
 
 class custom_formatter : public learnlog::sinks::custom_flag_formatter {
@@ -6,6 +6,7 @@
 #include "base/lock_thread_pool.h"
 #include "base/lockfree_thread_pool.h"
 #include "base/lockfree_concurrent_thread_pool.h"
+#include "base/spsc_thread_pool.h"
 
 #include <mutex>
 
@@ -25,7 +26,8 @@ struct async_factory_template {
         }
         else {
             auto tp_new = std::make_shared<Threadpool>(tp->message_queue_size(),
-                                                       tp->threads_size());
+                                                       tp->threads_size(),
+                                                       tp->worker_opts());
             if (tp_new->message_queue_type() != tp->message_queue_type()) {
                 tp = std::move(tp_new);
                 base::registry::instance().register_thread_pool(tp);
@@ -48,5 +50,8 @@ struct async_factory_template {
 using async_factory_lock = async_factory_template<base::lock_thread_pool>;
 using async_factory_lockfree = async_factory_template<base::lockfree_thread_pool>;
 using async_factory_lockfree_concurrent = async_factory_template<base::lockfree_concurrent_thread_pool>;
+// spsc_thread_pool 的 queue_size 是每个生产者线程的队列容量，
+// 每个写日志的线程占用 queue_size × sizeof(async_msg) 的空间
+using async_factory_spsc = async_factory_template<base::spsc_thread_pool>;
 
 }   // namespace learnlog
\ No newline at end of file
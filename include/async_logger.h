@@ -4,7 +4,7 @@
 #include "sinks/sink.h"
 #include "base/thread_pool.h"
 
-#include <future>
+#include <array>
 
 namespace learnlog {
 
@@ -37,6 +37,30 @@ public:
         logger::is_async_ = true;
     }
 
+    // 析构时从线程池注销句柄，等待本 logger 已提交的消息处理完后返回；
+    // 在该线程池的后台线程中析构时（如由 sink 释放最后一个引用）不等待，尚未输出的消息被丢弃
+    ~async_logger() override {
+        size_t handle = handle_.load(std::memory_order_acquire);
+        if (handle == base::invalid_logger_handle) {
+            return;
+        }
+        auto tp_ptr = thread_pool_.lock();
+        if (tp_ptr != nullptr) {
+            tp_ptr->deregister_logger(handle);
+        }
+    }
+
+    // 复制出的 logger 需要重新向线程池登记
+    async_logger(const async_logger& other)
+        : std::enable_shared_from_this<async_logger>(),
+          logger(other),
+          thread_pool_(other.thread_pool_) {}
+
+    // 开启后，参数可以编码的消息由后台线程格式化，调用线程只拷贝格式字符串与参数；
+    // 开启 backtrace 时仍在调用线程格式化
+    void set_deferred_format(bool enabled) { deferred_fmt_ = enabled; }
+    bool deferred_format() const { return deferred_fmt_; }
+
     logger_shr_ptr clone(std::string new_name) override {
         auto cloned = std::make_shared<async_logger>(*this);
         cloned->name_ = std::move(new_name);
@@ -51,7 +75,7 @@ private:
                 throw_learnlog_excpt(
                     "learnlog::async_logger: sink_log_() failed: thread pool does not exist");
             }
-            tp_ptr->enqueue_log(shared_from_this(), msg);
+            tp_ptr->enqueue_log(logger_handle_(*tp_ptr), msg);
         }
         LEARNLOG_CATCH
     }
@@ -63,25 +87,162 @@ private:
                 throw_learnlog_excpt(
                     "learnlog::async_logger: flush_sink_() failed: thread pool does not exist");
             }
-            std::future<void> future = tp_ptr->enqueue_flush(shared_from_this());
-            future.get();
+            tp_ptr->wait_flush(tp_ptr->enqueue_flush(logger_handle_(*tp_ptr)));
         }
         LEARNLOG_CATCH
     }
 
+    // 第一次提交消息时向线程池登记，之后只传递句柄，不再每条消息复制一次 shared_ptr
+    size_t logger_handle_(base::thread_pool& tp) {
+        size_t handle = handle_.load(std::memory_order_acquire);
+        if (handle == base::invalid_logger_handle) {
+            handle = tp.register_logger(this);
+            handle_.store(handle, std::memory_order_release);
+        }
+        return handle;
+    }
+
     friend class base::thread_pool;
     
-    void do_sink_log_(const base::log_msg& msg_popped) {
-        for (auto &sink : sinks_) {
-            if (sink->should_log(msg_popped.level)) {
-                try { sink->log(msg_popped); }
+    // 后台线程批量处理 log 消息，每个 sink 对整批消息只调用一次 log_batch()，
+    // 被 sink 等级过滤的消息不会传给该 sink；
+    // formatter 指纹相同的 sink 共享格式化结果，整批消息只格式化一次；
+    // 使用调用方后台线程的缓冲区，多个后台线程可以同时输出同一 logger 的消息
+    void do_sink_log_(const base::log_msg* const* msgs, size_t msg_num,
+                      base::sink_batch_buffers& bufs) {
+        bool should_flush = false;
+        level::level_enum max_level = level::trace;
+        for (size_t i = 0; i < msg_num; ++i) {
+            should_flush = should_flush || should_flush_(msgs[i]->level);
+            max_level = (std::max)(max_level, msgs[i]->level);
+        }
+
+        std::array<size_t, max_shared_sinks> leaders;
+        if (sinks_.size() > 1 && sinks_.size() <= max_shared_sinks &&
+            group_sinks_(leaders.data(), max_level)) {
+            shared_sink_batch_(msgs, msg_num, leaders.data(), bufs);
+        }
+        else {
+            for (auto &sink : sinks_) {
+                sink_batch_(*sink, msgs, msg_num, bufs.filtered);
+            }
+        }
+
+        // 已在后台线程中，直接刷新 sink，不再提交 flush 消息并等待自身处理
+        if (should_flush) {
+            do_flush_sink_();
+        }
+    }
+
+    void sink_batch_(sinks::sink& sink, const base::log_msg* const* msgs, size_t msg_num,
+                     std::vector<const base::log_msg*>& filtered) {
+        try {
+            size_t pass_cnt = 0;
+            for (size_t i = 0; i < msg_num; ++i) {
+                if (sink.should_log(msgs[i]->level)) { ++pass_cnt; }
+            }
+            if (pass_cnt == msg_num) {
+                sink.log_batch(msgs, msg_num);
+            }
+            else if (pass_cnt > 0) {
+                filtered.clear();
+                for (size_t i = 0; i < msg_num; ++i) {
+                    if (sink.should_log(msgs[i]->level)) { filtered.push_back(msgs[i]); }
+                }
+                sink.log_batch(filtered.data(), filtered.size());
+            }
+        }
+        LEARNLOG_CATCH
+    }
+
+    // 同一组中任一 sink 需要输出的消息，由该组第一个 sink 依次格式化到同一缓冲区，
+    // 每条消息的颜色区间换算为相对于自身格式化结果的位置；
+    // 格式化失败时，该组的 sink 退回 log_batch() 各自格式化
+    void shared_sink_batch_(const base::log_msg* const* msgs, size_t msg_num,
+                            const size_t* leaders, base::sink_batch_buffers& bufs) {
+        fmt_memory_buf& buf = bufs.formatted;
+        std::vector<size_t>& offsets = bufs.offsets;
+        std::vector<fmt_string_view>& views = bufs.views;
+        std::vector<fmt_string_view>& filtered_views = bufs.filtered_views;
+        std::vector<const base::log_msg*>& filtered = bufs.filtered;
+        offsets.resize(msg_num + 1);
+        views.resize(msg_num);
+        for (size_t g = 0; g < sinks_.size(); ++g) {
+            if (leaders[g] != g) {
+                continue;
+            }
+            if (group_size_(leaders, g) == 1) {
+                sink_batch_(*sinks_[g], msgs, msg_num, filtered);
+                continue;
+            }
+
+            bool formatted = false;
+            try {
+                buf.clear();
+                for (size_t i = 0; i < msg_num; ++i) {
+                    offsets[i] = buf.size();
+                    if (!group_should_log_(leaders, g, msgs[i]->level)) {
+                        continue;
+                    }
+                    const base::log_msg& msg = *msgs[i];
+                    msg.color_index_start = 0;
+                    msg.color_index_end = 0;
+                    sinks_[g]->format(msg, buf);
+                    if (msg.color_index_end > msg.color_index_start) {
+                        msg.color_index_start -= offsets[i];
+                        msg.color_index_end -= offsets[i];
+                    }
+                    else {
+                        msg.color_index_start = 0;
+                        msg.color_index_end = 0;
+                    }
+                }
+                offsets[msg_num] = buf.size();
+                formatted = true;
+            }
+            LEARNLOG_CATCH
+
+            // 缓冲区不再增长后才能取得格式化结果的地址
+            for (size_t i = 0; formatted && i < msg_num; ++i) {
+                views[i] = fmt_string_view(buf.data() + offsets[i], offsets[i + 1] - offsets[i]);
+            }
+            for (size_t j = g; j < sinks_.size(); ++j) {
+                if (leaders[j] != g) {
+                    continue;
+                }
+                if (!formatted) {
+                    sink_batch_(*sinks_[j], msgs, msg_num, filtered);
+                    continue;
+                }
+                try {
+                    filtered.clear();
+                    filtered_views.clear();
+                    for (size_t i = 0; i < msg_num; ++i) {
+                        if (sinks_[j]->should_log(msgs[i]->level)) {
+                            filtered.push_back(msgs[i]);
+                            filtered_views.push_back(views[i]);
+                        }
+                    }
+                    if (filtered.size() == msg_num) {
+                        sinks_[j]->write_formatted_batch(msgs, views.data(), msg_num);
+                    }
+                    else if (!filtered.empty()) {
+                        sinks_[j]->write_formatted_batch(filtered.data(), filtered_views.data(),
+                                                         filtered.size());
+                    }
+                }
                 LEARNLOG_CATCH
             }
         }
+    }
 
-        if (should_flush_(msg_popped.level)) {
-            flush_sink_();
+    bool group_should_log_(const size_t* leaders, size_t leader, level::level_enum msg_level) {
+        for (size_t j = leader; j < sinks_.size(); ++j) {
+            if (leaders[j] == leader && sinks_[j]->should_log(msg_level)) {
+                return true;
+            }
         }
+        return false;
     }
     
     void do_flush_sink_() {
@@ -92,6 +253,7 @@ private:
     }
 
     std::weak_ptr<base::thread_pool> thread_pool_;
+    std::atomic<size_t> handle_{base::invalid_logger_handle};
 };
 
 }   // namespace learnlog
\ No newline at end of file
@@ -154,14 +154,53 @@ struct source_loc {
         : filename{filename_in},
           line{line_in},
           funcname{funcname_in} {}
+    // 文件名长度已知（如 LEARNLOG_SOURCE_LOC 在编译期得到），格式化时不再计算 strlen
+    constexpr source_loc(const char* filename_in, size_t filename_len_in, int line_in,
+                         const char* funcname_in)
+        : filename{filename_in},
+          filename_len{filename_len_in},
+          line{line_in},
+          funcname{funcname_in} {}
 
     constexpr bool empty() const noexcept { return line <= 0; }
 
+    fmt_string_view filename_view() const {
+        return filename == nullptr ? fmt_string_view{} :
+               filename_len > 0 ? fmt_string_view(filename, filename_len) : fmt_string_view(filename);
+    }
+
     const char* filename{nullptr};
+    size_t filename_len{0};         // 为 0 时未知，由 filename_view() 计算
     int line{0};
     const char* funcname{nullptr};
 };
 
+namespace base {
+
+constexpr bool is_path_sep(char ch) { return ch == '/' || ch == '\\'; }
+
+constexpr size_t last_nonzero(size_t right, size_t left) { return right != 0 ? right : left; }
+
+// path 的 [begin, end) 中最后一个路径分隔符之后的下标，没有分隔符时为 0；
+// 二分递归，编译期求值时递归深度只有 log(n)，较长的路径也不会超过编译器的限制
+constexpr size_t basename_pos(const char* path, size_t begin, size_t end) {
+    return end - begin == 0 ? 0 :
+           end - begin == 1 ? (is_path_sep(path[begin]) ? begin + 1 : 0) :
+           last_nonzero(basename_pos(path, begin + (end - begin) / 2, end),
+                        basename_pos(path, begin, begin + (end - begin) / 2));
+}
+
+}   // namespace base
+
+// 当前位置的 source_loc，文件名只保留 __FILE__ 的最后一段，其位置与长度在编译期计算
+#define LEARNLOG_FILE_BASENAME_POS                                                     \
+    std::integral_constant<size_t,                                                     \
+        learnlog::base::basename_pos(__FILE__, 0, sizeof(__FILE__) - 1)>::value
+#define LEARNLOG_SOURCE_LOC                                                            \
+    learnlog::source_loc(__FILE__ + LEARNLOG_FILE_BASENAME_POS,                        \
+                         sizeof(__FILE__) - 1 - LEARNLOG_FILE_BASENAME_POS,            \
+                         __LINE__, static_cast<const char*>(__func__))
+
 
 #define LEARNLOG_LEVEL_TRACE 0
 #define LEARNLOG_LEVEL_DEBUG 1
@@ -171,6 +210,12 @@ struct source_loc {
 #define LEARNLOG_LEVEL_CRITICAL 5
 #define LEARNLOG_LEVEL_OFF 6
 #define LEARNLOG_LEVELS_NUM 7
+
+// 编译期的最低日志级别，低于该级别的 LEARNLOG_TRACE 等宏展开为空语句，参数也不会被求值，
+// 例如以 -DLEARNLOG_ACTIVE_LEVEL=LEARNLOG_LEVEL_INFO 编译时，LEARNLOG_DEBUG 没有任何开销
+#ifndef LEARNLOG_ACTIVE_LEVEL
+    #define LEARNLOG_ACTIVE_LEVEL LEARNLOG_LEVEL_TRACE
+#endif
 // 日志等级枚举
 namespace level {
 
@@ -8,6 +8,7 @@
 #include "sync_factory.h"
 #include "async_factory.h"
 #include "base/exception.h"
+#include "base/log_sampler.h"
 #include "version.h"
 
 namespace learnlog {
@@ -105,11 +106,24 @@ void remove_all();
 
 // 初始化一个新的线程池，
 // msg_queue_size 是日志消息缓冲区的大小，thread_num 是后台处理日志的线程数量，
+// opts 设置后台线程的线程名、绑定的 cpu、nice 值与调度策略，
+// pool_args 转发给线程池的构造函数，如 lockfree_thread_pool 的 overflow_policy，
 // 完成后自动调用 register_thread_pool() 注册
-template <typename Threadpool>
-void initialize_thread_pool(size_t msg_queue_size, size_t thread_num) {
+// example:
+//  learnlog::base::worker_options opts;
+//  opts.name = "log-io";
+//  opts.cpus = {6, 7};
+//  learnlog::initialize_thread_pool<learnlog::base::lockfree_thread_pool>(8192, 1, opts);
+//  learnlog::initialize_thread_pool<learnlog::base::lockfree_thread_pool>(
+//      8192, 1, opts, learnlog::base::overflow_policy::discard_new);
+template <typename Threadpool, typename... PoolArgs>
+void initialize_thread_pool(size_t msg_queue_size, size_t thread_num,
+                            const base::worker_options& opts = base::worker_options(),
+                            PoolArgs&&... pool_args) {
     base::registry::instance().initialize_thread_pool<Threadpool>(msg_queue_size, 
-                                                                  thread_num);
+                                                                  thread_num,
+                                                                  opts,
+                                                                  std::forward<PoolArgs>(pool_args)...);
 }
 
 // 注册线程池
@@ -186,6 +200,22 @@ async_logger_shr_ptr create_async_lockfree_concurrent(std::string logger_name,
                                                         std::forward<SinkArgs>(sink_args)...);
 }
 
+// 通过 async_factory 创建线程池为 spsc_thread_pool 的 async_logger 对象，
+// 创建时需要指定 logger 使用的 sink、logger 的名称以及 sink 的创建参数，
+// 每个写日志的线程独占一个容量为 queue_size 的队列，默认约占 440KB，占用空间随线程数增长
+// example:
+//  learnlog::create_async_spsc<learnlog::sinks::basic_file_sink_mt>("logger_name", 
+//                                                                   "filename");
+// 等同于:
+//  learnlog::basic_file_logger_mt<learnlog::async_factory_spsc>("logger_name", 
+//                                                               "filename");
+template <typename Sink, typename... SinkArgs>
+async_logger_shr_ptr create_async_spsc(std::string logger_name, 
+                                       SinkArgs &&...sink_args) {
+    return async_factory_spsc::create<Sink>(std::move(logger_name), 
+                                            std::forward<SinkArgs>(sink_args)...);
+}
+
 /* 以下是调用默认 logger 记录日志的接口，支持多种输入 */
 
 template <typename... Args>
@@ -273,4 +303,112 @@ void critical(const T& msg) {
     learnlog::get_default_logger()->critical(msg);
 }
 
-}   // namespace learnlog
\ No newline at end of file
+}   // namespace learnlog
+// 记录日志并自动填入发生位置（文件名、行号、函数名）的宏，文件名在编译期截取为 __FILE__ 的最后一段；
+// 低于 LEARNLOG_ACTIVE_LEVEL 的宏展开为 (void)0，格式字符串与参数都不会被编译进程序
+// example:
+//  LEARNLOG_INFO("connected to {}:{}", host, port);
+//  LEARNLOG_LOGGER_DEBUG(logger, "queue size: {}", size);
+#define LEARNLOG_LOGGER_CALL(logger, level, ...) \
+    (logger)->log(LEARNLOG_SOURCE_LOC, level, __VA_ARGS__)
+
+#if LEARNLOG_ACTIVE_LEVEL <= LEARNLOG_LEVEL_TRACE
+    #define LEARNLOG_LOGGER_TRACE(logger, ...) \
+        LEARNLOG_LOGGER_CALL(logger, learnlog::level::trace, __VA_ARGS__)
+    #define LEARNLOG_TRACE(...) LEARNLOG_LOGGER_TRACE(learnlog::get_default_logger(), __VA_ARGS__)
+#else
+    #define LEARNLOG_LOGGER_TRACE(logger, ...) (void)0
+    #define LEARNLOG_TRACE(...) (void)0
+#endif
+
+#if LEARNLOG_ACTIVE_LEVEL <= LEARNLOG_LEVEL_DEBUG
+    #define LEARNLOG_LOGGER_DEBUG(logger, ...) \
+        LEARNLOG_LOGGER_CALL(logger, learnlog::level::debug, __VA_ARGS__)
+    #define LEARNLOG_DEBUG(...) LEARNLOG_LOGGER_DEBUG(learnlog::get_default_logger(), __VA_ARGS__)
+#else
+    #define LEARNLOG_LOGGER_DEBUG(logger, ...) (void)0
+    #define LEARNLOG_DEBUG(...) (void)0
+#endif
+
+#if LEARNLOG_ACTIVE_LEVEL <= LEARNLOG_LEVEL_INFO
+    #define LEARNLOG_LOGGER_INFO(logger, ...) \
+        LEARNLOG_LOGGER_CALL(logger, learnlog::level::info, __VA_ARGS__)
+    #define LEARNLOG_INFO(...) LEARNLOG_LOGGER_INFO(learnlog::get_default_logger(), __VA_ARGS__)
+#else
+    #define LEARNLOG_LOGGER_INFO(logger, ...) (void)0
+    #define LEARNLOG_INFO(...) (void)0
+#endif
+
+#if LEARNLOG_ACTIVE_LEVEL <= LEARNLOG_LEVEL_WARN
+    #define LEARNLOG_LOGGER_WARN(logger, ...) \
+        LEARNLOG_LOGGER_CALL(logger, learnlog::level::warn, __VA_ARGS__)
+    #define LEARNLOG_WARN(...) LEARNLOG_LOGGER_WARN(learnlog::get_default_logger(), __VA_ARGS__)
+#else
+    #define LEARNLOG_LOGGER_WARN(logger, ...) (void)0
+    #define LEARNLOG_WARN(...) (void)0
+#endif
+
+#if LEARNLOG_ACTIVE_LEVEL <= LEARNLOG_LEVEL_ERROR
+    #define LEARNLOG_LOGGER_ERROR(logger, ...) \
+        LEARNLOG_LOGGER_CALL(logger, learnlog::level::error, __VA_ARGS__)
+    #define LEARNLOG_ERROR(...) LEARNLOG_LOGGER_ERROR(learnlog::get_default_logger(), __VA_ARGS__)
+#else
+    #define LEARNLOG_LOGGER_ERROR(logger, ...) (void)0
+    #define LEARNLOG_ERROR(...) (void)0
+#endif
+
+#if LEARNLOG_ACTIVE_LEVEL <= LEARNLOG_LEVEL_CRITICAL
+    #define LEARNLOG_LOGGER_CRITICAL(logger, ...) \
+        LEARNLOG_LOGGER_CALL(logger, learnlog::level::critical, __VA_ARGS__)
+    #define LEARNLOG_CRITICAL(...) LEARNLOG_LOGGER_CRITICAL(learnlog::get_default_logger(), __VA_ARGS__)
+#else
+    #define LEARNLOG_LOGGER_CRITICAL(logger, ...) (void)0
+    #define LEARNLOG_CRITICAL(...) (void)0
+#endif
+
+// 按调用位置限流的宏，每个调用位置有自己的静态 sampler，被抑制的调用不求值格式化参数，
+// 也不获取默认 logger；再次输出时在消息末尾附加上次输出以来被抑制的次数，如 "... (suppressed 12345 times)"，
+// level 低于 LEARNLOG_ACTIVE_LEVEL 时不输出
+// example:
+//  LEARNLOG_EVERY_N(learnlog::level::error, 1000, "read failed: {}", err);
+//  LEARNLOG_ONCE(learnlog::level::warn, "config {} not found, using defaults", path);
+//  LEARNLOG_LOGGER_EVERY_MS(logger, learnlog::level::error, 500, "queue full");
+//  LEARNLOG_RATE_LIMIT(learnlog::level::error, 10, 50, "dropped packet from {}", addr);
+#define LEARNLOG_LOGGER_SAMPLED_(sampler_decl, logger, level, ...)                              \
+    do {                                                                                        \
+        static sampler_decl;                                                                    \
+        size_t learnlog_suppressed_ = 0;                                                        \
+        if ((level) >= LEARNLOG_ACTIVE_LEVEL &&                                                 \
+            learnlog_sampler_.should_log(learnlog_suppressed_)) {                               \
+            learnlog::base::log_sampled(*(logger), LEARNLOG_SOURCE_LOC, level,                  \
+                                        learnlog_suppressed_, __VA_ARGS__);                     \
+        }                                                                                       \
+    } while (0)
+
+// 第 1、n+1、2n+1 ... 次调用输出
+#define LEARNLOG_LOGGER_EVERY_N(logger, level, n, ...)                                          \
+    LEARNLOG_LOGGER_SAMPLED_(learnlog::base::every_n_sampler learnlog_sampler_(n),              \
+                             logger, level, __VA_ARGS__)
+#define LEARNLOG_EVERY_N(level, n, ...)                                                         \
+    LEARNLOG_LOGGER_EVERY_N(learnlog::get_default_logger(), level, n, __VA_ARGS__)
+
+// 只输出第一次调用
+#define LEARNLOG_LOGGER_ONCE(logger, level, ...)                                                \
+    LEARNLOG_LOGGER_SAMPLED_(learnlog::base::once_sampler learnlog_sampler_,                    \
+                             logger, level, __VA_ARGS__)
+#define LEARNLOG_ONCE(level, ...)                                                               \
+    LEARNLOG_LOGGER_ONCE(learnlog::get_default_logger(), level, __VA_ARGS__)
+
+// 两次输出之间至少间隔 ms 毫秒
+#define LEARNLOG_LOGGER_EVERY_MS(logger, level, ms, ...)                                        \
+    LEARNLOG_LOGGER_SAMPLED_(learnlog::base::every_ms_sampler learnlog_sampler_(ms),            \
+                             logger, level, __VA_ARGS__)
+#define LEARNLOG_EVERY_MS(level, ms, ...)                                                       \
+    LEARNLOG_LOGGER_EVERY_MS(learnlog::get_default_logger(), level, ms, __VA_ARGS__)
+
+// 令牌桶限流，平均每秒最多 per_sec 条，突发最多 burst 条
+#define LEARNLOG_LOGGER_RATE_LIMIT(logger, level, per_sec, burst, ...)                          \
+    LEARNLOG_LOGGER_SAMPLED_(learnlog::base::token_bucket_sampler learnlog_sampler_(per_sec, burst), \
+                             logger, level, __VA_ARGS__)
+#define LEARNLOG_RATE_LIMIT(level, per_sec, burst, ...)                                         \
+    LEARNLOG_LOGGER_RATE_LIMIT(learnlog::get_default_logger(), level, per_sec, burst, __VA_ARGS__)
@@ -4,6 +4,7 @@
 #include "base/exception.h"
 #include "base/log_msg.h"
 #include "base/backtracer.h"
+#include "base/deferred_args.h"
 
 #include <vector>
 #include <atomic>
@@ -208,6 +209,7 @@ protected:
     level::level_enum flush_level_ = level::off;
     std::string pattern_ = "%+";
     bool is_async_ = false;  
+    bool deferred_fmt_ = false;     // 只有 async_logger 可以开启
 
     bool should_log_(level::level_enum msg_level) const {
         return msg_level >= log_level_;
@@ -217,6 +219,16 @@ protected:
         return (msg_level >= flush_level_) && (msg_level != level::off);
     }
 
+    static const size_t max_shared_sinks = 16;          // sink 个数超过该值时不共享格式化结果
+    static const size_t no_sink = static_cast<size_t>(-1);
+
+    // 按 formatter 指纹把输出 msg_level 等级消息的 sink 分组，leaders[i] 为 sink i 所在组第一个 sink 的下标，
+    // 不输出的 sink 为 no_sink，指纹为 0 的 sink 自成一组；返回是否有两个及以上的 sink 在同一组
+    bool group_sinks_(size_t* leaders, level::level_enum msg_level) const;
+    size_t group_size_(const size_t* leaders, size_t leader) const;
+    // 同一组的 sink 只由第一个 sink 格式化一次，格式化结果通过 write_formatted() 分别输出
+    void shared_sink_log_(const base::log_msg& msg, const size_t* leaders);
+
     template <typename... Args>
     void log_(source_loc loc, level::level_enum level, fmt_string_view fmt_strv, Args &&...args) {
         bool log_enabled = should_log_(level);
@@ -228,6 +240,13 @@ protected:
             return;
         }
         try {
+            using deferred = base::deferred_args<typename std::decay<Args>::type...>;
+            if (deferred_fmt_ && !backtrace_enabled &&
+                log_deferred_(std::integral_constant<bool, deferred::supported>{},
+                              loc, level, fmt_strv, args...)) {
+                return;
+            }
+
             fmt_memory_buf buf;
             fmt::vformat_to(fmt::appender(buf), fmt_strv, fmt::make_format_args(args...));
         
@@ -237,6 +256,32 @@ protected:
         LEARNLOG_CATCH
     }
 
+    // 参数都可以编码时，只编码格式字符串与参数，交给后台线程格式化；
+    // 返回 false 表示需要在调用线程格式化
+    template <typename... Args>
+    bool log_deferred_(std::true_type, source_loc loc, level::level_enum level, 
+                       fmt_string_view fmt_strv, const Args &...args) {
+        using deferred = base::deferred_args<typename std::decay<Args>::type...>;
+        if (!deferred::valid(args...)) {
+            return false;
+        }
+        fmt_memory_buf buf;
+        buf.append(fmt_strv.begin(), fmt_strv.end());
+        deferred::encode(buf, args...);
+
+        base::log_msg log_msg(loc, level, fmt_string_view(buf.data(), buf.size()), name_);
+        log_msg.format_deferred = &base::format_deferred_args<typename std::decay<Args>::type...>;
+        log_msg.deferred_fmt_size = fmt_strv.size();
+        sink_log_(log_msg);
+        return true;
+    }
+
+    template <typename... Args>
+    bool log_deferred_(std::false_type, source_loc, level::level_enum, 
+                       fmt_string_view, const Args &...) {
+        return false;
+    }
+
     void do_log_(const base::log_msg& msg, bool log_enabled, bool backtrace_enabled);
     virtual void sink_log_(const base::log_msg& msg);
     virtual void flush_sink_();
@@ -0,0 +1,4 @@
+// learnlog version
+#define LEARNLOG_VERSION_MAJOR 1
+#define LEARNLOG_VERSION_MINOR 0
+#define LEARNLOG_VERSION_PATCH 3
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "sinks/basic_sink.h"
+#include "base/aio_file.h"
+#include "base/null_mutex.h"
+#include "sync_factory.h"
+
+namespace learnlog {
+namespace sinks {
+
+// basic_sink 的派生类，只支持 unix，
+// 是模板参数为 Mutex 的模板类，在需要保证线程安全时传入 std::mutex，不需要时传入 base::null_mutex，
+// aio_file_sink 把格式化后的 log_msg 追加到大的缓冲区，缓冲区写满时异步提交写入（见 base::aio_file），
+// 优先使用 io_uring，不可用时退回专用的 pwrite 线程，写入线程（如异步 logger 的后台线程）不等待磁盘；
+// flush() 只提交当前缓冲区，不等待写入完成，需要确认日志已写入文件时调用 drain()，写入磁盘时调用 sync()；
+// 只有全部缓冲区都在途时写入才会等待，此时可增大 buffer_count
+
+template <typename Mutex>
+class aio_file_sink final : public basic_sink<Mutex> {
+public:
+    explicit aio_file_sink(const filename_t& filename,
+                           bool truncate = false,
+                           const base::aio_file_options& opts = {})
+        : filename_(filename),
+          file_(opts) {
+        file_.open(filename_, truncate);
+        basic_sink<Mutex>::enable_formatted_output_();
+    }
+
+    // 写入错误延迟到 close() 时抛出（如最后几块缓冲区遇到 ENOSPC、EIO），析构时只输出异常信息
+    ~aio_file_sink() override {
+        try {
+            file_.close();
+        }
+        catch (const std::exception& e) {
+            learnlog::handle_excpt(e.what());
+        }
+        catch (...) {
+            learnlog::handle_excpt("learnlog::aio_file_sink: unknown exception in destructor");
+        }
+    }
+
+    filename_t filename() const { return filename_; }
+
+    // 文件大小，包括还未写入文件的部分
+    u_long_long size() {
+        std::lock_guard<Mutex> lock(basic_sink<Mutex>::mutex_);
+        return file_.size();
+    }
+
+    // 等待已输出的日志全部写入文件
+    void drain() {
+        std::lock_guard<Mutex> lock(basic_sink<Mutex>::mutex_);
+        file_.drain();
+    }
+
+    // 把已输出的日志写入磁盘
+    void sync() {
+        std::lock_guard<Mutex> lock(basic_sink<Mutex>::mutex_);
+        file_.sync();
+    }
+
+    bool uses_io_uring() {
+        std::lock_guard<Mutex> lock(basic_sink<Mutex>::mutex_);
+        return file_.uses_io_uring();
+    }
+
+protected:
+    void output_(const base::log_msg &msg) override {
+        fmt_memory_buf& buf = basic_sink<Mutex>::output_buf_();
+        basic_sink<Mutex>::formatter_->format(msg, buf);
+        file_.write(buf.data(), buf.size());
+    }
+
+    void output_batch_(const base::log_msg* const* msgs, size_t msg_num) override {
+        fmt_memory_buf& buf = basic_sink<Mutex>::output_buf_();
+        for (size_t i = 0; i < msg_num; ++i) {
+            basic_sink<Mutex>::formatter_->format(*msgs[i], buf);
+        }
+        file_.write(buf.data(), buf.size());
+    }
+
+    void output_formatted_(const base::log_msg &, fmt_string_view formatted) override {
+        file_.write(formatted.data(), formatted.size());
+    }
+
+    void flush_() override {
+        file_.flush();
+    }
+
+private:
+    filename_t filename_;
+    base::aio_file file_;
+};
+
+using aio_file_sink_mt = aio_file_sink<std::mutex>;
+using aio_file_sink_st = aio_file_sink<base::null_mutex>;
+
+}    // namespace sinks
+
+// factory 函数，创建使用 aio_file_sink 的 logger 对象
+
+template <typename Factory = learnlog::sync_factory>
+logger_shr_ptr aio_file_logger_mt(const std::string& logger_name,
+                                  const filename_t& filename,
+                                  bool truncate = false,
+                                  const base::aio_file_options& opts = {}) {
+    return Factory::template create<sinks::aio_file_sink_mt>(logger_name, filename, truncate, opts);
+}
+
+template <typename Factory = learnlog::sync_factory>
+logger_shr_ptr aio_file_logger_st(const std::string& logger_name,
+                                  const filename_t& filename,
+                                  bool truncate = false,
+                                  const base::aio_file_options& opts = {}) {
+    return Factory::template create<sinks::aio_file_sink_st>(logger_name, filename, truncate, opts);
+}
+
+}    // namespace learnlog
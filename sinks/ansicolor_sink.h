@@ -32,6 +32,7 @@ public:
         level_colors_.at(level::off) = reset;
 
         is_color_enabled_ = base::os::in_terminal(file_) && base::os::is_color_terminal();
+        fingerprint_.store(formatter_->fingerprint(), std::memory_order_relaxed);
     }
     ~ansicolor_sink() override = default;
 
@@ -51,7 +52,39 @@ public:
         msg.color_index_end = 0;
         fmt_memory_buf buf;
         formatter_->format(msg, buf);
+        write_(msg, fmt_string_view(buf.data(), buf.size()));
+    }
+
+    // 颜色区间由 logger 格式化时记录在 msg 中
+    void write_formatted(const base::log_msg& msg, fmt_string_view formatted) override {
+        std::lock_guard<mutex_t> lock(mutex_);
+        write_(msg, formatted);
+    }
+
+    void format(const base::log_msg& msg, fmt_memory_buf& dest_buf) override {
+        std::lock_guard<mutex_t> lock(mutex_);
+        formatter_->format(msg, dest_buf);
+    }
+
+    void flush() override {
+        std::lock_guard<mutex_t> lock(mutex_);
+        ::fflush(file_);
+    }
+
+    void set_pattern(const std::string& pattern) override {
+        std::lock_guard<mutex_t> lock(mutex_);
+        formatter_ = learnlog::make_unique<pattern_formatter>(pattern);
+        fingerprint_.store(formatter_->fingerprint(), std::memory_order_relaxed);
+    }
 
+    void set_formatter(formatter_uni_ptr formatter) override {
+        std::lock_guard<mutex_t> lock(mutex_);
+        formatter_ = std::move(formatter);
+        fingerprint_.store(formatter_->fingerprint(), std::memory_order_relaxed);
+    }
+
+private:
+    void write_(const base::log_msg& msg, fmt_string_view buf) {
         std::string level_color = level_colors_.at(static_cast<size_t>(msg.level));
         size_t bytes_written = 0;
         size_t bytes;
@@ -80,22 +113,6 @@ public:
         }
     }
 
-    void flush() override {
-        std::lock_guard<mutex_t> lock(mutex_);
-        ::fflush(file_);
-    }
-
-    void set_pattern(const std::string& pattern) override {
-        std::lock_guard<mutex_t> lock(mutex_);
-        formatter_ = learnlog::make_unique<pattern_formatter>(pattern);
-    }
-
-    void set_formatter(formatter_uni_ptr formatter) override {
-        std::lock_guard<mutex_t> lock(mutex_);
-        formatter_ = std::move(formatter);
-    }
-
-private:
     mutex_t& mutex_;
     FILE* file_;
     formatter_uni_ptr formatter_;
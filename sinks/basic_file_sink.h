@@ -2,9 +2,13 @@
 
 #include "sinks/basic_sink.h"
 #include "base/file_base.h"
+#include "base/buffered_file.h"
 #include "base/null_mutex.h"
+#include "base/periodic_function.h"
 #include "sync_factory.h"
 
+#include <type_traits>
+
 namespace learnlog {
 namespace sinks {
 
@@ -12,37 +16,123 @@ namespace sinks {
 // 是模板参数为 Mutex 的模板类，在需要保证线程安全时传入 std::mutex，不需要时传入 base::null_mutex，
 // basic_file_sink 在构造时打开路径 filename 指向的文件（不存在时创建），在析构时关闭文件，
 // 构造时的参数 truncate 指定是否清空文件已有内容，
-// basic_file_sink 覆写了父类的 output_()、flush_() 函数，将格式化后的 log_msg 写入单个文件
+// basic_file_sink 覆写了父类的 output_()、output_batch_()、flush_() 函数，将格式化后的 log_msg 写入单个文件，
+// 批量输出时整批 log_msg 格式化到同一缓冲区，只写入一次；
+// 支持直接输出 logger 已经格式化好的日志消息；
+// buffer_opts.buffer_size 不为 0 时，绕过 FILE* 直接以文件描述符写入，
+// 日志先追加到 sink 持有的大缓冲区，写满、flush() 或超过 buffer_opts.flush_interval 时才写入文件，
+// 详见 base::buffered_file；
+// 设置 flush_interval 时 _mt 版本另起一个线程，每隔 flush_interval 加锁写出缓冲区，没有新的写入也能按时落盘，
+// _st 版本不能在其他线程访问，只在写入时检查 flush_interval
 
 template <typename Mutex>
 class basic_file_sink final : public basic_sink<Mutex> {
 public:
     explicit basic_file_sink(const filename_t& filename,
-                             bool truncate = false)
+                             bool truncate = false,
+                             const base::file_buffer_options& buffer_opts = base::file_buffer_options())
         : filename_(filename) {
-        base::file_base::open(&file_, filename_, truncate);
+        if (buffer_opts.buffer_size > 0) {
+            buffered_ = learnlog::make_unique<base::buffered_file>(buffer_opts);
+            buffered_->open(filename_, truncate);
+            if (buffer_opts.flush_interval.count() > 0 &&
+                !std::is_same<Mutex, base::null_mutex>::value) {
+                flusher_ = learnlog::make_unique<base::periodic_function>(
+                    [this] { flush_buffered_(); }, buffer_opts.flush_interval);
+            }
+        }
+        else {
+            base::file_base::open(&file_, filename_, truncate);
+        }
+        basic_sink<Mutex>::enable_formatted_output_();
     }
     
+    // 先停止定时线程；析构函数不能抛出异常，关闭失败时只输出异常信息
     ~basic_file_sink() override {
-        basic_sink<Mutex>::flush();
-        base::file_base::close(&file_, filename_);
+        flusher_.reset();
+        try {
+            basic_sink<Mutex>::flush();
+            if (buffered_ != nullptr) {
+                buffered_->close();
+            }
+            base::file_base::close(&file_, filename_);
+        }
+        catch (const std::exception& e) {
+            learnlog::handle_excpt(e.what());
+        }
+        catch (...) {
+            learnlog::handle_excpt("learnlog::basic_file_sink: unknown exception in destructor");
+        }
     }
 
     filename_t filename() const { return filename_; }
 
 protected:
     void output_(const base::log_msg &msg) override {
-        fmt_memory_buf buf;
+        fmt_memory_buf& buf = basic_sink<Mutex>::output_buf_();
         basic_sink<Mutex>::formatter_->format(msg, buf);
-        base::file_base::write(file_, filename_, buf);
+        write_(buf.data(), buf.size());
+    }
+
+    void output_batch_(const base::log_msg* const* msgs, size_t msg_num) override {
+        fmt_memory_buf& buf = basic_sink<Mutex>::output_buf_();
+        for (size_t i = 0; i < msg_num; ++i) {
+            basic_sink<Mutex>::formatter_->format(*msgs[i], buf);
+        }
+        write_(buf.data(), buf.size());
     }
     
+    void output_formatted_(const base::log_msg &, fmt_string_view formatted) override {
+        write_(formatted.data(), formatted.size());
+    }
+
+    // 地址连续的格式化结果合并为一次写入
+    void output_formatted_batch_(const base::log_msg* const*,
+                                 const fmt_string_view* formatted, size_t msg_num) override {
+        size_t i = 0;
+        while (i < msg_num) {
+            const char* begin = formatted[i].data();
+            const char* end = begin + formatted[i].size();
+            for (++i; i < msg_num && formatted[i].data() == end; ++i) {
+                end += formatted[i].size();
+            }
+            write_(begin, static_cast<size_t>(end - begin));
+        }
+    }
+
     void flush_() override {
-        base::file_base::flush(file_, filename_);
+        if (buffered_ != nullptr) {
+            buffered_->flush();
+        }
+        else {
+            base::file_base::flush(file_, filename_);
+        }
     }
 
 private:
+    // 定时线程调用，与输出日志的线程共用 sink 的锁
+    void flush_buffered_() {
+        std::lock_guard<Mutex> lock(basic_sink<Mutex>::mutex_);
+        try {
+            if (buffered_->buffered() > 0) {
+                buffered_->flush();
+            }
+        }
+        LEARNLOG_CATCH
+    }
+
+    void write_(const char* data, size_t size) {
+        if (buffered_ != nullptr) {
+            buffered_->write(data, size);
+        }
+        else {
+            base::file_base::write(file_, filename_, data, size);
+        }
+    }
+
     FILE* file_{nullptr};
+    std::unique_ptr<base::buffered_file> buffered_;     // 启用写合并时代替 file_
+    std::unique_ptr<base::periodic_function> flusher_;  // 按 flush_interval 定时写出缓冲区
     filename_t filename_;
 };
 
@@ -56,15 +146,19 @@ using basic_file_sink_st = basic_file_sink<base::null_mutex>;
 template <typename Factory = learnlog::sync_factory>
 logger_shr_ptr basic_file_logger_mt(const std::string& logger_name,
                                     const filename_t& filename,
-                                    bool truncate = false) {
-    return Factory::template create<sinks::basic_file_sink_mt>(logger_name, filename, truncate);
+                                    bool truncate = false,
+                                    const base::file_buffer_options& buffer_opts = base::file_buffer_options()) {
+    return Factory::template create<sinks::basic_file_sink_mt>(logger_name, filename, truncate,
+                                                               buffer_opts);
 }
 
 template <typename Factory = learnlog::sync_factory>
 logger_shr_ptr basic_file_logger_st(const std::string& logger_name,
                                     const filename_t& filename,
-                                    bool truncate = false) {
-    return Factory::template create<sinks::basic_file_sink_st>(logger_name, filename, truncate);
+                                    bool truncate = false,
+                                    const base::file_buffer_options& buffer_opts = base::file_buffer_options()) {
+    return Factory::template create<sinks::basic_file_sink_st>(logger_name, filename, truncate,
+                                                               buffer_opts);
 }
 
 }    // namespace learnlog
\ No newline at end of file
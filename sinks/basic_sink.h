@@ -10,9 +10,13 @@ namespace sinks {
 
 // sink 的派生类，
 // 是模板参数为 Mutex 的模板类，在需要保证线程安全时传入 std::mutex，不需要时传入 base::null_mutex，
-// basic_sink 覆写了父类的 log()、flush()、set_pattern()、set_formatter() 函数，并
-// 分别交由自己的虚函数 output_()、flush_()、set_pattern_()、set_formatter_() 实现，
-// 其中 output_()、flush_() 是纯虚函数，basic_sink 的子类中必须要实现
+// basic_sink 覆写了父类的 log()、log_batch()、flush()、set_pattern()、set_formatter() 函数，并
+// 分别交由自己的虚函数 output_()、output_batch_()、flush_()、set_pattern_()、set_formatter_() 实现，
+// 其中 output_()、flush_() 是纯虚函数，basic_sink 的子类中必须要实现，
+// log_batch() 对一批日志消息只加锁一次；
+// 子类覆写 output_formatted_() 并在构造时调用 enable_formatted_output_() 后，
+// 可以直接输出 logger 已经格式化好的日志消息，与其他 formatter 相同的 sink 共享格式化结果；
+// 子类在持有 mutex_ 时通过 output_buf_() 复用同一个格式化缓冲区，避免长消息每次重新分配内存
 
 template <typename Mutex>
 class basic_sink : public sink {
@@ -31,6 +35,27 @@ public:
         output_(msg);
     }
 
+    void log_batch(const base::log_msg* const* msgs, size_t msg_num) final override {
+        std::lock_guard<Mutex> lock(mutex_);
+        output_batch_(msgs, msg_num);
+    }
+
+    void write_formatted(const base::log_msg& msg, fmt_string_view formatted) final override {
+        std::lock_guard<Mutex> lock(mutex_);
+        output_formatted_(msg, formatted);
+    }
+
+    void write_formatted_batch(const base::log_msg* const* msgs,
+                               const fmt_string_view* formatted, size_t msg_num) final override {
+        std::lock_guard<Mutex> lock(mutex_);
+        output_formatted_batch_(msgs, formatted, msg_num);
+    }
+
+    void format(const base::log_msg& msg, fmt_memory_buf& dest_buf) final override {
+        std::lock_guard<Mutex> lock(mutex_);
+        formatter_->format(msg, dest_buf);
+    }
+
     void flush() final override {
         std::lock_guard<Mutex> lock(mutex_);
         flush_();
@@ -39,17 +64,50 @@ public:
     void set_pattern(const std::string &pattern) final override {
         std::lock_guard<Mutex> lock(mutex_);
         set_pattern_(pattern);
+        update_fingerprint_();
     }
 
     void set_formatter(formatter_uni_ptr formatter) final override {
         std::lock_guard<Mutex> lock(mutex_);
         set_formatter_(std::move(formatter));
+        update_fingerprint_();
     }
 
 protected:
     virtual void output_(const base::log_msg &msg) = 0;
     virtual void flush_() = 0;
 
+    // 默认逐条调用 output_()，子类可覆写，例如把整批消息格式化到同一缓冲区后一次写入
+    virtual void output_batch_(const base::log_msg* const* msgs, size_t msg_num) {
+        for (size_t i = 0; i < msg_num; ++i) {
+            output_(*msgs[i]);
+        }
+    }
+
+    // 输出已经格式化好的日志消息，默认忽略 formatted，调用 output_() 重新格式化
+    virtual void output_formatted_(const base::log_msg& msg, fmt_string_view formatted) {
+        (void)formatted;
+        output_(msg);
+    }
+
+    virtual void output_formatted_batch_(const base::log_msg* const* msgs,
+                                         const fmt_string_view* formatted, size_t msg_num) {
+        for (size_t i = 0; i < msg_num; ++i) {
+            output_formatted_(*msgs[i], formatted[i]);
+        }
+    }
+
+    // 子类覆写 output_formatted_() 后在构造函数中调用，之后 formatter_ 的指纹对 logger 可见
+    void enable_formatted_output_() {
+        formatted_output_ = true;
+        update_fingerprint_();
+    }
+
+    void update_fingerprint_() {
+        size_t fp = (formatted_output_ && formatter_ != nullptr) ? formatter_->fingerprint() : 0;
+        sink::fingerprint_.store(fp, std::memory_order_relaxed);
+    }
+
     // 以模板字符串 pattern 创建 pattern_formatter
     virtual void set_pattern_(const std::string &pattern) {
         formatter_ = learnlog::make_unique<pattern_formatter>(pattern);
@@ -59,8 +117,24 @@ protected:
         formatter_ = std::move(formatter);
     }
 
+    // 返回清空后的格式化缓冲区，只能在持有 mutex_ 时使用；
+    // 扩容后保留容量，上一次扩容超过 max_reuse_capacity 时先释放，避免长期占用大块内存
+    fmt_memory_buf& output_buf_() {
+        if (output_buf_storage_.capacity() > max_reuse_capacity) {
+            output_buf_storage_ = fmt_memory_buf();
+        }
+        output_buf_storage_.clear();
+        return output_buf_storage_;
+    }
+
+    static const size_t max_reuse_capacity = 64 * 1024;
+
     formatter_uni_ptr formatter_;
     Mutex mutex_;
+    bool formatted_output_{false};      // 子类是否实现了 output_formatted_()
+
+private:
+    fmt_memory_buf output_buf_storage_;
 };
 
 }   // namespace sinks
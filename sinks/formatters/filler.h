@@ -38,7 +38,6 @@ public:
         
         if(!spaces_info_.enabled()) return;     // 如果 spaces_info 信息无效则不填充空格
         
-        spaces_.resize(MAX_SPACES_LEN, ' ');        // 最大空格填充数为 MAX_SPACES_LEN
         spaces_to_fill_ = static_cast<int>(spaces_info_.target_len_ - msg_len);
         if(spaces_to_fill_ <= 0) return;
 
@@ -87,18 +86,25 @@ public:
     }
 
 private:
-    // 填充空格
+    // 填充空格，最大空格填充数为 MAX_SPACES_LEN
     void fill_spaces_(size_t len) {
-        base::fmt_base::append_string_view(fmt_string_view(spaces_.c_str(), len), 
+        base::fmt_base::append_string_view(fmt_string_view(spaces_table_(), len), 
                                             dest_buf_);
     }
 
+    // 静态空格表，填充时直接截取，不必每次构造空格字符串
+    static const char* spaces_table_() {
+        static const char spaces[] =
+            "                                                                ";
+        static_assert(sizeof(spaces) == MAX_SPACES_LEN + 1, "spaces table length mismatch");
+        return spaces;
+    }
+
     size_t msg_len_;                    // 填入的 msg 长度
     const spaces_info& spaces_info_;    // 空格填充信息
     fmt_memory_buf& dest_buf_;          // 目标缓冲区
     
-    int spaces_to_fill_;                // 剩余填充的空格数
-    std::string spaces_;                // 长度为 64 的空格字符串
+    int spaces_to_fill_{0};             // 剩余填充的空格数
 };
 
 }    // namespace sinks
@@ -373,11 +373,11 @@ public:
             return;
         }
 
-        size_t text_len = std::char_traits<char>::length(msg.loc.filename) +
+        size_t text_len = msg.loc.filename_view().size() +
                             base::fmt_base::count_unsigned_digits(msg.loc.line) + 1;
 
         filler f(text_len, spaces_info_, dest_buf);
-        base::fmt_base::append_string_view(msg.loc.filename, dest_buf);
+        base::fmt_base::append_string_view(msg.loc.filename_view(), dest_buf);
         dest_buf.push_back(':');
         base::fmt_base::append_int(msg.loc.line, dest_buf);
     }
@@ -394,9 +394,9 @@ public:
             filler f(0, spaces_info_, dest_buf);
             return;
         }
-        size_t text_len = std::char_traits<char>::length(msg.loc.filename);
+        size_t text_len = msg.loc.filename_view().size();
         filler f(text_len, spaces_info_, dest_buf);
-        f.fill_msg(msg.loc.filename);
+        f.fill_msg(msg.loc.filename_view());
     }
 };
 
@@ -492,7 +492,7 @@ public:
         // 如果 msg.loc 非空，以 "[filename:line]" 的形式加入 dest_buf
         if(!msg.loc.empty()) {
             dest_buf.push_back('[');
-            base::fmt_base::append_string_view(msg.loc.filename, dest_buf);
+            base::fmt_base::append_string_view(msg.loc.filename_view(), dest_buf);
             dest_buf.push_back(':');
             base::fmt_base::fill_uint(msg.loc.line, 5, dest_buf);
             dest_buf.push_back(']');
@@ -0,0 +1,396 @@
+#pragma once
+
+#include "definitions.h"
+#include "base/os.h"
+#include "base/log_msg.h"
+#include "sinks/formatters/formatter.h"
+#include "sinks/formatters/filler.h"
+#include "sinks/formatters/flag_formatter.h"
+#include "sinks/formatters/time_cache.h"
+
+#include <cstdint>
+#include <string>
+
+namespace learnlog {
+namespace sinks {
+
+// 预设格式字符对应的操作，pattern_formatter 在运行时按操作码分派，
+// static_pattern_formatter 在编译期确定操作，二者共用 format_flag<Op>() 的实现，输出逐字节一致；
+// literal 为连续的普通字符，custom 为自定义格式字符，二者由格式化器自行处理
+enum class flag_op : std::uint8_t {
+    literal, name, level, weekday, month_name, datetime,
+    year, month, day, hour, minute, second, millisec, microsec, nanosec, hms_time,
+    elapsed_ns, elapsed_us, elapsed_ms, elapsed_s,
+    pid, tid, payload, color_start, color_end,
+    source_loc, source_filename, source_linenum, source_funcname,
+    utc_offset, iso_sec, iso_ms, iso_us, iso_ns,
+    full, custom
+};
+
+// 格式字符对应的操作，'%' 与未知格式字符返回 literal
+constexpr flag_op flag_to_op(char flag) {
+    return flag == '+' ? flag_op::full :
+           flag == 'n' ? flag_op::name :
+           flag == 'l' ? flag_op::level :
+           flag == 'a' ? flag_op::weekday :
+           flag == 'b' ? flag_op::month_name :
+           flag == 'c' ? flag_op::datetime :
+           flag == 'y' ? flag_op::year :
+           flag == 'm' ? flag_op::month :
+           flag == 'd' ? flag_op::day :
+           flag == 'H' ? flag_op::hour :
+           flag == 'M' ? flag_op::minute :
+           flag == 'S' ? flag_op::second :
+           flag == 'E' ? flag_op::millisec :
+           flag == 'F' ? flag_op::microsec :
+           flag == 'G' ? flag_op::nanosec :
+           flag == 'T' ? flag_op::hms_time :
+           flag == 'W' ? flag_op::elapsed_ns :
+           flag == 'X' ? flag_op::elapsed_us :
+           flag == 'Y' ? flag_op::elapsed_ms :
+           flag == 'Z' ? flag_op::elapsed_s :
+           flag == 'p' ? flag_op::pid :
+           flag == 't' ? flag_op::tid :
+           flag == 'v' ? flag_op::payload :
+           flag == '^' ? flag_op::color_start :
+           flag == '$' ? flag_op::color_end :
+           flag == '@' ? flag_op::source_loc :
+           flag == 'A' ? flag_op::source_filename :
+           flag == 'B' ? flag_op::source_linenum :
+           flag == 'C' ? flag_op::source_funcname :
+           flag == 'z' ? flag_op::utc_offset :
+           flag == 'I' ? flag_op::iso_sec :
+           flag == 'J' ? flag_op::iso_ms :
+           flag == 'K' ? flag_op::iso_us :
+           flag == 'L' ? flag_op::iso_ns :
+           flag_op::literal;
+}
+
+// 该操作是否用到 log_msg.time 转换得到的 std::tm
+constexpr bool flag_op_needs_tm(flag_op op) {
+    return op == flag_op::full || op == flag_op::weekday || op == flag_op::month_name ||
+           op == flag_op::datetime || op == flag_op::year || op == flag_op::month ||
+           op == flag_op::day || op == flag_op::hour || op == flag_op::minute ||
+           op == flag_op::second || op == flag_op::hms_time || op == flag_op::utc_offset ||
+           op == flag_op::iso_sec || op == flag_op::iso_ms || op == flag_op::iso_us ||
+           op == flag_op::iso_ns || op == flag_op::custom;
+}
+
+constexpr bool flag_op_is_elapsed(flag_op op) {
+    return op == flag_op::elapsed_ns || op == flag_op::elapsed_us ||
+           op == flag_op::elapsed_ms || op == flag_op::elapsed_s;
+}
+
+// 格式模板 pattern、换行符 eol 与时区 zone 对应的格式化器指纹，不为 0，
+// pattern_formatter 与 static_pattern_formatter 的输出逐字节一致，指纹也相同
+inline size_t pattern_fingerprint(fmt_string_view pattern, fmt_string_view eol,
+                                  const time_zone& zone = time_zone{}) {
+    std::string key(pattern.data(), pattern.size());
+    key.push_back('\0');
+    key.append(eol.data(), eol.size());
+    if (zone.type != time_zone::kind::local) {
+        key.push_back('\0');
+        key.push_back(zone.type == time_zone::kind::utc ? 'u' : 'f');
+        key.append(std::to_string(zone.offset));
+    }
+    return intern_fingerprint(key);
+}
+
+namespace flag_ops {
+
+// 按空格填充信息写入字符串，未设置填充时直接写入
+inline void append_text(fmt_string_view text, const spaces_info& sp_info,
+                        fmt_memory_buf& dest_buf) {
+    if (!sp_info.enabled()) {
+        base::fmt_base::append_string_view(text, dest_buf);
+        return;
+    }
+    filler f(text.size(), sp_info, dest_buf);
+    f.fill_msg(text);
+}
+
+// 按空格填充信息写入以 '0' 为前缀、长度为 width 的无符号整数
+inline void append_uint(unsigned n, size_t width, const spaces_info& sp_info,
+                        fmt_memory_buf& dest_buf) {
+    if (!sp_info.enabled()) {
+        base::fmt_base::fill_uint(n, width, dest_buf);
+        return;
+    }
+    filler f(width, sp_info, dest_buf);
+    f.fill_msg(n);
+}
+
+// 按空格填充信息写入整数，不补前缀 '0'
+template <typename T>
+inline void append_number(T n, const spaces_info& sp_info, fmt_memory_buf& dest_buf) {
+    if (!sp_info.enabled()) {
+        base::fmt_base::append_int(n, dest_buf);
+        return;
+    }
+    filler f(base::fmt_base::count_unsigned_digits(n), sp_info, dest_buf);
+    base::fmt_base::append_int(n, dest_buf);
+}
+
+template <typename Metric>
+inline void append_elapsed(const base::log_msg& msg, sys_clock::time_point& last_time,
+                           const spaces_info& sp_info, fmt_memory_buf& dest_buf) {
+    auto delta = (std::max)(msg.time - last_time, sys_clock::duration::zero());
+    last_time = msg.time;
+    append_number(static_cast<size_t>(std::chrono::duration_cast<Metric>(delta).count()),
+                  sp_info, dest_buf);
+}
+
+// ISO 8601 / RFC 3339 日期时间，如 "2021-10-17T04:41:13.123+08:00"，UTC 时以 "Z" 结尾；
+// FracWidth 为秒以下的位数，为 0 时不写入秒以下的部分
+template <typename Metric, size_t FracWidth>
+inline void append_iso(const base::log_msg& msg, const cached_time& ct, const spaces_info& sp_info,
+                       fmt_memory_buf& dest_buf) {
+    char text[64];
+    fmt_string_view iso = ct.iso_view();
+    fmt_string_view offset = ct.offset_view();
+    std::copy(iso.data(), iso.data() + iso.size(), text);
+    size_t len = iso.size();
+    if (FracWidth > 0) {
+        text[len] = '.';
+        base::fmt_base::write_fixed<FracWidth == 0 ? 3 : FracWidth>(
+            static_cast<uint32_t>(base::fmt_base::precise_time<Metric>(msg.time).count()), text + len + 1);
+        len += FracWidth + 1;
+    }
+    std::copy(offset.data(), offset.data() + offset.size(), text + len);
+    len += offset.size();
+    append_text(fmt_string_view(text, len), sp_info, dest_buf);
+}
+
+// 格式化字符串为 "[%y-%m-%d %H:%M:%S.%E] [%n] [%l] [%s:%#] %v"，不受空格填充信息影响
+inline void append_full(const base::log_msg& msg, const cached_time& ct, fmt_memory_buf& dest_buf) {
+    dest_buf.push_back('[');
+    base::fmt_base::append_string_view(ct.datetime_view(), dest_buf);
+    dest_buf.push_back('.');
+
+    milliseconds ms = base::fmt_base::precise_time<milliseconds>(msg.time);
+    base::fmt_base::fill_uint(ms.count(), 3, dest_buf);
+    dest_buf.push_back(']');
+    dest_buf.push_back(' ');
+
+    if (msg.logger_name.size() > 0) {
+        dest_buf.push_back('[');
+        base::fmt_base::append_string_view(msg.logger_name, dest_buf);
+        dest_buf.push_back(']');
+        dest_buf.push_back(' ');
+    }
+
+    dest_buf.push_back('[');
+    msg.color_index_start = dest_buf.size();
+    base::fmt_base::append_string_view(level::level_name[static_cast<size_t>(msg.level)],
+                                       dest_buf);
+    msg.color_index_end = dest_buf.size();
+    dest_buf.push_back(']');
+    dest_buf.push_back(' ');
+
+    if (!msg.loc.empty()) {
+        dest_buf.push_back('[');
+        base::fmt_base::append_string_view(msg.loc.filename_view(), dest_buf);
+        dest_buf.push_back(':');
+        base::fmt_base::fill_uint(msg.loc.line, 5, dest_buf);
+        dest_buf.push_back(']');
+        dest_buf.push_back(' ');
+    }
+
+    base::fmt_base::append_string_view(msg.msg, dest_buf);
+}
+
+}   // namespace flag_ops
+
+// 执行操作 Op，Op 在编译期确定，switch 只保留对应的分支；
+// 与各 flag_formatter 派生类的输出逐字节一致，日期时间取自 time_cache 的缓存 ct，
+// last_time 只由 elapsed_* 使用
+template <flag_op Op>
+inline void format_flag(const base::log_msg& msg, const cached_time& ct,
+                        const spaces_info& sp_info, sys_clock::time_point& last_time,
+                        fmt_memory_buf& dest_buf) {
+    const std::tm& time_tm = ct.tm;
+    switch (Op) {
+        case flag_op::name:
+            flag_ops::append_text(msg.logger_name, sp_info, dest_buf);
+            break;
+
+        case flag_op::level:
+            flag_ops::append_text(level::level_name[static_cast<size_t>(msg.level)],
+                                  sp_info, dest_buf);
+            break;
+
+        case flag_op::weekday:
+            flag_ops::append_text(weekday_name[static_cast<size_t>(time_tm.tm_wday)],
+                                  sp_info, dest_buf);
+            break;
+
+        case flag_op::month_name:
+            flag_ops::append_text(month_name[static_cast<size_t>(time_tm.tm_mon)],
+                                  sp_info, dest_buf);
+            break;
+
+        case flag_op::datetime: {
+            filler f(24, sp_info, dest_buf);
+            base::fmt_base::append_string_view(ct.ctime_view(), dest_buf);
+            break;
+        }
+
+        case flag_op::year: {
+            filler f(4, sp_info, dest_buf);
+            f.fill_msg(time_tm.tm_year + 1900);
+            break;
+        }
+
+        case flag_op::month:
+            flag_ops::append_uint(static_cast<unsigned>(time_tm.tm_mon + 1), 2, sp_info, dest_buf);
+            break;
+
+        case flag_op::day:
+            flag_ops::append_uint(static_cast<unsigned>(time_tm.tm_mday), 2, sp_info, dest_buf);
+            break;
+
+        case flag_op::hour:
+            flag_ops::append_uint(static_cast<unsigned>(time_tm.tm_hour), 2, sp_info, dest_buf);
+            break;
+
+        case flag_op::minute:
+            flag_ops::append_uint(static_cast<unsigned>(time_tm.tm_min), 2, sp_info, dest_buf);
+            break;
+
+        case flag_op::second:
+            flag_ops::append_uint(static_cast<unsigned>(time_tm.tm_sec), 2, sp_info, dest_buf);
+            break;
+
+        case flag_op::millisec:
+            flag_ops::append_uint(static_cast<unsigned>(
+                                      base::fmt_base::precise_time<milliseconds>(msg.time).count()),
+                                  3, sp_info, dest_buf);
+            break;
+
+        case flag_op::microsec:
+            flag_ops::append_uint(static_cast<unsigned>(
+                                      base::fmt_base::precise_time<microseconds>(msg.time).count()),
+                                  6, sp_info, dest_buf);
+            break;
+
+        case flag_op::nanosec:
+            flag_ops::append_uint(static_cast<unsigned>(
+                                      base::fmt_base::precise_time<nanoseconds>(msg.time).count()),
+                                  9, sp_info, dest_buf);
+            break;
+
+        case flag_op::hms_time: {
+            filler f(8, sp_info, dest_buf);
+            base::fmt_base::append_string_view(ct.hms_view(), dest_buf);
+            break;
+        }
+
+        case flag_op::elapsed_ns:
+            flag_ops::append_elapsed<nanoseconds>(msg, last_time, sp_info, dest_buf);
+            break;
+
+        case flag_op::elapsed_us:
+            flag_ops::append_elapsed<microseconds>(msg, last_time, sp_info, dest_buf);
+            break;
+
+        case flag_op::elapsed_ms:
+            flag_ops::append_elapsed<milliseconds>(msg, last_time, sp_info, dest_buf);
+            break;
+
+        case flag_op::elapsed_s:
+            flag_ops::append_elapsed<seconds>(msg, last_time, sp_info, dest_buf);
+            break;
+
+        case flag_op::pid:
+            flag_ops::append_number(base::os::pid(), sp_info, dest_buf);
+            break;
+
+        case flag_op::tid:
+            flag_ops::append_number(msg.tid, sp_info, dest_buf);
+            break;
+
+        case flag_op::payload:
+            flag_ops::append_text(msg.msg, sp_info, dest_buf);
+            break;
+
+        case flag_op::color_start:
+            msg.color_index_start = dest_buf.size();
+            break;
+
+        case flag_op::color_end:
+            msg.color_index_end = dest_buf.size();
+            break;
+
+        case flag_op::source_loc: {
+            if (msg.loc.empty()) {
+                filler f(0, sp_info, dest_buf);
+                break;
+            }
+            size_t text_len = msg.loc.filename_view().size() +
+                              base::fmt_base::count_unsigned_digits(msg.loc.line) + 1;
+            filler f(text_len, sp_info, dest_buf);
+            base::fmt_base::append_string_view(msg.loc.filename_view(), dest_buf);
+            dest_buf.push_back(':');
+            base::fmt_base::append_int(msg.loc.line, dest_buf);
+            break;
+        }
+
+        case flag_op::source_filename:
+            if (msg.loc.empty()) {
+                filler f(0, sp_info, dest_buf);
+                break;
+            }
+            flag_ops::append_text(msg.loc.filename_view(), sp_info, dest_buf);
+            break;
+
+        case flag_op::source_linenum: {
+            if (msg.loc.empty()) {
+                filler f(0, sp_info, dest_buf);
+                break;
+            }
+            filler f(base::fmt_base::count_unsigned_digits(msg.loc.line), sp_info, dest_buf);
+            f.fill_msg(msg.loc.line);
+            break;
+        }
+
+        case flag_op::source_funcname:
+            if (msg.loc.empty()) {
+                filler f(0, sp_info, dest_buf);
+                break;
+            }
+            flag_ops::append_text(msg.loc.funcname, sp_info, dest_buf);
+            break;
+
+        case flag_op::utc_offset:
+            flag_ops::append_text(ct.offset_view(), sp_info, dest_buf);
+            break;
+
+        case flag_op::iso_sec:
+            flag_ops::append_iso<seconds, 0>(msg, ct, sp_info, dest_buf);
+            break;
+
+        case flag_op::iso_ms:
+            flag_ops::append_iso<milliseconds, 3>(msg, ct, sp_info, dest_buf);
+            break;
+
+        case flag_op::iso_us:
+            flag_ops::append_iso<microseconds, 6>(msg, ct, sp_info, dest_buf);
+            break;
+
+        case flag_op::iso_ns:
+            flag_ops::append_iso<nanoseconds, 9>(msg, ct, sp_info, dest_buf);
+            break;
+
+        case flag_op::full:
+            flag_ops::append_full(msg, ct, dest_buf);
+            break;
+
+        // 由格式化器自行处理
+        case flag_op::literal:
+        case flag_op::custom:
+            break;
+    }
+}
+
+}   // namespace sinks
+}   // namespace learnlog
@@ -3,6 +3,10 @@
 #include "definitions.h"
 #include "base/log_msg.h"
 
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
 namespace learnlog {
 namespace sinks {
 
@@ -13,7 +17,26 @@ public:
     virtual ~formatter() = default;
     virtual void format(const base::log_msg &msg, fmt_memory_buf &buf) = 0;
     virtual formatter_uni_ptr clone() const = 0;
+
+    // 格式化器的指纹，非 0 且相同的格式化器对同一条 log_msg 的输出逐字节一致，
+    // logger 据此对多个 sink 只格式化一次；输出依赖自身状态（如时间间隔、自定义格式字符）时为 0
+    virtual size_t fingerprint() const { return 0; }
 };
 
+// 把决定格式化器输出的完整配置 key 映射为非 0 的指纹，key 相同时指纹相同，key 不同时指纹一定不同，
+// 不会因哈希冲突把不同格式的 sink 分到同一组；只在设置格式模板、时区时调用，映射表随不同配置的个数增长
+inline size_t intern_fingerprint(const std::string& key) {
+    static std::mutex mutex;
+    static std::unordered_map<std::string, size_t> fingerprints;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = fingerprints.find(key);
+    if (it != fingerprints.end()) {
+        return it->second;
+    }
+    size_t fp = fingerprints.size() + 1;
+    fingerprints.emplace(key, fp);
+    return fp;
+}
+
 }    // namespace sinks
 }   // namespace learnlog
\ No newline at end of file
@@ -0,0 +1,283 @@
+#include "sinks/formatters/json_formatter.h"
+
+#include <cstring>
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+    #define LEARNLOG_JSON_X86
+    #include <emmintrin.h>
+    // MSVC 不提供 target 属性与运行时检测的内置函数，只使用 SSE2
+    #if defined(__GNUC__) || defined(__clang__)
+        #define LEARNLOG_JSON_AVX2
+        #include <immintrin.h>
+    #endif
+#endif
+
+using namespace learnlog;
+using namespace sinks;
+
+namespace {
+
+// 0 表示原样写入，否则为 '\\' 之后的转义字符，'u' 表示 \u00XX
+struct escape_table {
+    char value[256];
+    escape_table() : value() {
+        for (int ch = 0; ch < 0x20; ++ch) {
+            value[ch] = 'u';
+        }
+        value[static_cast<unsigned char>('\b')] = 'b';
+        value[static_cast<unsigned char>('\f')] = 'f';
+        value[static_cast<unsigned char>('\n')] = 'n';
+        value[static_cast<unsigned char>('\r')] = 'r';
+        value[static_cast<unsigned char>('\t')] = 't';
+        value[static_cast<unsigned char>('"')] = '"';
+        value[static_cast<unsigned char>('\\')] = '\\';
+    }
+};
+
+const escape_table escapes;
+
+inline char escape_of(char ch) {
+    return escapes.value[static_cast<unsigned char>(ch)];
+}
+
+// 以下 find_escape_*() 返回 [p, end) 中第一个需要转义的字符，没有时返回 end
+
+const char* find_escape_scalar(const char* p, const char* end) {
+    while (p != end && escape_of(*p) == 0) {
+        ++p;
+    }
+    return p;
+}
+
+inline int first_bit(unsigned mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return static_cast<int>(idx);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+#ifdef LEARNLOG_JSON_X86
+
+// 字节 <= 0x1F（无符号比较）、等于 '"' 或 '\\' 的位置
+const char* find_escape_sse2(const char* p, const char* end) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i ctrl_max = _mm_set1_epi8(0x1F);
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote),
+                                                _mm_cmpeq_epi8(v, backslash)),
+                                   _mm_cmpeq_epi8(_mm_max_epu8(v, ctrl_max), ctrl_max));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+        if (mask != 0) {
+            return p + first_bit(mask);
+        }
+        p += 16;
+    }
+    return find_escape_scalar(p, end);
+}
+
+#endif
+
+#ifdef LEARNLOG_JSON_AVX2
+
+__attribute__((target("avx2")))
+const char* find_escape_avx2(const char* p, const char* end) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i ctrl_max = _mm256_set1_epi8(0x1F);
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote),
+                                                      _mm256_cmpeq_epi8(v, backslash)),
+                                      _mm256_cmpeq_epi8(_mm256_max_epu8(v, ctrl_max), ctrl_max));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        if (mask != 0) {
+            return p + first_bit(mask);
+        }
+        p += 32;
+    }
+    // 剩余不足 32 字节时交给 SSE2 处理
+    return find_escape_sse2(p, end);
+}
+
+#endif
+
+json_escape_isa detect_isa() noexcept {
+#if defined(LEARNLOG_JSON_AVX2)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return json_escape_isa::avx2;
+    }
+    return json_escape_isa::sse2;
+#elif defined(LEARNLOG_JSON_X86)
+    return json_escape_isa::sse2;
+#else
+    return json_escape_isa::scalar;
+#endif
+}
+
+using find_escape_fn = const char* (*)(const char*, const char*);
+
+// isa 不可用时退回较低的指令集
+find_escape_fn select_find_escape(json_escape_isa isa) {
+    json_escape_isa best = best_json_escape_isa();
+    if (isa > best) {
+        isa = best;
+    }
+    switch (isa) {
+#ifdef LEARNLOG_JSON_AVX2
+        case json_escape_isa::avx2: return find_escape_avx2;
+#endif
+#ifdef LEARNLOG_JSON_X86
+        case json_escape_isa::sse2: return find_escape_sse2;
+#endif
+        default: return find_escape_scalar;
+    }
+}
+
+void append_escaped_char(char ch, fmt_memory_buf& dest_buf) {
+    static const char hex[] = "0123456789abcdef";
+    char esc = escape_of(ch);
+    dest_buf.push_back('\\');
+    dest_buf.push_back(esc);
+    if (esc == 'u') {
+        unsigned char uch = static_cast<unsigned char>(ch);
+        const char digits[4] = {'0', '0', hex[uch >> 4], hex[uch & 0x0F]};
+        dest_buf.append(digits, digits + 4);
+    }
+}
+
+void escape_with(find_escape_fn find_escape, fmt_string_view str, fmt_memory_buf& dest_buf) {
+    const char* p = str.data();
+    const char* end = p + str.size();
+    while (p != end) {
+        const char* esc = find_escape(p, end);
+        dest_buf.append(p, esc);
+        if (esc == end) {
+            break;
+        }
+        append_escaped_char(*esc, dest_buf);
+        p = esc + 1;
+    }
+}
+
+}   // namespace
+
+json_escape_isa learnlog::sinks::best_json_escape_isa() noexcept {
+    static const json_escape_isa best = detect_isa();
+    return best;
+}
+
+void learnlog::sinks::escape_json(fmt_string_view str, fmt_memory_buf& dest_buf,
+                                  json_escape_isa isa) {
+    escape_with(select_find_escape(isa), str, dest_buf);
+}
+
+json_formatter::json_formatter(std::string eol, json_escape_isa isa)
+    : eol_(std::move(eol)),
+      isa_(isa) {
+    update_fingerprint_();
+}
+
+void json_formatter::set_time_zone(time_zone zone) {
+    time_cache_.set_zone(zone);
+    head_valid_ = false;
+    update_fingerprint_();
+}
+
+void json_formatter::update_fingerprint_() {
+    // 与 pattern_fingerprint() 的键区分开：格式模板不会以 '\0' 开头
+    const time_zone& zone = time_cache_.zone();
+    std::string key("\0json\0", 6);
+    key.append(eol_);
+    key.push_back('\0');
+    key.push_back(static_cast<char>('0' + static_cast<int>(zone.type)));
+    key.append(std::to_string(zone.offset));
+    fingerprint_ = intern_fingerprint(key);
+}
+
+void json_formatter::format(const base::log_msg& msg, fmt_memory_buf& dest_buf) {
+    // 相邻的键名与数字先在栈上拼接，再一次性写入 dest_buf
+    key_buf keys;
+    append_time_(msg, keys, dest_buf);
+
+    keys.put("\",\"level\":\"");
+    keys.flush(dest_buf);
+    msg.color_index_start = dest_buf.size();
+    base::fmt_base::append_string_view(level::level_name[msg.level], dest_buf);
+    msg.color_index_end = dest_buf.size();
+
+    keys.put("\",\"logger\":\"");
+    keys.flush(dest_buf);
+    append_string_(msg.logger_name, dest_buf);
+
+    keys.put("\",\"tid\":");
+    keys.put_int(msg.tid);
+    if (!msg.loc.empty()) {
+        keys.put(",\"file\":\"");
+        keys.flush(dest_buf);
+        append_string_(msg.loc.filename_view(), dest_buf);
+        keys.put("\",\"line\":");
+        keys.put_int(msg.loc.line);
+        if (msg.loc.funcname != nullptr) {
+            keys.put(",\"func\":\"");
+            keys.flush(dest_buf);
+            append_string_(msg.loc.funcname, dest_buf);
+            keys.put("\"");
+        }
+    }
+
+    keys.put(",\"message\":\"");
+    keys.flush(dest_buf);
+    append_string_(msg.msg, dest_buf);
+    keys.put("\"}");
+    keys.flush(dest_buf);
+    base::fmt_base::append_string_view(eol_, dest_buf);
+}
+
+formatter_uni_ptr json_formatter::clone() const {
+    auto cloned = learnlog::make_unique<json_formatter>(eol_, isa_);
+    cloned->set_time_zone(time_cache_.zone());
+    formatter_uni_ptr result = std::move(cloned);
+    return result;
+}
+
+// RFC 3339，精确到微秒，如 "2021-10-17T04:41:13.123456+08:00"；
+// 到秒为止的部分每秒只渲染一次
+void json_formatter::append_time_(const base::log_msg& msg, key_buf& keys,
+                                  fmt_memory_buf& dest_buf) {
+    const cached_time& ct = time_cache_.get(msg.time);
+    if (!head_valid_ || head_secs_ != ct.secs) {
+        render_head_(ct);
+    }
+    dest_buf.append(head_.data(), head_.data() + head_len_);
+
+    auto micros = static_cast<uint32_t>(base::fmt_base::precise_time<microseconds>(msg.time).count());
+    char digits[6];
+    base::fmt_base::write_fixed<6>(micros, digits);
+    keys.put(fmt_string_view(digits, 6));
+    keys.put(ct.offset_view());
+}
+
+void json_formatter::render_head_(const cached_time& ct) {
+    key_buf head;
+    head.put("{\"time\":\"");
+    head.put(ct.iso_view());
+    head.put(".");
+    std::copy(head.data, head.data + head.size, head_.data());
+    head_len_ = head.size;
+    head_secs_ = ct.secs;
+    head_valid_ = true;
+}
+
+void json_formatter::append_string_(fmt_string_view str, fmt_memory_buf& dest_buf) const {
+    escape_json(str, dest_buf, isa_);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "sinks/formatters/formatter.h"
+#include "sinks/formatters/time_cache.h"
+
+#include <array>
+#include <string>
+
+namespace learnlog {
+namespace sinks {
+
+// JSON 字符串转义使用的指令集，scalar 逐字节检查；
+// sse2 / avx2 每次检查 16 / 32 字节，不需要转义的连续字节整段复制
+enum class json_escape_isa { scalar, sse2, avx2 };
+
+// 当前 CPU 支持的最快指令集，运行时检测一次
+json_escape_isa best_json_escape_isa() noexcept;
+
+// 按 RFC 8259 转义 str 并写入 dest_buf（不含两侧的 '"'）：
+// '"'、'\\' 与控制字符（< 0x20）需要转义，其余字节（包括 UTF-8 多字节字符）原样写入；
+// isa 不被当前 CPU 支持时退回较低的指令集，各指令集的输出逐字节一致
+void escape_json(fmt_string_view str, fmt_memory_buf& dest_buf,
+                 json_escape_isa isa = best_json_escape_isa());
+
+// formatter 的派生类，每条 log_msg 输出为一行 JSON 对象，例如：
+// {"time":"2021-10-17T04:41:13.123456+08:00","level":"info","logger":"name","tid":1234,
+//  "file":"main.cpp","line":12,"func":"main","message":"hello"}
+// 没有发生位置时省略 "file"、"line"、"func"；"level" 的值为上色范围
+class json_formatter final : public formatter {
+public:
+    explicit json_formatter(std::string eol = "\n",
+                            json_escape_isa isa = best_json_escape_isa());
+
+    json_formatter(const json_formatter& other) = delete;
+    json_formatter &operator=(const json_formatter& other) = delete;
+
+    void format(const base::log_msg& msg, fmt_memory_buf& dest_buf) override;
+    formatter_uni_ptr clone() const override;
+    // 输出只依赖 log_msg，同一 eol 的 json_formatter 可以共享格式化结果
+    size_t fingerprint() const override { return fingerprint_; }
+
+    json_escape_isa escape_isa() const { return isa_; }
+
+    // "time" 使用的时区，默认为本地时间；UTC 时以 "Z" 结尾
+    void set_time_zone(time_zone zone);
+    const time_zone& get_time_zone() const { return time_cache_.zone(); }
+
+private:
+    // 栈上的小缓冲区，拼接相邻的键名与数字
+    struct key_buf {
+        char data[96];
+        size_t size{0};
+
+        void put(fmt_string_view str) {
+            std::copy(str.data(), str.data() + str.size(), data + size);
+            size += str.size();
+        }
+        template <typename T>
+        void put_int(T n) {
+            fmt::format_int i(n);
+            put(fmt_string_view(i.data(), i.size()));
+        }
+        void flush(fmt_memory_buf& dest_buf) {
+            dest_buf.append(data, data + size);
+            size = 0;
+        }
+    };
+
+    void append_time_(const base::log_msg& msg, key_buf& keys, fmt_memory_buf& dest_buf);
+    void render_head_(const cached_time& ct);
+    void update_fingerprint_();
+    void append_string_(fmt_string_view str, fmt_memory_buf& dest_buf) const;
+
+    std::string eol_;
+    json_escape_isa isa_;
+    time_cache time_cache_;
+    std::array<char, 48> head_{};           // "{\"time\":\"YYYY-MM-DDTHH:MM:SS."
+    size_t head_len_{0};
+    seconds head_secs_{0};
+    bool head_valid_{false};
+    size_t fingerprint_{0};
+};
+
+}   // namespace sinks
+}   // namespace learnlog
@@ -21,15 +21,163 @@ pattern_formatter::pattern_formatter()
     : pattern_("%+"),
       eol_(DEFAULT_EOL) {
 
-    formatters_.push_back(learnlog::make_unique<full_formatter>(spaces_info{}));
+    analyse_pattern_(pattern_);
 }
 
+// 指令的实现见 format_flag<Op>()，与原先各 flag_formatter 派生类的输出逐字节一致
 void pattern_formatter::format(const base::log_msg& msg, fmt_memory_buf& dest_buf) {
-    std::tm msg_tm = base::os::time_point_to_tm(msg.time);
-    for (auto& f : formatters_) {
-        f->format(msg, msg_tm, dest_buf);
+    // 只有用到日期时间的指令才需要查询缓存，每秒最多转换一次 std::tm
+    static const cached_time no_time{};
+    const cached_time& ct = needs_tm_ ? time_cache_.get(msg.time) : no_time;
+    for (const flag_instr& instr : program_) {
+        sys_clock::time_point& last_time = last_times_[instr.time_idx];
+        switch (instr.op) {
+            case flag_op::literal:
+                dest_buf.append(literals_.data() + instr.data, 
+                                literals_.data() + instr.data + instr.len);
+                break;
+
+            case flag_op::name:
+                format_flag<flag_op::name>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::level:
+                format_flag<flag_op::level>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::weekday:
+                format_flag<flag_op::weekday>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::month_name:
+                format_flag<flag_op::month_name>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::datetime:
+                format_flag<flag_op::datetime>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::year:
+                format_flag<flag_op::year>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::month:
+                format_flag<flag_op::month>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::day:
+                format_flag<flag_op::day>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::hour:
+                format_flag<flag_op::hour>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::minute:
+                format_flag<flag_op::minute>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::second:
+                format_flag<flag_op::second>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::millisec:
+                format_flag<flag_op::millisec>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::microsec:
+                format_flag<flag_op::microsec>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::nanosec:
+                format_flag<flag_op::nanosec>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::hms_time:
+                format_flag<flag_op::hms_time>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::elapsed_ns:
+                format_flag<flag_op::elapsed_ns>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::elapsed_us:
+                format_flag<flag_op::elapsed_us>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::elapsed_ms:
+                format_flag<flag_op::elapsed_ms>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::elapsed_s:
+                format_flag<flag_op::elapsed_s>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::pid:
+                format_flag<flag_op::pid>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::tid:
+                format_flag<flag_op::tid>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::payload:
+                format_flag<flag_op::payload>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::color_start:
+                format_flag<flag_op::color_start>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::color_end:
+                format_flag<flag_op::color_end>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::source_loc:
+                format_flag<flag_op::source_loc>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::source_filename:
+                format_flag<flag_op::source_filename>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::source_linenum:
+                format_flag<flag_op::source_linenum>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::source_funcname:
+                format_flag<flag_op::source_funcname>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::utc_offset:
+                format_flag<flag_op::utc_offset>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::iso_sec:
+                format_flag<flag_op::iso_sec>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::iso_ms:
+                format_flag<flag_op::iso_ms>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::iso_us:
+                format_flag<flag_op::iso_us>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::iso_ns:
+                format_flag<flag_op::iso_ns>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::full:
+                format_flag<flag_op::full>(msg, ct, instr.sp_info, last_time, dest_buf);
+                break;
+
+            case flag_op::custom:
+                custom_formatters_[instr.data]->format(msg, ct.tm, dest_buf);
+                break;
+        }
     }
-    base::fmt_base::append_string_view(eol_, dest_buf);     // 末尾换行符
 }
 
 formatter_uni_ptr pattern_formatter::clone() const {
@@ -37,7 +185,10 @@ formatter_uni_ptr pattern_formatter::clone() const {
     for (const auto& p : custom_flags_) {
         custom_flags_clone[p.first] = p.second->clone();
     }
-    return learnlog::make_unique<pattern_formatter>(pattern_, eol_, std::move(custom_flags_clone));
+    auto cloned = learnlog::make_unique<pattern_formatter>(pattern_, eol_, std::move(custom_flags_clone));
+    cloned->set_time_zone(time_cache_.zone());
+    formatter_uni_ptr result = std::move(cloned);
+    return result;
 }
 
 void pattern_formatter::set_pattern(std::string pattern) {
@@ -45,34 +196,58 @@ void pattern_formatter::set_pattern(std::string pattern) {
     analyse_pattern_(pattern_);
 }
 
+void pattern_formatter::set_time_zone(time_zone zone) {
+    time_cache_.set_zone(zone);
+    update_fingerprint_();
+}
+
+// 输出只由格式模板、时区与 log_msg 决定时，才能与其他格式化器共享格式化结果
+void pattern_formatter::update_fingerprint_() {
+    fingerprint_ = (custom_formatters_.empty() && last_times_.size() == 1) ?
+                   pattern_fingerprint(pattern_, eol_, time_cache_.zone()) : 0;
+}
+
+// 连续的普通字符、'%%'、未知格式字符都合并为一条 literal 指令，eol_ 作为最后一条指令
 void pattern_formatter::analyse_pattern_(const std::string& pattern) {
     using str_const_iter = std::string::const_iterator;
     
     str_const_iter end = pattern.end();
-    std::unique_ptr<aggregate_formatter> as_is_formatter = nullptr;  // 该格式化器用于处理连续的非格式字符
-    formatters_.clear();
+    program_.clear();
+    literals_.clear();
+    custom_formatters_.clear();
+    last_times_.assign(1, sys_clock::now());
+    needs_tm_ = false;
     for (str_const_iter it = pattern.begin(); it != end; ++it) {
         if (*it == '%') {
-            if (as_is_formatter) {  // 遇到 '%', 代表一段连续非格式字符的结束，提交格式化器到处理队列
-                formatters_.push_back(std::move(as_is_formatter));
-            }
-
             spaces_info sp_info = analyse_spaces_info_(++it, end);
 
             if (it != end) {
-                append_flag_formatter_(*it, sp_info);
+                append_flag_instr_(*it, sp_info);
+            }
+            else {
+                break;
             }
         }
         else {
-            if (!as_is_formatter) {
-                as_is_formatter = learnlog::make_unique<aggregate_formatter>();
-            }
-            as_is_formatter->add_ch(*it);
+            append_literal_(fmt_string_view(&*it, 1));
         }
     }
-    if (as_is_formatter) {  // 最后还有一段连续非格式字符，提交格式化器
-        formatters_.push_back(std::move(as_is_formatter));
+    append_literal_(eol_);
+
+    update_fingerprint_();
+}
+
+void pattern_formatter::append_literal_(fmt_string_view text) {
+    if (text.size() == 0) {
+        return;
+    }
+    if (program_.empty() || program_.back().op != flag_op::literal) {
+        program_.push_back(flag_instr{flag_op::literal, 
+                                      static_cast<std::uint32_t>(literals_.size()), 0, 0,
+                                      spaces_info{}});
     }
+    literals_.append(text.data(), text.size());
+    program_.back().len += static_cast<std::uint32_t>(text.size());
 }
 
 // 空格填充信息在 '%' 与格式字符之间，形如 "%10T" "%-10T" "%=10T" "%10!v" "%-10!v" "%=10!v"
@@ -117,13 +292,17 @@ spaces_info pattern_formatter::analyse_spaces_info_(std::string::const_iterator&
     }
 }
 
-void pattern_formatter::append_flag_formatter_(char flag, const spaces_info& sp_info) {
+void pattern_formatter::append_flag_instr_(char flag, const spaces_info& sp_info) {
     // 用户指定的格式字符有最高优先级
     auto it = custom_flags_.find(flag);
     if (it != custom_flags_.end()) {
         auto cust_flag_formatter = it->second->clone();
         cust_flag_formatter->set_spaces_info(sp_info);
-        formatters_.push_back(std::move(cust_flag_formatter));
+        program_.push_back(flag_instr{flag_op::custom, 
+                                      static_cast<std::uint32_t>(custom_formatters_.size()), 0, 0,
+                                      sp_info});
+        custom_formatters_.push_back(std::move(cust_flag_formatter));
+        needs_tm_ = true;
         return;
     }
 
@@ -158,134 +337,31 @@ void pattern_formatter::append_flag_formatter_(char flag, const spaces_info& sp_
         %A == 消息位置，"filename";
         %B == 消息位置，"linenum";
         %C == 消息位置，"funcname";
+        %z == 相对 UTC 的偏移，"+08:00"，UTC 时为 "Z";
+        %I == ISO 8601 / RFC 3339 日期时间，精确到秒，"2021-10-17T04:41:13+08:00";
+        %J == 同 %I，精确到毫秒，"2021-10-17T04:41:13.123+08:00";
+        %K == 同 %I，精确到微秒;
+        %L == 同 %I，精确到纳秒;
         %% == 字符 '%';
     */
-    switch (flag) {
-        case ('+'):  
-            formatters_.push_back(learnlog::make_unique<full_formatter>(sp_info));
-            break;
-        
-        case ('n'):  
-            formatters_.push_back(learnlog::make_unique<name_formatter>(sp_info));
-            break;
-
-        case ('l'):  
-            formatters_.push_back(learnlog::make_unique<level_formatter>(sp_info));
-            break;
-
-        case ('a'):  
-            formatters_.push_back(learnlog::make_unique<a_formatter>(sp_info));
-            break;
-
-        case ('b'):  
-            formatters_.push_back(learnlog::make_unique<b_formatter>(sp_info));
-            break;
-
-        case ('c'):  
-            formatters_.push_back(learnlog::make_unique<c_formatter>(sp_info));
-            break;
-
-        case ('y'):  
-            formatters_.push_back(learnlog::make_unique<y_formatter>(sp_info));
-            break;
-
-        case ('m'):  
-            formatters_.push_back(learnlog::make_unique<m_formatter>(sp_info));
-            break;
-
-        case ('d'):  
-            formatters_.push_back(learnlog::make_unique<d_formatter>(sp_info));
-            break;
-
-        case ('H'):  
-            formatters_.push_back(learnlog::make_unique<H_formatter>(sp_info));
-            break;
-
-        case ('M'):  
-            formatters_.push_back(learnlog::make_unique<M_formatter>(sp_info));
-            break;
-
-        case ('S'):  
-            formatters_.push_back(learnlog::make_unique<S_formatter>(sp_info));
-            break;
-
-        case ('E'):  
-            formatters_.push_back(learnlog::make_unique<E_formatter>(sp_info));
-            break;
-
-        case ('F'):  
-            formatters_.push_back(learnlog::make_unique<F_formatter>(sp_info));
-            break;
-
-        case ('G'):  
-            formatters_.push_back(learnlog::make_unique<G_formatter>(sp_info));
-            break;
-
-        case ('T'):  
-            formatters_.push_back(learnlog::make_unique<T_formatter>(sp_info));
-            break;
-
-        case ('W'):
-            formatters_.push_back(learnlog::make_unique<duration_formatter<nanoseconds> >(sp_info));
-            break;
-
-        case ('X'):
-            formatters_.push_back(learnlog::make_unique<duration_formatter<microseconds> >(sp_info));
-            break;
-
-        case ('Y'):
-            formatters_.push_back(learnlog::make_unique<duration_formatter<milliseconds> >(sp_info));
-            break;
-
-        case ('Z'):
-            formatters_.push_back(learnlog::make_unique<duration_formatter<seconds> >(sp_info));
-            break;
-
-        case ('p'):  
-            formatters_.push_back(learnlog::make_unique<p_formatter>(sp_info));
-            break;
-
-        case ('t'):  
-            formatters_.push_back(learnlog::make_unique<t_formatter>(sp_info));
-            break;
-
-        case ('v'):  
-            formatters_.push_back(learnlog::make_unique<v_formatter>(sp_info));
-            break;
-
-        case ('^'):  
-            formatters_.push_back(learnlog::make_unique<color_start_formatter>(sp_info));
-            break;
-
-        case ('$'):  
-            formatters_.push_back(learnlog::make_unique<color_end_formatter>(sp_info));
-            break;
-
-        case ('@'):  
-            formatters_.push_back(learnlog::make_unique<source_loc_formatter>(sp_info));
-            break;
-
-        case ('A'):  
-            formatters_.push_back(learnlog::make_unique<source_filename_formatter>(sp_info));
-            break;
-
-        case ('B'):  
-            formatters_.push_back(learnlog::make_unique<source_linenum_formatter>(sp_info));
-            break;
-
-        case ('C'):  
-            formatters_.push_back(learnlog::make_unique<source_funcname_formatter>(sp_info));
-            break;
-
-        case ('%'):  
-            formatters_.push_back(learnlog::make_unique<char_formatter>('%'));
-            break;
+    flag_op op = flag_to_op(flag);
+    if (op == flag_op::literal) {
+        // '%%' 输出字符 '%'，未知格式字符原样输出
+        char unknown_flag[2] = {'%', flag};
+        if (flag == '%') {
+            append_literal_(fmt_string_view(unknown_flag, 1));
+        }
+        else {
+            append_literal_(fmt_string_view(unknown_flag, 2));
+        }
+        return;
+    }
+    needs_tm_ = needs_tm_ || flag_op_needs_tm(op);
 
-        // 格式字符未找到
-        default:
-            auto unknown_flag = learnlog::make_unique<aggregate_formatter>();
-            unknown_flag->add_ch('%');
-            unknown_flag->add_ch(flag);
-            formatters_.push_back(std::move(unknown_flag));
+    std::uint32_t time_idx = 0;
+    if (flag_op_is_elapsed(op)) {
+        time_idx = static_cast<std::uint32_t>(last_times_.size());
+        last_times_.push_back(sys_clock::now());
     }
-}
\ No newline at end of file
+    program_.push_back(flag_instr{op, 0, 0, time_idx, sp_info});
+}
@@ -2,17 +2,22 @@
 
 #include "sinks/formatters/formatter.h"
 #include "sinks/formatters/flag_formatter.h"
+#include "sinks/formatters/flag_ops.h"
 
 #include <string>
 #include <vector>
 #include <memory>
 #include <unordered_map>
+#include <cstdint>
+#include <typeinfo>
 
 namespace learnlog {
 namespace sinks {
 
 // formatter 的派生类，通过 format() 每次格式化一条 log_msg，
-// 由格式模板字符串生成一个格式化器队列，依次格式化 log_msg 的不同部分，将结果写入缓冲区
+// 格式模板字符串只在设置时解析一次，编译为一组扁平的指令（连续的普通字符、log_msg 字段、空格填充信息），
+// format() 用一个 switch 依次执行指令，不再对每个格式字符做一次虚函数调用；
+// 自定义格式字符编译为 custom 指令，调用对应的 custom_flag_formatter
 class pattern_formatter : public formatter {
 public:
     using cust_flag_table = std::unordered_map<char, std::unique_ptr<custom_flag_formatter> >;
@@ -28,24 +33,54 @@ public:
 
     void format(const base::log_msg& msg, fmt_memory_buf& dest_buf) override;
     formatter_uni_ptr clone() const override;
+    // 含有 elapsed_* 或自定义格式字符时为 0；
+    // 派生类可能覆写 format()，输出不再只由格式模板决定，动态类型不是 pattern_formatter 时也为 0，
+    // 输出与 pattern_formatter 逐字节一致的派生类可以覆写 fingerprint()，返回 pattern_fingerprint_()
+    size_t fingerprint() const override {
+        return typeid(*this) == typeid(pattern_formatter) ? fingerprint_ : 0;
+    }
 
     void set_pattern(std::string pattern);
 
+    // 日期时间使用的时区，默认为本地时间
+    void set_time_zone(time_zone zone);
+    const time_zone& get_time_zone() const { return time_cache_.zone(); }
+
     // 添加自定义格式字符与格式化器，T 为 custom_flag_formatter 的派生类
     template <typename T, typename... Args>
     void add_custom_flag(char flag, Args &&...args) {
         custom_flags_[flag] = learnlog::make_unique<T>(std::forward<Args>(args)...); 
     }
 
+protected:
+    size_t pattern_fingerprint_() const { return fingerprint_; }
+
 private: 
+    struct flag_instr {
+        flag_op op;
+        std::uint32_t data;     // literal: 在 literals_ 中的偏移；custom: custom_formatters_ 的下标
+        std::uint32_t len;      // literal: 字符个数
+        std::uint32_t time_idx; // elapsed_*: last_times_ 的下标，其他指令为 0
+        spaces_info sp_info;    // 空格填充信息
+    };
+
     void analyse_pattern_(const std::string& pattern);                  // 解析格式模板字符串
     spaces_info analyse_spaces_info_(std::string::const_iterator& it,
                                      std::string::const_iterator end);  // 解析空格填充信息
-    void append_flag_formatter_(char flag, const spaces_info& sp_info); // 添加格式化器
+    void append_flag_instr_(char flag, const spaces_info& sp_info);     // 添加格式字符对应的指令
+    void append_literal_(fmt_string_view text);                         // 添加普通字符，与前一条 literal 指令合并
+    void update_fingerprint_();
 
     std::string pattern_;                                       // 格式模板字符串
     std::string eol_;                                           // end of line，换行符
-    std::vector<std::unique_ptr<flag_formatter> > formatters_;  // 格式化器队列
+    std::vector<flag_instr> program_;                           // 编译后的指令，末尾为 eol_
+    std::string literals_;                                      // 所有 literal 指令的字符
+    std::vector<std::unique_ptr<custom_flag_formatter> > custom_formatters_;
+    std::vector<sys_clock::time_point> last_times_;             // 各 elapsed_* 指令上一条 log_msg 的时间，
+                                                                // 下标 0 供其他指令占位
+    bool needs_tm_{false};                                      // 是否有指令用到 std::tm
+    time_cache time_cache_;                                     // 精确到秒的日期时间缓存
+    size_t fingerprint_{0};                                     // 格式化器的指纹
     cust_flag_table custom_flags_;                              // 自定义格式化器的映射表
 };
 
@@ -0,0 +1,218 @@
+#pragma once
+
+#include "sinks/formatters/formatter.h"
+#include "sinks/formatters/flag_ops.h"
+
+#include <array>
+#include <string>
+
+namespace learnlog {
+namespace sinks {
+
+// 声明编译期格式模板，供 static_pattern_formatter 使用
+// example:
+//  LEARNLOG_STATIC_PATTERN(my_pattern, "[%T.%E] [%n] [%^%l%$] %v");
+//  logger->set_formatter(learnlog::make_unique<learnlog::sinks::static_pattern_formatter<my_pattern>>());
+#define LEARNLOG_STATIC_PATTERN(name, pattern_str)                          \
+    struct name {                                                           \
+        static constexpr const char* value() { return pattern_str; }        \
+    }
+
+namespace static_pattern {
+
+// 以下 constexpr 函数在编译期解析格式模板，规则与 pattern_formatter 相同；
+// pos 为格式模板中的下标，spec 为 '%' 之后的下标
+
+constexpr bool is_digit(char ch) { return ch >= '0' && ch <= '9'; }
+
+// 从 pos 开始的连续普通字符的结束位置
+constexpr size_t literal_end(const char* p, size_t pos) {
+    return (p[pos] == '\0' || p[pos] == '%') ? pos : literal_end(p, pos + 1);
+}
+
+constexpr size_t width_begin(const char* p, size_t spec) {
+    return (p[spec] == '-' || p[spec] == '=') ? spec + 1 : spec;
+}
+
+constexpr size_t digits_end(const char* p, size_t pos) {
+    return is_digit(p[pos]) ? digits_end(p, pos + 1) : pos;
+}
+
+constexpr size_t parse_width(const char* p, size_t pos, size_t end, size_t acc) {
+    return pos == end ? acc : parse_width(p, pos + 1, end, acc * 10 + static_cast<size_t>(p[pos] - '0'));
+}
+
+// 是否有空格填充信息，没有填充长度时视为没有
+constexpr bool has_spaces(const char* p, size_t spec) {
+    return p[spec] != '\0' && is_digit(p[width_begin(p, spec)]);
+}
+
+constexpr size_t spaces_len(const char* p, size_t spec) {
+    return parse_width(p, width_begin(p, spec), digits_end(p, width_begin(p, spec)), 0) < MAX_SPACES_LEN ?
+           parse_width(p, width_begin(p, spec), digits_end(p, width_begin(p, spec)), 0) : MAX_SPACES_LEN;
+}
+
+constexpr bool spaces_truncate(const char* p, size_t spec) {
+    return has_spaces(p, spec) && p[digits_end(p, width_begin(p, spec))] == '!';
+}
+
+constexpr spaces_info::fill_side spaces_side(const char* p, size_t spec) {
+    return p[spec] == '-' ? spaces_info::fill_side::right :
+           p[spec] == '=' ? spaces_info::fill_side::center : spaces_info::fill_side::left;
+}
+
+// 格式字符的位置，格式模板在格式字符之前结束时指向末尾的 '\0'
+constexpr size_t flag_pos(const char* p, size_t spec) {
+    return p[spec] == '\0' ? spec :
+           !has_spaces(p, spec) ? width_begin(p, spec) :
+           digits_end(p, width_begin(p, spec)) + (spaces_truncate(p, spec) ? 1 : 0);
+}
+
+// 下一段（连续普通字符或 '%' 开始的格式字符）的位置
+constexpr size_t next_pos(const char* p, size_t pos) {
+    return p[pos] != '%' ? literal_end(p, pos) :
+           p[flag_pos(p, pos + 1)] == '\0' ? flag_pos(p, pos + 1) : flag_pos(p, pos + 1) + 1;
+}
+
+constexpr flag_op token_op(const char* p, size_t pos) {
+    return p[pos] == '%' ? flag_to_op(p[flag_pos(p, pos + 1)]) : flag_op::literal;
+}
+
+// [pos, limit) 中 elapsed_* 的个数
+constexpr size_t count_elapsed(const char* p, size_t pos, size_t limit) {
+    return (pos >= limit || p[pos] == '\0') ? 0 :
+           (flag_op_is_elapsed(token_op(p, pos)) ? 1 : 0) + count_elapsed(p, next_pos(p, pos), limit);
+}
+
+constexpr bool needs_tm(const char* p, size_t pos) {
+    return p[pos] != '\0' && (flag_op_needs_tm(token_op(p, pos)) || needs_tm(p, next_pos(p, pos)));
+}
+
+template <typename Pattern, size_t Pos, char Ch = Pattern::value()[Pos]>
+struct step;
+
+// 格式字符 Flag 位于 flag_pos(p, Pos + 1)，执行后从下一个字符继续
+template <typename Pattern, size_t Pos, char Flag>
+struct flag_step {
+    static void run(const base::log_msg& msg, const cached_time& ct,
+                    sys_clock::time_point* last_times,
+                    fmt_memory_buf& dest_buf) {
+        const char* p = Pattern::value();
+        if (flag_to_op(Flag) == flag_op::literal) {
+            // '%%' 输出字符 '%'，未知格式字符原样输出
+            dest_buf.push_back('%');
+            if (Flag != '%') {
+                dest_buf.push_back(Flag);
+            }
+        }
+        else {
+            spaces_info sp_info = has_spaces(p, Pos + 1) ?
+                spaces_info(spaces_len(p, Pos + 1), spaces_side(p, Pos + 1),
+                            spaces_truncate(p, Pos + 1)) :
+                spaces_info();
+            format_flag<flag_to_op(Flag)>(msg, ct, sp_info,
+                                          last_times[flag_op_is_elapsed(flag_to_op(Flag)) ?
+                                                     1 + count_elapsed(p, 0, Pos) : 0],
+                                          dest_buf);
+        }
+        step<Pattern, flag_pos(Pattern::value(), Pos + 1) + 1>::run(msg, ct, last_times,
+                                                                     dest_buf);
+    }
+};
+
+// 格式模板在格式字符之前结束
+template <typename Pattern, size_t Pos>
+struct flag_step<Pattern, Pos, '\0'> {
+    static void run(const base::log_msg&, const cached_time&, sys_clock::time_point*,
+                    fmt_memory_buf&) {}
+};
+
+// 连续的普通字符
+template <typename Pattern, size_t Pos, char Ch>
+struct step {
+    static void run(const base::log_msg& msg, const cached_time& ct,
+                    sys_clock::time_point* last_times,
+                    fmt_memory_buf& dest_buf) {
+        const char* p = Pattern::value();
+        dest_buf.append(p + Pos, p + literal_end(p, Pos));
+        step<Pattern, literal_end(Pattern::value(), Pos)>::run(msg, ct, last_times,
+                                                               dest_buf);
+    }
+};
+
+template <typename Pattern, size_t Pos>
+struct step<Pattern, Pos, '%'> {
+    static void run(const base::log_msg& msg, const cached_time& ct,
+                    sys_clock::time_point* last_times,
+                    fmt_memory_buf& dest_buf) {
+        flag_step<Pattern, Pos, Pattern::value()[flag_pos(Pattern::value(), Pos + 1)]>::run(
+            msg, ct, last_times, dest_buf);
+    }
+};
+
+template <typename Pattern, size_t Pos>
+struct step<Pattern, Pos, '\0'> {
+    static void run(const base::log_msg&, const cached_time&, sys_clock::time_point*,
+                    fmt_memory_buf&) {}
+};
+
+}   // namespace static_pattern
+
+// 格式模板在编译期确定的 formatter，Pattern 由 LEARNLOG_STATIC_PATTERN 声明；
+// 编译期解析格式模板，每个格式字符展开为对应的 format_flag<Op>() 调用，全部内联，
+// 没有运行时的解析、分派与虚函数调用；输出与同一格式模板的 pattern_formatter 逐字节一致，
+// 不支持自定义格式字符
+template <typename Pattern>
+class static_pattern_formatter final : public formatter {
+public:
+    explicit static_pattern_formatter(std::string eol = DEFAULT_EOL)
+        : eol_(std::move(eol)) {
+        last_times_.fill(sys_clock::now());
+        if (last_times_.size() == 1) {
+            fingerprint_ = pattern_fingerprint(Pattern::value(), eol_);
+        }
+    }
+
+    static_pattern_formatter(const static_pattern_formatter& other) = delete;
+    static_pattern_formatter &operator=(const static_pattern_formatter& other) = delete;
+
+    void format(const base::log_msg& msg, fmt_memory_buf& dest_buf) override {
+        static const cached_time no_time{};
+        const cached_time& ct = static_pattern::needs_tm(Pattern::value(), 0) ?
+                                time_cache_.get(msg.time) : no_time;
+        static_pattern::step<Pattern, 0>::run(msg, ct, last_times_.data(), dest_buf);
+        base::fmt_base::append_string_view(eol_, dest_buf);
+    }
+
+    formatter_uni_ptr clone() const override {
+        auto cloned = learnlog::make_unique<static_pattern_formatter>(eol_);
+        cloned->set_time_zone(time_cache_.zone());
+        formatter_uni_ptr result = std::move(cloned);
+        return result;
+    }
+
+    // 与同一格式模板、同一时区的 pattern_formatter 相同，含有 elapsed_* 时为 0
+    size_t fingerprint() const override { return fingerprint_; }
+
+    // 日期时间使用的时区，默认为本地时间
+    void set_time_zone(time_zone zone) {
+        time_cache_.set_zone(zone);
+        if (last_times_.size() == 1) {
+            fingerprint_ = pattern_fingerprint(Pattern::value(), eol_, zone);
+        }
+    }
+    const time_zone& get_time_zone() const { return time_cache_.zone(); }
+
+    static const char* pattern() { return Pattern::value(); }
+
+private:
+    std::string eol_;
+    // 各 elapsed_* 上一条 log_msg 的时间，下标 0 供其他格式字符占位
+    std::array<sys_clock::time_point,
+               1 + static_pattern::count_elapsed(Pattern::value(), 0, static_cast<size_t>(-1))> last_times_;
+    time_cache time_cache_;
+    size_t fingerprint_{0};
+};
+
+}   // namespace sinks
+}   // namespace learnlog
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "definitions.h"
+#include "base/os.h"
+#include "base/fmt_base.h"
+#include "sinks/formatters/flag_formatter.h"
+
+#include <array>
+#include <cstdint>
+
+namespace learnlog {
+namespace sinks {
+
+// 日期时间使用的时区：
+// local 为本地时间，经过 localtime_r()，跟随夏令时与运行时修改的 TZ；
+// utc 与 fixed（固定的 UTC 偏移）由整数运算换算日历，不经过 libc 的时区路径，也不获取时区锁
+struct time_zone {
+    enum class kind : std::uint8_t { local, utc, fixed };
+
+    time_zone() = default;
+    time_zone(kind type_in, long offset_in) : type(type_in), offset(offset_in) {}
+
+    kind type{kind::local};
+    long offset{0};             // 相对 UTC 的偏移，单位为秒，只由 fixed 使用
+
+    static time_zone local_time() { return time_zone{}; }
+    static time_zone utc() { return time_zone{kind::utc, 0}; }
+    static time_zone fixed(long offset_secs) { return time_zone{kind::fixed, offset_secs}; }
+    // 调用时计算一次本地时间的偏移，之后固定不变，不再跟随夏令时
+    static time_zone fixed_local() { return fixed(base::os::current_utc_offset_secs()); }
+
+    bool operator==(const time_zone& other) const {
+        return type == other.type && offset == other.offset;
+    }
+    bool operator!=(const time_zone& other) const { return !(*this == other); }
+};
+
+// 精确到秒的日期时间，以及按秒预先渲染好的字符串
+struct cached_time {
+    seconds secs{0};
+    bool valid{false};
+    time_zone zone;
+    std::tm tm{};
+    long utc_offset{0};                     // 相对 UTC 的偏移，单位为秒
+    std::array<char, 32> datetime{};        // "YYYY-MM-DD HH:MM:SS"
+    size_t datetime_len{0};
+    size_t hms_pos{0};                      // "HH:MM:SS" 在 datetime 中的位置
+    std::array<char, 32> iso{};             // ISO 8601 / RFC 3339，"YYYY-MM-DDTHH:MM:SS"
+    std::array<char, 8> offset_str{};       // "+08:00"，UTC 时为 "Z"
+    size_t offset_len{0};
+    std::array<char, 32> ctime{};           // %c，"Sun Oct 17 04:41:13 2021"
+    size_t ctime_len{0};
+
+    fmt_string_view datetime_view() const { return fmt_string_view(datetime.data(), datetime_len); }
+    fmt_string_view hms_view() const { return fmt_string_view(datetime.data() + hms_pos, 8); }
+    fmt_string_view iso_view() const { return fmt_string_view(iso.data(), datetime_len); }
+    fmt_string_view offset_view() const { return fmt_string_view(offset_str.data(), offset_len); }
+    fmt_string_view ctime_view() const { return fmt_string_view(ctime.data(), ctime_len); }
+};
+
+// 日期时间缓存，同一秒内的 log_msg 只换算一次日期时间（本地时间调用 localtime_r()，glibc 中会获取时区锁），
+// 之后所有日期时间格式字符直接使用缓存的 std::tm 与字符串，只需另外写入秒以下的部分；
+// 启用 LEARNLOG_USE_TLS 时，同一线程中同为本地时间（或同为 UTC / 固定偏移）的格式化器共用一份缓存，
+// 一个 logger 有多个 sink 时，每秒只换算一次
+class time_cache {
+public:
+    explicit time_cache(time_zone zone = time_zone{}) : zone_(zone) {}
+
+    const cached_time& get(const sys_clock::time_point& tp) {
+#ifdef LEARNLOG_USE_TLS
+        static thread_local cached_time local_entry;
+        static thread_local cached_time offset_entry;
+        cached_time& entry = zone_.type == time_zone::kind::local ? local_entry : offset_entry;
+#else
+        cached_time& entry = entry_;
+#endif
+        seconds secs = std::chrono::duration_cast<seconds>(tp.time_since_epoch());
+        if (!entry.valid || secs != entry.secs || entry.zone != zone_) {
+            refresh_(entry, tp, secs, zone_);
+        }
+        return entry;
+    }
+
+    const time_zone& zone() const { return zone_; }
+    void set_zone(time_zone zone) { zone_ = zone; }
+
+private:
+    static void refresh_(cached_time& entry, const sys_clock::time_point& tp, seconds secs,
+                         const time_zone& zone) {
+        std::time_t time_tt = base::os::time_point_to_time_t(tp);
+        if (zone.type == time_zone::kind::local) {
+            entry.tm = base::os::_time_t_to_tm(time_tt);
+            entry.utc_offset = base::os::utc_offset_secs(entry.tm, time_tt);
+        }
+        else {
+            entry.utc_offset = zone.type == time_zone::kind::utc ? 0 : zone.offset;
+            entry.tm = base::os::time_t_to_tm_offset(time_tt, entry.utc_offset);
+        }
+        entry.secs = secs;
+        entry.zone = zone;
+        entry.valid = true;
+
+        const std::tm& tm = entry.tm;
+        fmt_memory_buf buf;
+        base::fmt_base::fill_uint(tm.tm_year + 1900, 4, buf);
+        buf.push_back('-');
+        base::fmt_base::fill_uint(tm.tm_mon + 1, 2, buf);
+        buf.push_back('-');
+        base::fmt_base::fill_uint(tm.tm_mday, 2, buf);
+        buf.push_back(' ');
+        entry.hms_pos = buf.size();
+        char hms[8];
+        base::fmt_base::write_hms<0>(static_cast<uint32_t>(tm.tm_hour), static_cast<uint32_t>(tm.tm_min),
+                                     static_cast<uint32_t>(tm.tm_sec), 0, hms);
+        buf.append(hms, hms + 8);
+        entry.datetime_len = copy_(buf, entry.datetime);
+        entry.iso = entry.datetime;
+        entry.iso[entry.hms_pos - 1] = 'T';
+        render_offset_(entry);
+
+        buf.clear();
+        base::fmt_base::append_string_view(weekday_name[static_cast<size_t>(tm.tm_wday)], buf);
+        buf.push_back(' ');
+        base::fmt_base::append_string_view(month_name[static_cast<size_t>(tm.tm_mon)], buf);
+        buf.push_back(' ');
+        base::fmt_base::fill_uint(tm.tm_mday, 2, buf);
+        buf.push_back(' ');
+        buf.append(entry.datetime.data() + entry.hms_pos, entry.datetime.data() + entry.hms_pos + 8);
+        buf.push_back(' ');
+        base::fmt_base::fill_uint(tm.tm_year + 1900, 4, buf);
+        entry.ctime_len = copy_(buf, entry.ctime);
+    }
+
+    // RFC 3339 的时区偏移，UTC 写为 "Z"，其余写为 "+HH:MM" / "-HH:MM"
+    static void render_offset_(cached_time& entry) {
+        if (entry.zone.type == time_zone::kind::utc) {
+            entry.offset_str[0] = 'Z';
+            entry.offset_len = 1;
+            return;
+        }
+        long abs_offset = entry.utc_offset < 0 ? -entry.utc_offset : entry.utc_offset;
+        entry.offset_str[0] = entry.utc_offset < 0 ? '-' : '+';
+        base::fmt_base::write_pair(static_cast<uint32_t>(abs_offset / 3600 % 100), entry.offset_str.data() + 1);
+        entry.offset_str[3] = ':';
+        base::fmt_base::write_pair(static_cast<uint32_t>(abs_offset % 3600 / 60), entry.offset_str.data() + 4);
+        entry.offset_len = 6;
+    }
+
+    static size_t copy_(const fmt_memory_buf& buf, std::array<char, 32>& dest) {
+        size_t len = (std::min)(buf.size(), dest.size());
+        std::copy(buf.data(), buf.data() + len, dest.data());
+        return len;
+    }
+
+    time_zone zone_;
+#ifndef LEARNLOG_USE_TLS
+    cached_time entry_;
+#endif
+};
+
+}   // namespace sinks
+}   // namespace learnlog
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "sinks/basic_sink.h"
+#include "base/mmap_file.h"
+#include "base/null_mutex.h"
+#include "sync_factory.h"
+
+namespace learnlog {
+namespace sinks {
+
+// basic_sink 的派生类，只支持 unix，
+// 是模板参数为 Mutex 的模板类，在需要保证线程安全时传入 std::mutex，不需要时传入 base::null_mutex，
+// mmap_file_sink 把格式化后的 log_msg 追加写入内存映射的文件（见 base::mmap_file），
+// 文件按 chunk_size 分块预分配并映射，写入只是一次内存复制，没有 fwrite 与系统调用，
+// flush() 不需要做任何事：写入的数据已经位于页缓存中，进程崩溃时最后一条完整写入之前的日志都不会丢失，
+// 需要保证写入磁盘时调用 sync()；
+// 文件在析构时被截断为实际写入的长度，运行期间文件末尾有预分配的 '\0'；
+// Linux 以外的平台不预留磁盘空间，磁盘空间不足时可能触发 SIGBUS，见 base::mmap_file
+
+template <typename Mutex>
+class mmap_file_sink final : public basic_sink<Mutex> {
+public:
+    static const size_t default_chunk_size = 8 * 1024 * 1024;
+
+    explicit mmap_file_sink(const filename_t& filename,
+                            bool truncate = false,
+                            size_t chunk_size = default_chunk_size)
+        : filename_(filename),
+          file_(chunk_size) {
+        file_.open(filename_, truncate);
+        basic_sink<Mutex>::enable_formatted_output_();
+    }
+
+    // close() 在 munmap、ftruncate、close 失败时抛出异常，析构时只输出异常信息
+    ~mmap_file_sink() override {
+        try {
+            file_.close();
+        }
+        catch (const std::exception& e) {
+            learnlog::handle_excpt(e.what());
+        }
+        catch (...) {
+            learnlog::handle_excpt("learnlog::mmap_file_sink: unknown exception in destructor");
+        }
+    }
+
+    filename_t filename() const { return filename_; }
+
+    // 实际写入的长度
+    u_long_long size() {
+        std::lock_guard<Mutex> lock(basic_sink<Mutex>::mutex_);
+        return file_.size();
+    }
+
+    // 把已写入的日志写入磁盘
+    void sync() {
+        std::lock_guard<Mutex> lock(basic_sink<Mutex>::mutex_);
+        file_.sync();
+    }
+
+protected:
+    void output_(const base::log_msg &msg) override {
+        fmt_memory_buf& buf = basic_sink<Mutex>::output_buf_();
+        basic_sink<Mutex>::formatter_->format(msg, buf);
+        file_.write(buf.data(), buf.size());
+    }
+
+    void output_batch_(const base::log_msg* const* msgs, size_t msg_num) override {
+        fmt_memory_buf& buf = basic_sink<Mutex>::output_buf_();
+        for (size_t i = 0; i < msg_num; ++i) {
+            basic_sink<Mutex>::formatter_->format(*msgs[i], buf);
+        }
+        file_.write(buf.data(), buf.size());
+    }
+
+    void output_formatted_(const base::log_msg &, fmt_string_view formatted) override {
+        file_.write(formatted.data(), formatted.size());
+    }
+
+    void flush_() override {}
+
+private:
+    filename_t filename_;
+    base::mmap_file file_;
+};
+
+using mmap_file_sink_mt = mmap_file_sink<std::mutex>;
+using mmap_file_sink_st = mmap_file_sink<base::null_mutex>;
+
+}    // namespace sinks
+
+// factory 函数，创建使用 mmap_file_sink 的 logger 对象
+
+template <typename Factory = learnlog::sync_factory>
+logger_shr_ptr mmap_file_logger_mt(const std::string& logger_name,
+                                   const filename_t& filename,
+                                   bool truncate = false,
+                                   size_t chunk_size = sinks::mmap_file_sink_mt::default_chunk_size) {
+    return Factory::template create<sinks::mmap_file_sink_mt>(logger_name, filename, truncate,
+                                                              chunk_size);
+}
+
+template <typename Factory = learnlog::sync_factory>
+logger_shr_ptr mmap_file_logger_st(const std::string& logger_name,
+                                   const filename_t& filename,
+                                   bool truncate = false,
+                                   size_t chunk_size = sinks::mmap_file_sink_st::default_chunk_size) {
+    return Factory::template create<sinks::mmap_file_sink_st>(logger_name, filename, truncate,
+                                                              chunk_size);
+}
+
+}    // namespace learnlog
@@ -18,16 +18,22 @@ class ostream_sink final : public basic_sink<Mutex> {
 public:
     explicit ostream_sink(std::ostream& os, bool force_flush = false)
         : ostream_(os),
-          force_flush_(force_flush) {}
+          force_flush_(force_flush) {
+        basic_sink<Mutex>::enable_formatted_output_();
+    }
     
     ostream_sink(const ostream_sink &) = delete;
     ostream_sink& operator=(const ostream_sink &) = delete;
 
 private:
     void output_(const base::log_msg& msg) override {
-        fmt_memory_buf buf;
+        fmt_memory_buf& buf = basic_sink<Mutex>::output_buf_();
         basic_sink<Mutex>::formatter_->format(msg, buf);
-        ostream_.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+        output_formatted_(msg, fmt_string_view(buf.data(), buf.size()));
+    }
+
+    void output_formatted_(const base::log_msg&, fmt_string_view formatted) override {
+        ostream_.write(formatted.data(), static_cast<std::streamsize>(formatted.size()));
         
         if (force_flush_) { ostream_.flush(); }
     }
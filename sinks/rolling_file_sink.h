@@ -6,13 +6,21 @@
 #include "sync_factory.h"
 #include "base/null_mutex.h"
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 namespace learnlog {
 namespace sinks {
 
 // basic_sink 的派生类，
 // 是模板参数为 Mutex 的模板类，在需要保证线程安全时传入 std::mutex，不需要时传入 base::null_mutex，
 // rolling_file_sink 会把格式化后的 log_msg 依次写入自动编号的多个文件中，
-// 单个文件的大小不超过 max_file_size，文件的总个数不超过 max_file_num
+// 单个文件的大小不超过 max_file_size，文件的总个数不超过 max_file_num；
+// 后台线程提前找到下一个文件编号并创建、打开文件，滚动时只需换用准备好的文件流，
+// 被换下的文件由后台线程关闭，写入线程不在滚动时打开、关闭文件或检查文件是否存在；
+// 运行期间下一个编号的文件（目标文件已存在时为 ".tmp" 临时文件）已被创建，析构时删除未使用的文件
 
 template <typename Mutex>
 class rolling_file_sink final : public basic_sink<Mutex> {
@@ -36,13 +44,44 @@ public:
             if ( !base::os::dir_exist(get_rolling_filename(file_index_)) )
                 break;
         }
-        base::file_base::open(&file_, get_rolling_filename(file_index_), true);
+        cur_fname_ = get_rolling_filename(file_index_);
+        base::file_base::open(&file_, cur_fname_, true);
         cur_file_size_ = 0;
+        basic_sink<Mutex>::enable_formatted_output_();
+        retired_.reserve(4);
+        roller_ = std::thread([this]() { roller_loop_(); });
     }
 
+    // 后台线程退出后可能还没有准备好下一个文件，不能再调用等待后台线程的 flush_()，直接刷新当前文件
     ~rolling_file_sink() { 
-        basic_sink<Mutex>::flush();
-        base::file_base::close(&file_, get_rolling_filename(file_index_));
+        {
+            std::lock_guard<std::mutex> lock(roller_mutex_);
+            stop_ = true;
+        }
+        roller_cv_.notify_all();
+        roller_.join();
+
+        for (FILE* fp : retired_) {
+            ::fclose(fp);
+        }
+        if (!rename_from_.empty()) {
+            replace_file_(rename_from_, rename_to_);
+        }
+        closing_ = 0;
+        if (next_ready_) {
+            ::fclose(next_.fp);
+            base::os::remove_file(next_.tmp_fname.empty() ? next_.fname : next_.tmp_fname);
+        }
+        try {
+            base::file_base::flush(file_, cur_fname_);
+            base::file_base::close(&file_, cur_fname_);
+        }
+        catch (const std::exception& e) {
+            learnlog::handle_excpt(e.what());
+        }
+        catch (...) {
+            learnlog::handle_excpt("learnlog::rolling_file_sink: unknown exception in destructor");
+        }
     }
    
     filename_t base_filename() const { return base_fname_; }
@@ -83,50 +122,237 @@ public:
     }
 
 private:
-    // 判断在写入 log_msg 后当前文件的大小是否会超过 max_file_size_，如果会则
-    // 滚动文件（即保存关闭当前文件，打开新文件），
-    // 当前文件的大小由 cur_file_size_ 维护，file_base::size() 的开销较大，只用于
-    // 避免因 log_msg 过大而出现空文件
+    // 后台线程准备好的下一个文件，tmp_fname 不为空时，目标文件已存在，
+    // 准备的是临时文件，滚动后把临时文件重命名为目标文件（rename_to 与 fname 相同）
+    struct next_file {
+        FILE* fp{nullptr};
+        filename_t fname;
+        filename_t tmp_fname;
+        filename_t rename_to;
+        size_t index{0};
+    };
+
+    // 判断在写入 log_msg 后当前文件的大小是否会超过 max_file_size_，如果会则滚动文件，
+    // 当前文件的大小由 cur_file_size_ 维护（文件总是以 truncate 模式打开），
+    // 当前文件为空时不滚动，避免因 log_msg 过大而出现空文件
     void output_(const base::log_msg &msg) override {
-        fmt_memory_buf buf;
+        fmt_memory_buf& buf = basic_sink<Mutex>::output_buf_();
         basic_sink<Mutex>::formatter_->format(msg, buf);
-        if (cur_file_size_ + buf.size() > max_file_size_) {
-            flush_();
-            if (base::file_base::size(file_, get_rolling_filename(file_index_)) > 0) {
-                roll_file_();
-            }
+        output_formatted_(msg, fmt_string_view(buf.data(), buf.size()));
+    }
+
+    void output_formatted_(const base::log_msg &, fmt_string_view formatted) override {
+        if (cur_file_size_ > 0 && cur_file_size_ + formatted.size() > max_file_size_) {
+            roll_file_();
             cur_file_size_ = 0;
         }
-        base::file_base::write(file_, get_rolling_filename(file_index_), buf);
-        cur_file_size_ += buf.size();
+        base::file_base::write(file_, cur_fname_, formatted.data(), formatted.size());
+        cur_file_size_ += formatted.size();
     }
 
+    // 刷新当前文件，并等待后台线程关闭被换下的文件、准备好下一个文件，
+    // 之后已输出的日志都已写入文件，后台线程处于空闲状态
     void flush_() override {
-        base::file_base::flush(file_, get_rolling_filename(file_index_));
+        base::file_base::flush(file_, cur_fname_);
+
+        std::unique_lock<std::mutex> lock(roller_mutex_);
+        roller_cv_.wait(lock, [this]() {
+            return closing_ == 0 && (next_ready_ || prepare_error_ != 0);
+        });
+        if (close_error_ != 0) {
+            int err = close_error_;
+            close_error_ = 0;
+            throw_roll_error_("close or rename", err);
+        }
     }
 
-    // 保存关闭当前文件，然后找到新的滚动文件名，打开新文件，
-    // 如果文件编号已经是 max_file_num_，用 truncate 模式重新打开当前文件
+    // 换用后台线程准备好的文件，当前文件交给后台线程关闭；
+    // 准备好的是临时文件时，写入临时文件的数据在重命名后即位于目标文件中，重命名也交给后台线程，
+    // 被替换的目标文件在后台线程关闭时才释放
     void roll_file_() {
-        base::file_base::close(&file_, get_rolling_filename(file_index_));
+        std::unique_lock<std::mutex> lock(roller_mutex_);
+        roller_cv_.wait(lock, [this]() { return next_ready_ || prepare_error_ != 0; });
+        if (!next_ready_) {
+            // 下一次滚动时让后台线程重试
+            int err = prepare_error_;
+            prepare_error_ = 0;
+            lock.unlock();
+            roller_cv_.notify_all();
+            throw_roll_error_("open", err);
+        }
 
-        // 找到当前文件路径下不引起冲突的最小文件编号，且保证编号范围是 [1, max_file_num_]
-        for (; file_index_ < max_file_num_; ++file_index_) {
-            if ( !base::os::dir_exist(get_rolling_filename(file_index_)) )
+        next_ready_ = false;
+        if (!next_.tmp_fname.empty()) {
+#ifdef _WIN32
+            // windows 下不能以重命名替换已打开或已存在的文件，先关闭当前文件、删除目标文件再重命名
+            if (next_.fname == cur_fname_) {
+                base::file_base::close(&file_, cur_fname_);
+            }
+            base::os::remove_file(next_.fname);
+            if (base::os::rename_file(next_.tmp_fname, next_.fname) != 0) {
+                int err = errno;
+                if (file_ == nullptr) {
+                    // 当前文件已关闭，改为写入临时文件，之后的写入不会使用空的文件流
+                    file_ = next_.fp;
+                    file_index_ = next_.index;
+                    cur_fname_ = next_.tmp_fname;
+                    cur_file_size_ = 0;
+                }
+                else {
+                    retired_.push_back(next_.fp);
+                    ++closing_;
+                }
+                lock.unlock();
+                roller_cv_.notify_all();
+                throw_roll_error_("rename", err);
+            }
+#else
+            rename_from_.swap(next_.tmp_fname);
+            rename_to_.swap(next_.rename_to);
+            ++closing_;
+#endif
+        }
+        if (file_ != nullptr) {
+            retired_.push_back(file_);
+            ++closing_;
+        }
+        file_ = next_.fp;
+        file_index_ = next_.index;
+        cur_fname_.swap(next_.fname);
+        lock.unlock();
+        roller_cv_.notify_all();
+    }
+
+    // 后台线程：完成重命名，关闭被换下的文件，准备下一个文件
+    void roller_loop_() {
+        std::vector<FILE*> retired;
+        retired.reserve(retired_.capacity());
+        filename_t rename_from, rename_to;
+
+        std::unique_lock<std::mutex> lock(roller_mutex_);
+        while (true) {
+            roller_cv_.wait(lock, [this]() {
+                return stop_ || closing_ > 0 || (!next_ready_ && prepare_error_ == 0);
+            });
+            if (stop_) {
+                break;
+            }
+
+            retired.swap(retired_);
+            rename_from.swap(rename_from_);
+            rename_to.swap(rename_to_);
+            size_t done = retired.size() + (rename_from.empty() ? 0 : 1);
+            bool need_next = !next_ready_ && prepare_error_ == 0;
+            size_t index = file_index_;
+            lock.unlock();
+
+            int close_err = 0;
+            for (FILE* fp : retired) {
+                if (::fclose(fp) != 0) close_err = errno;
+            }
+            retired.clear();
+            if (!rename_from.empty()) {
+                int err = replace_file_(rename_from, rename_to);
+                close_err = err != 0 ? err : close_err;
+                rename_from.clear();
+            }
+            next_file next;
+            int err = need_next ? prepare_next_(index, next) : 0;
+
+            lock.lock();
+            closing_ -= done;
+            if (close_err != 0) {
+                close_error_ = close_err;
+            }
+            if (need_next) {
+                if (err == 0) {
+                    next_ = std::move(next);
+                    next_ready_ = true;
+                }
+                else {
+                    prepare_error_ = err;
+                }
+            }
+            roller_cv_.notify_all();
+        }
+    }
+
+    // 以临时文件替换目标文件，成功返回 0，否则返回 errno；
+    // unix 下先删除目标文件再建立硬链接，ext4 等文件系统在重命名覆盖已有文件时会同步写出新文件的数据，
+    // 不支持硬链接时退回重命名
+    static int replace_file_(const filename_t& from, const filename_t& to) {
+#ifndef _WIN32
+        ::unlink(to.c_str());
+        if (::link(from.c_str(), to.c_str()) == 0) {
+            return ::unlink(from.c_str()) == 0 ? 0 : errno;
+        }
+#endif
+        return base::os::rename_file(from, to) == 0 ? 0 : errno;
+    }
+
+    // 从当前编号开始找到不引起冲突的最小文件编号，编号范围是 [1, max_file_num_]，
+    // 创建并打开文件，目标文件已存在时创建临时文件，成功返回 0，否则返回 errno
+    int prepare_next_(size_t index, next_file& out) {
+        for (; index < max_file_num_; ++index) {
+            if ( !base::os::dir_exist(get_rolling_filename(index)) )
                 break;
         }
+        out.index = index;
+        out.fname = get_rolling_filename(index);
+        if (base::os::dir_exist(out.fname)) {
+#ifdef _WIN32
+            out.tmp_fname = out.fname + L".tmp";
+#else
+            out.tmp_fname = out.fname + ".tmp";
+#endif
+            out.rename_to = out.fname;
+            base::os::remove_file_if_exist(out.tmp_fname);
+        }
 
-        base::file_base::open(&file_, get_rolling_filename(file_index_), true);
+        const filename_t& path = out.tmp_fname.empty() ? out.fname : out.tmp_fname;
+#ifdef _WIN32
+        filename_t mode(L"ab");
+#else
+        filename_t mode("ab");
+#endif
+        base::os::create_dir(base::os::get_dir(path));
+        if (!base::os::open_file(&out.fp, path, mode)) {
+            return errno == 0 ? EIO : errno;
+        }
+        return 0;
+    }
+
+    void throw_roll_error_(const char* op, int err) const {
+        source_loc loc{__FILE__, __LINE__, __func__};
+        std::string fname_str(base_fname_.begin(), base_fname_.end());
+        std::string err_str = fmt::format("learnlog::rolling_file_sink: {} failed, base filename: '{}'",
+                                          op, fname_str);
+        throw_learnlog_excpt(err_str, err, loc);
     }
 
     FILE* file_{nullptr};
     filename_t base_fname_;
+    filename_t cur_fname_;      // 当前文件名，只在滚动时重新生成
     
     size_t file_index_;
     size_t cur_file_size_;
 
     size_t max_file_size_;
     size_t max_file_num_;
+
+    // 以下由 roller_mutex_ 保护，与后台线程共享，file_index_ 只在 roller_mutex_ 加锁时修改
+    std::thread roller_;
+    std::mutex roller_mutex_;
+    std::condition_variable roller_cv_;
+    next_file next_;
+    bool next_ready_{false};
+    std::vector<FILE*> retired_;    // 被换下、等待关闭的文件
+    filename_t rename_from_;        // 等待重命名的临时文件
+    filename_t rename_to_;
+    size_t closing_{0};             // 等待关闭的文件数与等待重命名的文件数之和
+    int prepare_error_{0};
+    int close_error_{0};
+    bool stop_{false};
 };
 
 using rolling_file_sink_mt = rolling_file_sink<std::mutex>;
@@ -19,6 +19,31 @@ class sink {
 public:
     virtual ~sink() = default;
     virtual void log(const base::log_msg &msg) = 0;                     // 输出 1 条日志消息
+    // 依次输出 msg_num 条日志消息，默认逐条调用 log()，派生类可覆写以减少加锁与写入次数
+    virtual void log_batch(const base::log_msg* const* msgs, size_t msg_num) {
+        for (size_t i = 0; i < msg_num; ++i) {
+            log(*msgs[i]);
+        }
+    }
+    // 输出 logger 已经格式化好的 1 条日志消息，formatted 由指纹相同的 sink 的 formatter 得到，
+    // 颜色区间已记录在 msg 中；只对 formatter_fingerprint() 非 0 的 sink 调用
+    virtual void write_formatted(const base::log_msg& msg, fmt_string_view formatted) {
+        (void)formatted;
+        log(msg);
+    }
+    // 依次输出 msg_num 条已经格式化好的日志消息，默认逐条调用 write_formatted()
+    virtual void write_formatted_batch(const base::log_msg* const* msgs,
+                                       const fmt_string_view* formatted, size_t msg_num) {
+        for (size_t i = 0; i < msg_num; ++i) {
+            write_formatted(*msgs[i], formatted[i]);
+        }
+    }
+    // 用 sink 的 formatter 格式化 msg，供 logger 对指纹相同的多个 sink 只格式化一次，
+    // 只对 formatter_fingerprint() 非 0 的 sink 调用
+    virtual void format(const base::log_msg& msg, fmt_memory_buf& dest_buf) {
+        (void)msg;
+        (void)dest_buf;
+    }
     virtual void flush() = 0;                                           // 清空缓冲区，立即输出缓冲区内所有日志消息
     virtual void set_pattern(const std::string &pattern) = 0;           // 设置格式模板字符串
     virtual void set_formatter(formatter_uni_ptr sink_formatter) = 0;   // 指定 formatter
@@ -34,8 +59,16 @@ public:
         return msg_level >= sink_level_.load(std::memory_order_relaxed);
     }
 
+    // formatter 的指纹，非 0 且相同的 sink 对同一条 log_msg 格式化得到的字节相同，
+    // logger 对它们只格式化一次，再通过 write_formatted() 分别输出；
+    // 为 0 表示不共享格式化结果，sink 通过 log() 自行格式化，派生类支持 write_formatted() 时才设置
+    size_t formatter_fingerprint() const {
+        return fingerprint_.load(std::memory_order_relaxed);
+    }
+
 protected:
     std::atomic<int> sink_level_{level::level_enum::trace};      // sink 等级
+    std::atomic<size_t> fingerprint_{0};                        // formatter 的指纹
 };
 
 }   // namespace sinks
@@ -43,6 +43,7 @@ public:
                                 base::os::get_errno(), loc);
         }
 #endif  // _WIN32
+        update_fingerprint_();
     }
 
     ~std_sink() override = default;
@@ -72,21 +73,27 @@ public:
             throw_learnlog_excpt("learnlog::std_sink: WriteConsoleW() failed", 
                                 base::os::get_errno(), loc);
         }
+        ::fflush(file_);    // 每条日志输出后立即清空缓冲区
 #else
         std::lock_guard<mutex_t> lock(mutex_);
         fmt_memory_buf buf;
         formatter_->format(msg, buf);
-        size_t bytes_written = ::fwrite(buf.data(), sizeof(char), buf.size(), file_);
-
-        if (bytes_written != buf.size()) {
-            source_loc loc{__FILE__, __LINE__, __func__};
-            throw_learnlog_excpt("learnlog::std_sink: fwrite() failed", 
-                                base::os::get_errno(), loc);
-        }
+        write_(fmt_string_view(buf.data(), buf.size()));
 #endif
-        ::fflush(file_);    // 每条日志输出后立即清空缓冲区
     }
 
+#ifndef _WIN32
+    void write_formatted(const base::log_msg&, fmt_string_view formatted) override {
+        std::lock_guard<mutex_t> lock(mutex_);
+        write_(formatted);
+    }
+
+    void format(const base::log_msg& msg, fmt_memory_buf& dest_buf) override {
+        std::lock_guard<mutex_t> lock(mutex_);
+        formatter_->format(msg, dest_buf);
+    }
+#endif
+
     void flush() override {
         std::lock_guard<mutex_t> lock(mutex_);
         ::fflush(file_);
@@ -95,14 +102,36 @@ public:
     void set_pattern(const std::string& pattern) override {
         std::lock_guard<mutex_t> lock(mutex_);
         formatter_ = learnlog::make_unique<pattern_formatter>(pattern);
+        update_fingerprint_();
     }
 
     void set_formatter(formatter_uni_ptr formatter) override {
         std::lock_guard<mutex_t> lock(mutex_);
         formatter_ = std::move(formatter);
+        update_fingerprint_();
     }
 
 private:
+    // Windows 下需要逐条转换为 wchar 输出，不共享格式化结果
+    void update_fingerprint_() {
+#ifndef _WIN32
+        fingerprint_.store(formatter_->fingerprint(), std::memory_order_relaxed);
+#endif
+    }
+
+#ifndef _WIN32
+    void write_(fmt_string_view buf) {
+        size_t bytes_written = ::fwrite(buf.data(), sizeof(char), buf.size(), file_);
+
+        if (bytes_written != buf.size()) {
+            source_loc loc{__FILE__, __LINE__, __func__};
+            throw_learnlog_excpt("learnlog::std_sink: fwrite() failed", 
+                                base::os::get_errno(), loc);
+        }
+        ::fflush(file_);    // 每条日志输出后立即清空缓冲区
+    }
+#endif
+
     mutex_t& mutex_;
     FILE* file_;
     formatter_uni_ptr formatter_;
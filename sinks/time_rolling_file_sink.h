@@ -0,0 +1,237 @@
+#pragma once
+
+#include "sinks/basic_sink.h"
+#include "base/exception.h"
+#include "base/file_base.h"
+#include "base/circular_queue.h"
+#include "sync_factory.h"
+#include "base/null_mutex.h"
+
+#include <algorithm>
+#include <ctime>
+#include <vector>
+
+namespace learnlog {
+namespace sinks {
+
+// 按时间滚动的周期，以本地时间的整点 / 零点为边界
+enum class rolling_period {
+    hourly,
+    daily
+};
+
+// basic_sink 的派生类，
+// 是模板参数为 Mutex 的模板类，在需要保证线程安全时传入 std::mutex，不需要时传入 base::null_mutex，
+// time_rolling_file_sink 按小时或按天把格式化后的 log_msg 写入不同的文件，
+// 文件名由 strftime 格式的 fname_pattern 根据滚动时刻的本地时间生成，如 "logs/app_%Y-%m-%d_%H.log"，
+// 滚动后文件名不变时（如模板中不包含时间字段）继续写入当前文件，不重新打开，truncate 只在文件名变化时生效；
+// 下一次滚动的时刻在滚动时预先算好，每条日志只比较一次 log_msg::time，不调用 localtime()；
+// max_files 不为 0 时，只保留最近的 max_files 个文件，滚动时删除更早的文件，
+// 启动时按周期向前查找已存在的文件，跳过中间缺失的周期，
+// 查找范围为 max_files 个周期加上 max_lookback_periods 个周期，更早的旧文件不会被记录和删除
+
+template <typename Mutex>
+class time_rolling_file_sink final : public basic_sink<Mutex> {
+public:
+    explicit time_rolling_file_sink(const filename_t& fname_pattern,
+                                    rolling_period period = rolling_period::daily,
+                                    size_t max_files = 0,
+                                    bool truncate = false)
+        : fname_pattern_(fname_pattern),
+          period_(period),
+          max_files_(max_files),
+          truncate_(truncate)
+    {
+        if (fname_pattern_.empty()) {
+            throw_learnlog_excpt("learnlog::time_rolling_file_sink: fname_pattern is empty");
+        }
+
+        sys_clock::time_point now = sys_clock::now();
+        cur_fname_ = calc_filename(base::os::time_point_to_tm(now));
+        base::file_base::open(&file_, cur_fname_, truncate_);
+        next_roll_tp_ = next_rolling_tp_(now);
+        if (max_files_ > 0) {
+            init_filenames_(now);
+        }
+        basic_sink<Mutex>::enable_formatted_output_();
+    }
+
+    ~time_rolling_file_sink() {
+        basic_sink<Mutex>::flush();
+        base::file_base::close(&file_, cur_fname_);
+    }
+
+    filename_t filename() {
+        std::lock_guard<Mutex> lock(basic_sink<Mutex>::mutex_);
+        return cur_fname_;
+    }
+
+    // 由 fname_pattern_ 和本地时间 tm 生成文件名
+    filename_t calc_filename(const std::tm& tm) const {
+        filename_t buf(fname_pattern_.size() + 64, 0);
+        while (true) {
+#ifdef _WIN32
+            size_t len = std::wcsftime(&buf[0], buf.size(), fname_pattern_.c_str(), &tm);
+#else
+            size_t len = std::strftime(&buf[0], buf.size(), fname_pattern_.c_str(), &tm);
+#endif
+            // 返回 0 时可能是缓冲区不足，也可能是结果本身为空
+            if (len > 0 || buf.size() > fname_pattern_.size() * 16 + 1024) {
+                buf.resize(len);
+                return buf;
+            }
+            buf.resize(buf.size() * 2);
+        }
+    }
+
+private:
+    // 判断 log_msg 的时间是否已到达下一次滚动的时刻，如果到达则滚动文件
+    void output_(const base::log_msg &msg) override {
+        fmt_memory_buf& buf = basic_sink<Mutex>::output_buf_();
+        basic_sink<Mutex>::formatter_->format(msg, buf);
+        output_formatted_(msg, fmt_string_view(buf.data(), buf.size()));
+    }
+
+    void output_formatted_(const base::log_msg &msg, fmt_string_view formatted) override {
+        if (msg.time >= next_roll_tp_) {
+            roll_file_(msg.time);
+        }
+        base::file_base::write(file_, cur_fname_, formatted.data(), formatted.size());
+    }
+
+    void flush_() override {
+        base::file_base::flush(file_, cur_fname_);
+    }
+
+    // 关闭当前文件，打开 tp 对应的新文件，再计算下一次滚动的时刻，
+    // 文件名不变时只更新滚动时刻，避免 truncate 清空正在写入的文件
+    void roll_file_(sys_clock::time_point tp) {
+        filename_t fname = calc_filename(base::os::time_point_to_tm(tp));
+        next_roll_tp_ = next_rolling_tp_(tp);
+        if (fname == cur_fname_) {
+            return;
+        }
+        base::file_base::close(&file_, cur_fname_);
+        cur_fname_ = std::move(fname);
+        base::file_base::open(&file_, cur_fname_, truncate_);
+        if (max_files_ > 0) {
+            delete_old_();
+        }
+    }
+
+    // tp 之后的第一个整点（hourly）或零点（daily），由 mktime() 处理跨月与夏令时
+    sys_clock::time_point next_rolling_tp_(sys_clock::time_point tp) const {
+        std::tm tm = base::os::time_point_to_tm(tp);
+        tm.tm_sec = 0;
+        tm.tm_min = 0;
+        if (period_ == rolling_period::daily) {
+            tm.tm_hour = 0;
+            tm.tm_mday += 1;
+        }
+        else {
+            tm.tm_hour += 1;
+        }
+        tm.tm_isdst = -1;
+        sys_clock::time_point next = sys_clock::from_time_t(std::mktime(&tm));
+        if (next <= tp) {
+            next = tp + period_length_();
+        }
+        return next;
+    }
+
+    std::chrono::seconds period_length_() const {
+        return std::chrono::seconds(period_ == rolling_period::daily ? 86400 : 3600);
+    }
+
+    // 从当前时刻开始按周期向前查找已存在的文件，跳过缺失的周期，
+    // 最多查找 max_files_ + max_lookback_periods 个周期
+    void init_filenames_(sys_clock::time_point now) {
+        filenames_ = base::circular_queue<filename_t>(max_files_);
+        std::vector<filename_t> found;
+        sys_clock::time_point tp = now;
+        size_t periods = max_files_ + max_lookback_periods;
+        for (size_t i = 0; i < periods && found.size() < max_files_; ++i, tp -= period_length_()) {
+            filename_t fname = calc_filename(base::os::time_point_to_tm(tp));
+            if (!base::os::dir_exist(fname)) {
+                continue;
+            }
+            // 模板的时间字段比周期粗时，相邻周期的文件名相同
+            if (std::find(found.begin(), found.end(), fname) != found.end()) {
+                continue;
+            }
+            found.push_back(std::move(fname));
+        }
+        for (auto it = found.rbegin(); it != found.rend(); ++it) {
+            filenames_.push_back(std::move(*it));
+        }
+    }
+
+    // 记录当前文件，超过 max_files_ 个文件时删除最早的文件
+    void delete_old_() {
+        if (!filenames_.empty() && filenames_.at(filenames_.size() - 1) == cur_fname_) {
+            return;
+        }
+        filename_t cur_fname = cur_fname_;
+        if (filenames_.full()) {
+            filename_t old_fname = std::move(filenames_.front());
+            filenames_.pop_front();
+            if (base::os::remove_file_if_exist(old_fname) != 0) {
+                filenames_.push_back(std::move(cur_fname));
+                source_loc loc{__FILE__, __LINE__, __func__};
+                std::string fname_str(old_fname.begin(), old_fname.end());
+                std::string err_str = fmt::format(
+                    "learnlog::time_rolling_file_sink: failed removing file '{}'", fname_str);
+                throw_learnlog_excpt(err_str, base::os::get_errno(), loc);
+            }
+        }
+        filenames_.push_back(std::move(cur_fname));
+    }
+
+    // 启动时在 max_files_ 个周期之外额外向前查找的周期数，用于跳过停止运行期间缺失的文件
+    static const size_t max_lookback_periods = 366;
+
+    FILE* file_{nullptr};
+    filename_t fname_pattern_;
+    filename_t cur_fname_;
+    sys_clock::time_point next_roll_tp_;    // 下一次滚动的时刻
+
+    rolling_period period_;
+    size_t max_files_;
+    bool truncate_;
+    base::circular_queue<filename_t> filenames_;    // 保留的文件，最早的在队首
+};
+
+using time_rolling_file_sink_mt = time_rolling_file_sink<std::mutex>;
+using time_rolling_file_sink_st = time_rolling_file_sink<base::null_mutex>;
+
+}   // namespace sinks
+
+// factory 函数，创建使用 time_rolling_file_sink 的 logger 对象
+
+template <typename Factory = learnlog::sync_factory>
+logger_shr_ptr time_rolling_file_logger_mt(const std::string& logger_name,
+                                           const filename_t& fname_pattern,
+                                           sinks::rolling_period period = sinks::rolling_period::daily,
+                                           size_t max_files = 0,
+                                           bool truncate = false) {
+    return Factory::template create<sinks::time_rolling_file_sink_mt>(logger_name,
+                                                                      fname_pattern,
+                                                                      period,
+                                                                      max_files,
+                                                                      truncate);
+}
+
+template <typename Factory = learnlog::sync_factory>
+logger_shr_ptr time_rolling_file_logger_st(const std::string& logger_name,
+                                           const filename_t& fname_pattern,
+                                           sinks::rolling_period period = sinks::rolling_period::daily,
+                                           size_t max_files = 0,
+                                           bool truncate = false) {
+    return Factory::template create<sinks::time_rolling_file_sink_st>(logger_name,
+                                                                      fname_pattern,
+                                                                      period,
+                                                                      max_files,
+                                                                      truncate);
+}
+
+}   // namespace learnlog
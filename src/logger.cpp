@@ -2,6 +2,8 @@
 #include "sinks/formatters/pattern_formatter.h"
 #include "sinks/sink.h"
 
+#include <array>
+
 using namespace learnlog;
 
 void logger::swap(logger& other) noexcept {
@@ -10,6 +12,7 @@ void logger::swap(logger& other) noexcept {
     std::swap(log_level_, other.log_level_);
     std::swap(flush_level_, other.flush_level_);
     std::swap(tracer_, other.tracer_);
+    std::swap(deferred_fmt_, other.deferred_fmt_);
 }
 
 void logger::set_pattern(std::string pattern) {
@@ -53,10 +56,17 @@ void logger::do_log_(const base::log_msg& msg, bool log_enabled, bool traceback_
 }
 
 void logger::sink_log_(const base::log_msg& msg) {
-    for (auto &sink : sinks_) {
-        if (sink->should_log(msg.level)) {
-            try { sink->log(msg); }
-            LEARNLOG_CATCH
+    std::array<size_t, max_shared_sinks> leaders;
+    if (sinks_.size() > 1 && sinks_.size() <= max_shared_sinks &&
+        group_sinks_(leaders.data(), msg.level)) {
+        shared_sink_log_(msg, leaders.data());
+    }
+    else {
+        for (auto &sink : sinks_) {
+            if (sink->should_log(msg.level)) {
+                try { sink->log(msg); }
+                LEARNLOG_CATCH
+            }
         }
     }
 
@@ -65,6 +75,74 @@ void logger::sink_log_(const base::log_msg& msg) {
     }
 }
 
+// 指纹只读取一次，之后 sink 的 formatter 被替换也不影响本次分组
+bool logger::group_sinks_(size_t* leaders, level::level_enum msg_level) const {
+    std::array<size_t, max_shared_sinks> fps;
+    bool shared = false;
+    for (size_t i = 0; i < sinks_.size(); ++i) {
+        leaders[i] = no_sink;
+        if (!sinks_[i]->should_log(msg_level)) {
+            continue;
+        }
+        leaders[i] = i;
+        fps[i] = sinks_[i]->formatter_fingerprint();
+        for (size_t j = 0; fps[i] != 0 && j < i; ++j) {
+            if (leaders[j] == j && fps[j] == fps[i]) {
+                leaders[i] = j;
+                shared = true;
+                break;
+            }
+        }
+    }
+    return shared;
+}
+
+size_t logger::group_size_(const size_t* leaders, size_t leader) const {
+    size_t cnt = 0;
+    for (size_t i = leader; i < sinks_.size(); ++i) {
+        if (leaders[i] == leader) { ++cnt; }
+    }
+    return cnt;
+}
+
+// 格式化前清空颜色区间，格式化得到的颜色区间由同一组的 sink 共用；
+// 格式化失败时，该组的 sink 退回 log() 各自格式化
+void logger::shared_sink_log_(const base::log_msg& msg, const size_t* leaders) {
+    fmt_memory_buf buf;
+    for (size_t i = 0; i < sinks_.size(); ++i) {
+        if (leaders[i] != i) {
+            continue;
+        }
+        if (group_size_(leaders, i) == 1) {
+            try { sinks_[i]->log(msg); }
+            LEARNLOG_CATCH
+            continue;
+        }
+
+        bool formatted = false;
+        try {
+            buf.clear();
+            msg.color_index_start = 0;
+            msg.color_index_end = 0;
+            sinks_[i]->format(msg, buf);
+            formatted = true;
+        }
+        LEARNLOG_CATCH
+
+        fmt_string_view formatted_msg(buf.data(), buf.size());
+        for (size_t j = i; j < sinks_.size(); ++j) {
+            if (leaders[j] != i) {
+                continue;
+            }
+            try {
+                if (formatted) { sinks_[j]->write_formatted(msg, formatted_msg); }
+                else { sinks_[j]->log(msg); }
+            }
+            LEARNLOG_CATCH
+        }
+    }
+}
+
 void logger::flush_sink_() {
     for(auto &sink : sinks_) {
         try { sink->flush(); }
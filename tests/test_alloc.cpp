@@ -0,0 +1,244 @@
+#include <catch2/catch_all.hpp>
+#include "logger.h"
+#include "async_logger.h"
+#include "base/lock_thread_pool.h"
+#include "sinks/basic_file_sink.h"
+#include "sinks/rolling_file_sink.h"
+#include "sinks/formatters/pattern_formatter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// 替换全局的 operator new / delete 与 glibc 的 malloc 系列函数，统计计数开启期间的堆分配次数；
+// 替换对整个进程生效，因此单独编译为 learnlog-utests-alloc
+
+namespace {
+
+std::atomic<bool> counting{false};
+std::atomic<size_t> alloc_count{0};
+
+inline void count_alloc() {
+    if (counting.load(std::memory_order_relaxed)) {
+        alloc_count.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+}   // namespace
+
+#if defined(__GLIBC__)
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t num, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void __libc_free(void* ptr);
+
+void* malloc(size_t size) {
+    count_alloc();
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t num, size_t size) {
+    count_alloc();
+    return __libc_calloc(num, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    count_alloc();
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr) {
+    __libc_free(ptr);
+}
+}   // extern "C"
+#endif
+
+void* operator new(size_t size) {
+    count_alloc();
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return ::operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    count_alloc();
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return ::operator new(size, std::nothrow);
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+
+#ifdef _WIN32
+    #define A_FNAME L"test_tmp/alloc_test.txt"
+    #define R_FNAME L"test_tmp/alloc_rolling_test.txt"
+#else
+    #define A_FNAME "test_tmp/alloc_test.txt"
+    #define R_FNAME "test_tmp/alloc_rolling_test.txt"
+#endif
+
+// 只用到 file_utils.h 中的两个函数，不包含整个头文件，避免其余未使用的函数产生警告
+static void clean_test_tmp() {
+#ifdef _WIN32
+    system("rmdir /S /Q test_tmp");
+#else
+    if (system("rm -rf test_tmp") != 0) {
+        throw std::runtime_error("Failed to rm -rf test_tmp");
+    }
+#endif
+}
+
+static std::string file_content(const learnlog::filename_t& filename) {
+    std::string fname(filename.begin(), filename.end());
+    std::ifstream ifs(fname, std::ios_base::binary);
+    if (!ifs) {
+        throw std::runtime_error("Failed to open file: " + fname);
+    }
+    return std::string((std::istreambuf_iterator<char>(ifs)), 
+                       (std::istreambuf_iterator<char>()));
+}
+
+// 先输出几条预热（打开 FILE 缓冲区、填充时间缓存等），再统计 n 次 log 调用的堆分配次数
+template <typename Fn>
+size_t allocs_of(Fn&& fn, size_t n = 16) {
+    for (size_t i = 0; i < 4; ++i) {
+        fn();
+    }
+    alloc_count.store(0);
+    counting.store(true);
+    for (size_t i = 0; i < n; ++i) {
+        fn();
+    }
+    counting.store(false);
+    return alloc_count.load();
+}
+
+size_t logger_allocs(learnlog::logger& logger) {
+    return allocs_of([&logger]() {
+        logger.info("alloc free {} {}", 42, "text");
+        logger.log(learnlog::source_loc{"dir/alloc.cpp", 12, "func"},
+                   learnlog::level::warn, "with source_loc {}", 3.5);
+        logger.info(learnlog::fmt_string_view("plain string view"));
+    });
+}
+
+// ======================================================================================
+
+TEST_CASE("alloc_counter", "[alloc]") {
+    // 确认计数本身生效
+    size_t n = allocs_of([]() {
+        std::string* s = new std::string(300, 'a');
+        delete s;
+    });
+    REQUIRE(n >= 16);
+
+#if defined(__GLIBC__)
+    n = allocs_of([]() { std::free(std::malloc(64)); });
+    REQUIRE(n == 16);
+#endif
+}
+
+TEST_CASE("alloc_free_flags", "[alloc]") {
+    clean_test_tmp();
+    auto file_sink = std::make_shared<learnlog::sinks::basic_file_sink_st>(A_FNAME, true);
+    learnlog::logger logger("alloc_test_logger", file_sink);
+    logger.set_log_level(learnlog::level::trace);
+
+    const std::vector<std::string> flags = {
+        "+", "n", "l", "a", "b", "c", "y", "m", "d", "H", "M", "S", "E", "F", "G", "T",
+        "W", "X", "Y", "Z", "p", "t", "v", "^", "$", "@", "A", "B", "C",
+        "z", "I", "J", "K", "L", "%", "q"
+    };
+    for (const auto& flag : flags) {
+        for (const char* spaces : {"", "12", "-12", "=12", "3!"}) {
+            std::string pattern = std::string("[%") + spaces + flag + "] %v";
+            logger.set_pattern(pattern);
+            INFO("pattern: " << pattern);
+            REQUIRE(logger_allocs(logger) == 0);
+        }
+    }
+
+    // 多个格式字符组合，及 UTC 时区
+    logger.set_pattern("%+ [%Y %X] %I|%J|%K|%L|%z %@ %p %t");
+    REQUIRE(logger_allocs(logger) == 0);
+    auto utc = learnlog::make_unique<learnlog::sinks::pattern_formatter>("%+ %L%z");
+    utc->set_time_zone(learnlog::sinks::time_zone::utc());
+    logger.set_formatter(std::move(utc));
+    REQUIRE(logger_allocs(logger) == 0);
+
+    logger.flush();
+    REQUIRE(!file_content(A_FNAME).empty());
+}
+
+TEST_CASE("alloc_free_shared_sinks", "[alloc]") {
+    clean_test_tmp();
+    // 相同 formatter 的 sink 共享格式化结果，mt 版本加锁
+    auto sink_a = std::make_shared<learnlog::sinks::basic_file_sink_mt>(A_FNAME, true);
+    auto sink_b = std::make_shared<learnlog::sinks::basic_file_sink_mt>(A_FNAME, false);
+    learnlog::logger logger("alloc_test_logger", {sink_a, sink_b});
+    logger.set_pattern("[%T.%F] [%n] [%^%l%$] [%-8t] %v");
+    REQUIRE(logger_allocs(logger) == 0);
+
+    // formatter 不同时各自格式化
+    sink_b->set_pattern("%v");
+    REQUIRE(logger_allocs(logger) == 0);
+}
+
+TEST_CASE("alloc_free_async_shared_sinks", "[alloc]") {
+    clean_test_tmp();
+    // 后台线程复用自己的缓冲区，整批消息的共享格式化结果超过栈上缓冲区容量也不再重新分配
+    auto tp = std::make_shared<learnlog::base::lock_thread_pool>(128, 1);
+    auto sink_a = std::make_shared<learnlog::sinks::basic_file_sink_mt>(A_FNAME, true);
+    auto sink_b = std::make_shared<learnlog::sinks::basic_file_sink_mt>(A_FNAME, false);
+    auto logger = std::make_shared<learnlog::async_logger>("alloc_test_logger",
+                                                           learnlog::sinks_init_list{sink_a, sink_b},
+                                                           tp);
+    logger->set_pattern("[%T.%F] [%n] [%^%l%$] [%-8t] %v");
+    REQUIRE(allocs_of([&logger]() {
+        for (int i = 0; i < 16; ++i) {
+            logger->info("alloc free {} {}", i, "text");
+        }
+        logger->flush();
+    }) == 0);
+}
+
+TEST_CASE("alloc_free_buffer_reuse", "[alloc]") {
+    clean_test_tmp();
+    auto file_sink = std::make_shared<learnlog::sinks::basic_file_sink_st>(A_FNAME, true);
+    learnlog::logger logger("alloc_test_logger", file_sink);
+    logger.set_pattern("%v");
+
+    // 超过栈上缓冲区容量的消息会分配内存，sink 的缓冲区扩容后保留容量
+    std::string long_text(1000, 'a');
+    allocs_of([&]() { logger.info(learnlog::fmt_string_view(long_text)); });
+    REQUIRE(allocs_of([&]() { logger.info(learnlog::fmt_string_view(long_text)); }) == 0);
+    REQUIRE(logger_allocs(logger) == 0);
+}
+
+TEST_CASE("alloc_free_rolling_file_sink", "[alloc]") {
+    clean_test_tmp();
+    // 不发生滚动时，写入不再重新生成文件名；
+    // 后台线程准备下一个文件时会分配内存，计数是进程范围的，先 flush 等待后台线程空闲
+    auto rolling_sink = std::make_shared<learnlog::sinks::rolling_file_sink_st>(R_FNAME, 1024 * 1024, 3);
+    learnlog::logger logger("alloc_test_logger", rolling_sink);
+    logger.set_pattern("%+");
+    logger.flush();
+    REQUIRE(logger_allocs(logger) == 0);
+}
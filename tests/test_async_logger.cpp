@@ -4,6 +4,9 @@
 #include "sinks/std_sinks.h"
 #include "learnlog.h"
 
+#include <cstdio>
+#include <algorithm>
+
 TEST_CASE("lock_msg_queue", "[async_logger]") {
     auto test_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
     // test_sink->set_sink_delay_ms(1);
@@ -59,6 +62,52 @@ TEST_CASE("lockfree_msg_queue", "[async_logger]") {
     REQUIRE(current_cnt == 0);
 }
 
+TEST_CASE("lockfree_overflow_policy", "[async_logger]") {
+    using learnlog::base::overflow_policy;
+    size_t msg_queue_size = 128;
+    size_t thread_num = 1;
+    size_t msg_num = msg_queue_size * 8;
+    std::vector<overflow_policy> policies{overflow_policy::block,
+                                          overflow_policy::discard_new,
+                                          overflow_policy::drop_queued,
+                                          overflow_policy::spin_yield};
+
+    for (auto policy : policies) {
+        auto test_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
+        size_t discard_cnt = 0;
+        size_t override_cnt = 0;
+        {
+            auto tp = std::make_shared<learnlog::base::lockfree_thread_pool>(
+                msg_queue_size, thread_num);
+            tp->set_overflow_policy(policy);
+            auto logger = std::make_shared<learnlog::async_logger>("overflow logger",
+                                                                   test_sink,
+                                                                   tp);
+            for (size_t i = 0; i < msg_num; i++) {
+                logger->info("message {}", i);
+            }
+            logger->flush();
+            discard_cnt = tp->discard_count();
+            override_cnt = tp->override_count();
+        }
+
+        REQUIRE(test_sink->msg_count() + discard_cnt + override_cnt == msg_num);
+        REQUIRE(test_sink->flush_count() == 1);
+        if (policy == overflow_policy::block || policy == overflow_policy::spin_yield) {
+            REQUIRE(discard_cnt + override_cnt == 0);
+        }
+    }
+
+    // 通过 initialize_thread_pool 设置 overflow_policy
+    learnlog::initialize_thread_pool<learnlog::base::lockfree_thread_pool>(
+        msg_queue_size, thread_num, learnlog::base::worker_options(), overflow_policy::discard_new);
+    auto tp = std::dynamic_pointer_cast<learnlog::base::lockfree_thread_pool>(
+        learnlog::get_thread_pool());
+    REQUIRE(tp != nullptr);
+    REQUIRE(tp->get_overflow_policy() == overflow_policy::discard_new);
+    tp->set_overflow_policy(overflow_policy::block);
+}
+
 TEST_CASE("lockfree_concurrent_msg_queue", "[async_logger]") {
     auto test_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
     // test_sink->set_sink_delay_ms(1);
@@ -85,6 +134,118 @@ TEST_CASE("lockfree_concurrent_msg_queue", "[async_logger]") {
     REQUIRE(current_cnt == 0);
 }
 
+TEST_CASE("lockfree_concurrent_wait_strategy", "[async_logger]") {
+    size_t msg_queue_size = 128;
+    size_t thread_num = 2;
+    size_t msg_num = msg_queue_size * 2;
+    std::vector<learnlog::base::wait_strategy> strategies{
+        learnlog::base::wait_strategy::busy_spin,
+        learnlog::base::wait_strategy::spin_pause,
+        learnlog::base::wait_strategy::spin_yield,
+        learnlog::base::wait_strategy::spin_park
+    };
+
+    for (auto strategy : strategies) {
+        auto test_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
+        {
+            auto tp = std::make_shared<learnlog::base::lockfree_concurrent_thread_pool>(
+                                                                        msg_queue_size, 
+                                                                        thread_num);
+            tp->set_wait_strategy(strategy);
+            REQUIRE(tp->get_wait_strategy() == strategy);
+            auto logger = std::make_shared<learnlog::async_logger>("wait strategy",
+                                                                   test_sink,
+                                                                   tp);
+            for (size_t i = 0; i < msg_num / 2; i++) {
+                logger->info("message {}", i);
+            }
+            // 后台线程空闲后（spin_park 策略下阻塞），新消息入队时仍能被及时处理
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            for (size_t i = msg_num / 2; i < msg_num; i++) {
+                logger->info("message {}", i);
+            }
+            logger->flush();
+            REQUIRE(test_sink->msg_count() == msg_num);
+        }
+        REQUIRE(test_sink->flush_count() == 1);
+    }
+}
+
+TEST_CASE("spsc_msg_queue", "[async_logger]") {
+    auto test_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
+    size_t msg_queue_size = 128;
+    size_t thread_num = 1;
+    size_t msg_num = msg_queue_size * 2;
+    size_t current_cnt = 0;
+
+    {
+        auto tp = std::make_shared<learnlog::base::spsc_thread_pool>(msg_queue_size, 
+                                                                     thread_num);
+        auto logger = std::make_shared<learnlog::async_logger>("spsc logger",
+                                                               test_sink,
+                                                               tp);
+        for (size_t i = 0; i < msg_num; i++) {
+            logger->info("message {}", i);
+        }
+        logger->flush();
+        current_cnt = tp->current_msg_count();
+        REQUIRE(tp->producer_count() == 1);
+    }
+
+    REQUIRE(test_sink->msg_count() == msg_num);
+    REQUIRE(test_sink->flush_count() == 1);
+    REQUIRE(current_cnt == 0);
+
+    // 每个生产者独占一个队列，默认容量小于其他线程池
+    learnlog::base::spsc_thread_pool default_tp;
+    REQUIRE(default_tp.message_queue_size() == learnlog::base::default_spsc_queue_size);
+    REQUIRE(default_tp.message_queue_size() < learnlog::base::default_queue_size);
+}
+
+TEST_CASE("spsc_thread_order", "[async_logger]") {
+    auto test_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
+    test_sink->set_pattern("%v");
+    size_t msg_queue_size = 64;
+    size_t worker_num = 2;
+    size_t thread_num = 4;
+    size_t msg_num_per_thread = 1000;
+
+    {
+        auto tp = std::make_shared<learnlog::base::spsc_thread_pool>(msg_queue_size, 
+                                                                     worker_num);
+        auto logger = std::make_shared<learnlog::async_logger>("spsc order", test_sink, tp);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < thread_num; t++) {
+            threads.emplace_back([&logger, t, msg_num_per_thread] {
+                for (size_t i = 0; i < msg_num_per_thread; i++) {
+                    logger->info("{} {}", t, i);
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+
+#ifdef LEARNLOG_USE_TLS
+        // 生产者线程退出后注销队列，后台线程取完剩余消息后释放
+        for (int i = 0; i < 100 && tp->producer_count() != 0; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        REQUIRE(tp->producer_count() == 0);
+#endif
+    }
+
+    // 多个后台线程时，每个生产者线程内的消息仍按提交顺序输出
+    auto msgs = test_sink->msgs();
+    REQUIRE(msgs.size() == thread_num * msg_num_per_thread);
+    std::vector<size_t> next(thread_num, 0);
+    for (auto &msg : msgs) {
+        size_t t = 0, i = 0;
+        REQUIRE(std::sscanf(msg.c_str(), "%zu %zu", &t, &i) == 2);
+        REQUIRE(i == next[t]++);
+    }
+}
+
 TEST_CASE("reset thread pool", "[async_logger]") {
     auto test_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
     // test_sink->set_sink_delay_ms(1);
@@ -107,6 +268,395 @@ TEST_CASE("reset thread pool", "[async_logger]") {
     REQUIRE(test_sink->flush_count() == 1);
 }
 
+TEST_CASE("retire logger handle", "[async_logger]") {
+    size_t msg_queue_size = 128;
+    size_t thread_num = 2;
+    size_t msg_num = msg_queue_size * 2;
+    std::vector<std::shared_ptr<learnlog::base::thread_pool>> tps{
+        std::make_shared<learnlog::base::lock_thread_pool>(msg_queue_size, thread_num),
+        std::make_shared<learnlog::base::lockfree_thread_pool>(msg_queue_size, thread_num),
+        std::make_shared<learnlog::base::lockfree_concurrent_thread_pool>(msg_queue_size, 
+                                                                          thread_num),
+        std::make_shared<learnlog::base::spsc_thread_pool>(msg_queue_size, thread_num)
+    };
+
+    for (auto &tp : tps) {
+        auto test_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
+        test_sink->set_sink_delay_ms(1);
+        auto logger = std::make_shared<learnlog::async_logger>("retire", test_sink, tp);
+        auto cloned = logger->clone("retire clone");
+        for (size_t i = 0; i < msg_num; i++) {
+            logger->info("message {}", i);
+        }
+        cloned->info("message from clone");
+        REQUIRE(tp->logger_count() == 2);
+
+        // logger 析构时等待已提交的消息处理完，再注销句柄
+        logger.reset();
+        cloned.reset();
+        REQUIRE(tp->logger_count() == 0);
+        REQUIRE(test_sink->msg_count() == msg_num + 1);
+    }
+}
+
+TEST_CASE("recycle logger handle under load", "[async_logger]") {
+    size_t msg_queue_size = 128;
+    size_t thread_num = 2;
+    size_t logger_num = 2048;
+    std::vector<std::shared_ptr<learnlog::base::thread_pool>> tps{
+        std::make_shared<learnlog::base::lock_thread_pool>(msg_queue_size, thread_num),
+        std::make_shared<learnlog::base::lockfree_thread_pool>(msg_queue_size, thread_num),
+        std::make_shared<learnlog::base::lockfree_concurrent_thread_pool>(msg_queue_size, 
+                                                                          thread_num),
+        std::make_shared<learnlog::base::spsc_thread_pool>(msg_queue_size, thread_num)
+    };
+
+    for (auto &tp : tps) {
+        auto test_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
+        auto busy_logger = std::make_shared<learnlog::async_logger>("busy", test_sink, tp);
+        std::atomic<bool> stop{false};
+        size_t busy_cnt = 0;
+        std::thread busy([&] {
+            while (!stop.load(std::memory_order_relaxed)) {
+                busy_logger->info("busy message");
+                ++busy_cnt;
+            }
+        });
+
+        // 队列一直非空时，析构的 logger 也能及时归还句柄
+        for (size_t i = 0; i < logger_num; i++) {
+            auto logger = std::make_shared<learnlog::async_logger>("short", test_sink, tp);
+            REQUIRE_NOTHROW(logger->info("short-lived message {}", i));
+        }
+        stop.store(true, std::memory_order_relaxed);
+        busy.join();
+
+        REQUIRE(tp->logger_count() == 1);
+        busy_logger.reset();
+        REQUIRE(tp->logger_count() == 0);
+        REQUIRE(test_sink->msg_count() == logger_num + busy_cnt);
+    }
+}
+
+TEST_CASE("many loggers", "[async_logger]") {
+    size_t logger_num = 3000;
+    auto test_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
+    auto tp = std::make_shared<learnlog::base::lockfree_thread_pool>(128, 2);
+    std::vector<std::shared_ptr<learnlog::async_logger>> loggers;
+    for (size_t i = 0; i < logger_num; i++) {
+        loggers.push_back(std::make_shared<learnlog::async_logger>("many", test_sink, tp));
+        loggers.back()->info("message {}", i);
+    }
+    REQUIRE(tp->logger_count() == logger_num);
+    for (auto &logger : loggers) {
+        logger->flush();
+    }
+    REQUIRE(test_sink->msg_count() == logger_num);
+    loggers.clear();
+    REQUIRE(tp->logger_count() == 0);
+}
+
+// 放行后释放持有的 logger，使其在后台线程中析构
+class releasing_sink : public learnlog::sinks::basic_sink<std::mutex> {
+public:
+    std::shared_ptr<learnlog::async_logger> held;
+    std::atomic<bool> go{false};
+
+private:
+    void output_(const learnlog::base::log_msg&) override {
+        while (!go.load()) {
+            std::this_thread::yield();
+        }
+        held.reset();
+    }
+    void flush_() override {}
+};
+
+TEST_CASE("destroy logger on worker", "[async_logger]") {
+    size_t msg_queue_size = 128;
+    size_t thread_num = 1;
+    std::vector<std::shared_ptr<learnlog::base::thread_pool>> tps{
+        std::make_shared<learnlog::base::lock_thread_pool>(msg_queue_size, thread_num),
+        std::make_shared<learnlog::base::lockfree_thread_pool>(msg_queue_size, thread_num),
+        std::make_shared<learnlog::base::lockfree_concurrent_thread_pool>(msg_queue_size, 
+                                                                          thread_num),
+        std::make_shared<learnlog::base::spsc_thread_pool>(msg_queue_size, thread_num)
+    };
+
+    for (auto &tp : tps) {
+        auto test_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
+        auto rel_sink = std::make_shared<releasing_sink>();
+        auto owner = std::make_shared<learnlog::async_logger>("owner", rel_sink, tp);
+        auto held = std::make_shared<learnlog::async_logger>("held", test_sink, tp);
+        rel_sink->held = held;
+
+        // held 的消息排在 owner 之后，析构时仍未处理完
+        owner->info("release");
+        for (size_t i = 0; i < 64; i++) {
+            held->info("message {}", i);
+        }
+        held.reset();
+        rel_sink->go.store(true);
+        owner->flush();
+        REQUIRE(tp->logger_count() == 1);
+        REQUIRE(test_sink->msg_count() < 64);
+
+        // 剩余消息处理完后句柄可以复用
+        auto reused = std::make_shared<learnlog::async_logger>("reused", test_sink, tp);
+        reused->info("reused");
+        reused->flush();
+        REQUIRE(tp->logger_count() == 2);
+    }
+}
+
+TEST_CASE("long messages", "[async_logger]") {
+    size_t msg_queue_size = 128;
+    size_t thread_num = 1;
+    size_t msg_num = msg_queue_size * 2;
+    std::vector<std::shared_ptr<learnlog::base::thread_pool>> tps{
+        std::make_shared<learnlog::base::lock_thread_pool>(msg_queue_size, thread_num),
+        std::make_shared<learnlog::base::lockfree_thread_pool>(msg_queue_size, thread_num),
+        std::make_shared<learnlog::base::lockfree_concurrent_thread_pool>(msg_queue_size, 
+                                                                          thread_num),
+        std::make_shared<learnlog::base::spsc_thread_pool>(msg_queue_size, thread_num)
+    };
+
+    for (auto &tp : tps) {
+        auto test_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
+        test_sink->set_pattern("%v");
+        auto logger = std::make_shared<learnlog::async_logger>("long", test_sink, tp);
+        // 1KB ~ 4KB 的消息超出内联缓冲区，从线程池的 payload_pool 申请内存，
+        // 分两轮提交，第二轮复用第一轮处理完归还的内存块
+        for (size_t i = 0; i < msg_num; i++) {
+            logger->info(std::string(1024 + (i % 4) * 1024, static_cast<char>('a' + i % 26)));
+            if (i == msg_num / 2) {
+                logger->flush();
+            }
+        }
+        logger->flush();
+
+        auto msgs = test_sink->msgs();
+        REQUIRE(msgs.size() == msg_num);
+        for (size_t i = 0; i < msg_num; i++) {
+            REQUIRE(msgs[i].find(std::string(1024 + (i % 4) * 1024, 
+                                             static_cast<char>('a' + i % 26))) == 0);
+        }
+        REQUIRE(tp->payload_hit_count() + tp->payload_miss_count() == msg_num);
+        REQUIRE(tp->payload_hit_count() > 0);
+    }
+}
+
+static std::vector<std::shared_ptr<learnlog::base::thread_pool>> make_all_thread_pools(
+    size_t msg_queue_size, size_t thread_num) {
+    return {
+        std::make_shared<learnlog::base::lock_thread_pool>(msg_queue_size, thread_num),
+        std::make_shared<learnlog::base::lockfree_thread_pool>(msg_queue_size, thread_num),
+        std::make_shared<learnlog::base::lockfree_concurrent_thread_pool>(msg_queue_size, 
+                                                                          thread_num),
+        std::make_shared<learnlog::base::spsc_thread_pool>(msg_queue_size, thread_num)
+    };
+}
+
+TEST_CASE("shutdown drain", "[async_logger]") {
+    size_t msg_num = 256;
+    for (auto &tp : make_all_thread_pools(128, 2)) {
+        auto test_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
+        auto logger = std::make_shared<learnlog::async_logger>("shutdown", test_sink, tp);
+        for (size_t i = 0; i < msg_num; i++) {
+            logger->info("message {}", i);
+        }
+
+        auto result = tp->shutdown(std::chrono::seconds(10));
+        REQUIRE(tp->is_shutdown());
+        REQUIRE_FALSE(result.timed_out);
+        REQUIRE(result.discarded_msgs == 0);
+        REQUIRE(result.flushed_msgs <= msg_num);
+        REQUIRE(test_sink->msg_count() == msg_num);
+        REQUIRE(test_sink->flush_count() == 1);
+
+        // 停止后提交的 log 消息被丢弃，flush 立即返回
+        logger->info("after shutdown");
+        logger->flush();
+        result = tp->shutdown(std::chrono::seconds(10));
+        REQUIRE(result.discarded_msgs == 1);
+        REQUIRE(test_sink->msg_count() == msg_num);
+    }
+}
+
+TEST_CASE("shutdown deadline", "[async_logger]") {
+    size_t msg_num = 200;
+    for (auto &tp : make_all_thread_pools(256, 1)) {
+        auto test_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
+        test_sink->set_sink_delay_ms(5);
+        auto logger = std::make_shared<learnlog::async_logger>("shutdown", test_sink, tp);
+        for (size_t i = 0; i < msg_num; i++) {
+            logger->info("message {}", i);
+        }
+
+        // 至多再输出截止时间前取走的一批消息，其余消息直接丢弃
+        auto start = std::chrono::steady_clock::now();
+        auto result = tp->shutdown(std::chrono::milliseconds(50));
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        REQUIRE(result.timed_out);
+        REQUIRE(result.discarded_msgs > 0);
+        REQUIRE(test_sink->msg_count() + result.discarded_msgs == msg_num);
+        REQUIRE(elapsed < std::chrono::milliseconds(50 + 5 * learnlog::base::default_batch_size + 200));
+    }
+}
+
+TEST_CASE("shutdown drop low levels", "[async_logger]") {
+    size_t msg_num = 200;
+    for (auto &tp : make_all_thread_pools(256, 1)) {
+        auto test_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
+        test_sink->set_pattern("%v");
+        test_sink->set_sink_delay_ms(1);
+        auto logger = std::make_shared<learnlog::async_logger>("shutdown", test_sink, tp);
+        logger->set_log_level(learnlog::level::trace);
+        for (size_t i = 0; i < msg_num; i++) {
+            if (i % 2 == 0) {
+                logger->debug("debug {}", i);
+            }
+            else {
+                logger->info("info {}", i);
+            }
+        }
+
+        auto result = tp->shutdown(std::chrono::seconds(10), 
+                                   learnlog::base::shutdown_policy::drop_low_levels);
+        REQUIRE_FALSE(result.timed_out);
+        REQUIRE(result.discarded_msgs > 0);
+        REQUIRE(test_sink->msg_count() + result.discarded_msgs == msg_num);
+
+        size_t info_cnt = 0;
+        for (auto &msg : test_sink->msgs()) {
+            if (msg.compare(0, 4, "info") == 0) { ++info_cnt; }
+        }
+        REQUIRE(info_cnt == msg_num / 2);
+    }
+}
+
+TEST_CASE("shutdown with concurrent producers", "[async_logger]") {
+    size_t thread_num = 4;
+    for (size_t worker_num = 1; worker_num <= 2; worker_num++) {
+        for (auto &tp : make_all_thread_pools(128, worker_num)) {
+            auto test_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
+            auto logger = std::make_shared<learnlog::async_logger>("shutdown", test_sink, tp);
+            std::atomic<size_t> msg_cnt{0};
+            std::vector<std::thread> threads;
+            for (size_t i = 0; i < thread_num; i++) {
+                threads.emplace_back([&logger, &tp, &msg_cnt] {
+                    for (size_t j = 1; !tp->is_shutdown(); j++) {
+                        logger->info("message {}", j);
+                        msg_cnt.fetch_add(1, std::memory_order_relaxed);
+                        if (j % 16 == 0) {
+                            logger->flush();
+                        }
+                    }
+                    logger->info("message after shutdown");
+                    msg_cnt.fetch_add(1, std::memory_order_relaxed);
+                    logger->flush();
+                });
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+            // 与 shutdown 同时提交的消息要么输出，要么计入丢弃数，flush 不会一直阻塞
+            auto result = tp->shutdown(std::chrono::seconds(10));
+            for (auto& t : threads) {
+                t.join();
+            }
+            REQUIRE_FALSE(result.timed_out);
+            auto final_result = tp->shutdown(std::chrono::seconds(10));
+            REQUIRE(test_sink->msg_count() + final_result.discarded_msgs == msg_cnt.load());
+        }
+    }
+}
+
+#ifdef __linux__
+struct worker_record {
+    std::string name;
+    std::vector<size_t> cpus;
+};
+
+// on_thread_start 在后台线程应用 worker_options 之后调用，记录线程名与绑定的 cpu
+template <typename Threadpool>
+static std::vector<worker_record> run_with_worker_options(
+    const learnlog::base::worker_options& opts, size_t thread_num) {
+    std::mutex records_mutex;
+    std::vector<worker_record> records;
+    auto on_start = [&records_mutex, &records] {
+        worker_record record;
+        char name[16] = {0};
+        pthread_getname_np(pthread_self(), name, sizeof(name));
+        record.name = name;
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        pthread_getaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+        for (size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &cpu_set)) { record.cpus.push_back(cpu); }
+        }
+        std::lock_guard<std::mutex> lock(records_mutex);
+        records.push_back(record);
+    };
+
+    auto tp = std::make_shared<Threadpool>(128, thread_num, on_start, []{}, opts);
+    auto test_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
+    auto logger = std::make_shared<learnlog::async_logger>("worker options", test_sink, tp);
+    for (size_t i = 0; i < 100; i++) {
+        logger->info("message {}", i);
+    }
+    tp->shutdown(std::chrono::seconds(5));
+    REQUIRE(test_sink->msg_count() == 100);
+    REQUIRE(tp->worker_opts().name == opts.name);
+    return records;
+}
+
+template <typename Threadpool>
+static void check_worker_options(size_t cpu) {
+    learnlog::base::worker_options opts;
+    opts.name = "tp-opts";
+    opts.cpus = {cpu};
+    opts.pin_per_worker = true;
+    size_t thread_num = 2;
+    auto records = run_with_worker_options<Threadpool>(opts, thread_num);
+
+    REQUIRE(records.size() == thread_num);
+    std::vector<std::string> names;
+    for (auto &record : records) {
+        names.push_back(record.name);
+        REQUIRE(record.cpus == std::vector<size_t>{cpu});
+    }
+    std::sort(names.begin(), names.end());
+    REQUIRE(names == std::vector<std::string>{"tp-opts-0", "tp-opts-1"});
+}
+
+TEST_CASE("worker options", "[async_logger]") {
+    // 绑定到当前线程允许运行的第一个 cpu
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    REQUIRE(pthread_getaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0);
+    size_t cpu = 0;
+    while (!CPU_ISSET(cpu, &cpu_set)) { ++cpu; }
+
+    check_worker_options<learnlog::base::lock_thread_pool>(cpu);
+    check_worker_options<learnlog::base::lockfree_thread_pool>(cpu);
+    check_worker_options<learnlog::base::lockfree_concurrent_thread_pool>(cpu);
+    check_worker_options<learnlog::base::spsc_thread_pool>(cpu);
+
+    // 线程池由 registry 创建、由 async_factory 替换时保留 worker_options
+    learnlog::base::worker_options opts;
+    opts.name = "tp-registry";
+    opts.nice = 1;
+    learnlog::initialize_thread_pool<learnlog::base::lock_thread_pool>(128, 1, opts);
+    REQUIRE(learnlog::get_thread_pool()->worker_opts().name == "tp-registry");
+    learnlog::create_async_lockfree<learnlog::sinks::test_sink_mt>("worker options factory");
+    auto tp = learnlog::get_thread_pool();
+    REQUIRE(tp->message_queue_type() == learnlog::base::lockfree);
+    REQUIRE(tp->worker_opts().name == "tp-registry");
+    REQUIRE(tp->worker_opts().nice == 1);
+    learnlog::remove_all();
+}
+#endif
+
 TEST_CASE("invalid thread pool", "[async_logger]") {
     auto test_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
     std::shared_ptr<learnlog::base::lock_thread_pool> tp;
@@ -166,6 +716,216 @@ TEST_CASE("multithreads", "[async_logger]") {
     REQUIRE(test_sink->flush_count() == thread_num * loggers.size());
 }
 
+TEST_CASE("flush barrier", "[async_logger]") {
+    size_t msg_queue_size = 128;
+    size_t worker_num = 2;
+    size_t thread_num = 4;
+    size_t msg_num_per_thread = 64;
+    size_t flush_interval = 8;
+    size_t flush_num = thread_num * msg_num_per_thread / flush_interval;
+    std::vector<std::shared_ptr<learnlog::base::thread_pool>> tps{
+        std::make_shared<learnlog::base::lock_thread_pool>(msg_queue_size, worker_num),
+        std::make_shared<learnlog::base::lockfree_thread_pool>(msg_queue_size, worker_num),
+        std::make_shared<learnlog::base::lockfree_concurrent_thread_pool>(msg_queue_size, 
+                                                                          worker_num),
+        std::make_shared<learnlog::base::spsc_thread_pool>(msg_queue_size, worker_num)
+    };
+
+    for (auto &tp : tps) {
+        auto test_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
+        auto logger = std::make_shared<learnlog::async_logger>("flush barrier", test_sink, tp);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < thread_num; i++) {
+            threads.emplace_back([&logger, msg_num_per_thread, flush_interval] {
+                for (size_t j = 1; j <= msg_num_per_thread; j++) {
+                    logger->info("message {}", j);
+                    if (j % flush_interval == 0) {
+                        logger->flush();
+                    }
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        // 多个后台线程乱序完成的 flush 也都计入连续完成的序号
+        REQUIRE(tp->completed_flush_ticket() == flush_num);
+        REQUIRE(test_sink->flush_count() == flush_num);
+        REQUIRE(test_sink->msg_count() == thread_num * msg_num_per_thread);
+    }
+}
+
+TEST_CASE("multi-producer flush barrier", "[async_logger]") {
+    size_t msg_queue_size = 128;
+    size_t thread_num = 4;
+    size_t msg_num_per_thread = 64;
+    size_t round_num = 16;
+    for (size_t worker_num = 1; worker_num <= 2; worker_num++) {
+        std::vector<std::shared_ptr<learnlog::base::thread_pool>> tps{
+            std::make_shared<learnlog::base::lock_thread_pool>(msg_queue_size, worker_num),
+            std::make_shared<learnlog::base::lockfree_thread_pool>(msg_queue_size, worker_num),
+            std::make_shared<learnlog::base::lockfree_concurrent_thread_pool>(msg_queue_size, 
+                                                                              worker_num),
+            std::make_shared<learnlog::base::spsc_thread_pool>(msg_queue_size, worker_num)
+        };
+
+        for (auto &tp : tps) {
+            auto test_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
+            auto logger = std::make_shared<learnlog::async_logger>("barrier", test_sink, tp);
+            for (size_t r = 1; r <= round_num; r++) {
+                std::vector<std::thread> threads;
+                for (size_t i = 0; i < thread_num; i++) {
+                    threads.emplace_back([&logger, msg_num_per_thread] {
+                        for (size_t j = 0; j < msg_num_per_thread; j++) {
+                            logger->info("message {}", j);
+                        }
+                    });
+                }
+                for (auto& t : threads) {
+                    t.join();
+                }
+                // 其他线程提交的消息位于不同的队列或子队列中，flush 返回前也必须全部输出
+                logger->flush();
+                REQUIRE(test_sink->msg_count() == r * thread_num * msg_num_per_thread);
+                REQUIRE(test_sink->flush_count() == r);
+            }
+        }
+    }
+}
+
+TEST_CASE("flush level on worker", "[async_logger]") {
+    size_t msg_queue_size = 128;
+    size_t thread_num = 1;
+    size_t msg_num = msg_queue_size * 2;
+    std::vector<std::shared_ptr<learnlog::base::thread_pool>> tps{
+        std::make_shared<learnlog::base::lock_thread_pool>(msg_queue_size, thread_num),
+        std::make_shared<learnlog::base::lockfree_thread_pool>(msg_queue_size, thread_num),
+        std::make_shared<learnlog::base::lockfree_concurrent_thread_pool>(msg_queue_size, 
+                                                                          thread_num),
+        std::make_shared<learnlog::base::spsc_thread_pool>(msg_queue_size, thread_num)
+    };
+
+    for (auto &tp : tps) {
+        auto test_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
+        auto logger = std::make_shared<learnlog::async_logger>("flush level", test_sink, tp);
+        logger->set_flush_level(learnlog::level::error);
+        // 后台线程达到 flush 等级时直接刷新 sink，唯一的后台线程不会等待自身
+        for (size_t i = 0; i < msg_num; i++) {
+            logger->error("message {}", i);
+        }
+        logger->flush();
+
+        REQUIRE(test_sink->msg_count() == msg_num);
+        REQUIRE(test_sink->flush_count() >= 2);
+        REQUIRE(tp->completed_flush_ticket() == 1);
+    }
+}
+
+TEST_CASE("shared formatting", "[async_logger]") {
+    size_t msg_queue_size = 128;
+    size_t thread_num = 1;
+    size_t msg_num = msg_queue_size * 2;
+    std::vector<std::shared_ptr<learnlog::base::thread_pool>> tps{
+        std::make_shared<learnlog::base::lock_thread_pool>(msg_queue_size, thread_num),
+        std::make_shared<learnlog::base::lockfree_thread_pool>(msg_queue_size, thread_num),
+        std::make_shared<learnlog::base::spsc_thread_pool>(msg_queue_size, thread_num)
+    };
+
+    for (auto &tp : tps) {
+        std::atomic<size_t> format_cnt{0};
+        auto sink1 = std::make_shared<learnlog::sinks::formatted_test_sink_mt>();
+        auto sink2 = std::make_shared<learnlog::sinks::formatted_test_sink_mt>();
+        sink2->set_level(learnlog::level::warn);
+        for (auto sink : std::vector<learnlog::sink_shr_ptr>{sink1, sink2}) {
+            sink->set_formatter(
+                learnlog::make_unique<learnlog::sinks::counting_formatter>("%^%l%$ %v", &format_cnt));
+        }
+        auto logger = std::make_shared<learnlog::async_logger>(
+            "shared formatting", learnlog::sinks_init_list{sink1, sink2}, tp);
+        logger->set_log_level(learnlog::level::trace);
+        // 整批消息格式化到同一缓冲区，颜色区间换算为相对于每条消息的位置
+        for (size_t i = 0; i < msg_num; i++) {
+            if (i % 2 == 0) { logger->info("message {}", i); }
+            else { logger->warn("message {}", i); }
+        }
+        logger->flush();
+
+        REQUIRE(format_cnt == msg_num);
+        auto msgs1 = sink1->msgs();
+        auto colored1 = sink1->colored();
+        auto msgs2 = sink2->msgs();
+        REQUIRE(msgs1.size() == msg_num);
+        REQUIRE(msgs2.size() == msg_num / 2);
+        for (size_t i = 0; i < msg_num; i++) {
+            std::string lvl = i % 2 == 0 ? "info" : "warn";
+            REQUIRE(msgs1[i] == fmt::format("{} message {}{}", lvl, i, DEFAULT_EOL));
+            REQUIRE(colored1[i] == lvl);
+            if (i % 2 == 1) {
+                REQUIRE(msgs2[i / 2] == msgs1[i]);
+            }
+        }
+    }
+}
+
+struct deferred_test_point {
+    int x;
+    int y;
+};
+
+template <>
+struct fmt::formatter<deferred_test_point> : fmt::formatter<std::string> {
+    auto format(const deferred_test_point& p, fmt::format_context& ctx) const 
+        -> decltype(ctx.out()) {
+        return fmt::format_to(ctx.out(), "({}, {})", p.x, p.y);
+    }
+};
+
+TEST_CASE("deferred_format", "[async_logger]") {
+    auto sync_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
+    auto async_sink = std::make_shared<learnlog::sinks::test_sink_mt>();
+    auto sync_logger = std::make_shared<learnlog::logger>("sync", sync_sink);
+    sync_logger->set_pattern("%v");
+
+    auto tp = std::make_shared<learnlog::base::lock_thread_pool>(128, 1);
+    auto logger = std::make_shared<learnlog::async_logger>("deferred", async_sink, tp);
+    logger->set_pattern("%v");
+    logger->set_deferred_format(true);
+    REQUIRE(logger->deferred_format());
+
+    auto log_all = [](learnlog::logger& l) {
+        int i = -42;
+        unsigned long long u = 18446744073709551615ULL;
+        double d = 3.14159;
+        char c = 'c';
+        const char* cstr = "c string";
+        const char* null_cstr = nullptr;
+        std::string str = "std string";
+        int x = 0;
+        
+        l.info("int {} uint {} double {:.3f} char {} bool {}", i, u, d, c, true);
+        l.info("cstr {} literal {} str {:>12} view {}", cstr, "literal", str, 
+               fmt::string_view("view"));
+        l.info("pointer {}", static_cast<const void*>(&x));
+        // 自定义类型在调用线程格式化
+        l.info("point {} int {}", deferred_test_point{1, 2}, i);
+        // 空指针格式化失败，消息被丢弃
+        l.info("null {}", null_cstr);
+        {
+            // 字符串参数在入队时被拷贝
+            std::string tmp(300, 'x');
+            l.info("long {} {}", tmp, tmp.size());
+            tmp.assign(300, 'y');
+        }
+    };
+    log_all(*sync_logger);
+    log_all(*logger);
+    logger->flush();
+
+    REQUIRE(async_sink->msgs() == sync_sink->msgs());
+    REQUIRE(async_sink->msg_count() == 5);
+}
+
 TEST_CASE("create_from_registry", "[interface]") {
     learnlog::remove_all();
     size_t msg_q_size = 128;
@@ -200,6 +960,10 @@ TEST_CASE("create_from_registry", "[interface]") {
         learnlog::get_logger("logger4")->sinks()[0]
     );
     REQUIRE(learnlog::get_logger("logger3") == nullptr);
+
+    learnlog::create_async_spsc<learnlog::sinks::test_sink_mt>("logger5");
+    REQUIRE(learnlog::get_logger("logger5") != nullptr);
+    REQUIRE(learnlog::get_logger("logger4") == nullptr);
 }
 
 TEST_CASE("flush_every", "[interface]") {
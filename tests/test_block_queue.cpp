@@ -81,6 +81,25 @@ TEST_CASE("rolling", "[mpmc_blocking_q]") {
     REQUIRE(q.dequeue_for(item, milliseconds(0)) == false);
 }
 
+TEST_CASE("dequeue_bulk", "[mpmc_blocking_q]") {
+    size_t q_size = 10;
+    q_type q(q_size);
+    for (int i = 0; i < 7; i++) {
+        q.enqueue(std::move(i));
+    }
+
+    int items[4] = {-1, -1, -1, -1};
+    REQUIRE(q.dequeue_bulk(items, 4) == 4);
+    for (int i = 0; i < 4; i++) {
+        REQUIRE(items[i] == i);
+    }
+    REQUIRE(q.dequeue_bulk(items, 4) == 3);
+    for (int i = 0; i < 3; i++) {
+        REQUIRE(items[i] == i + 4);
+    }
+    REQUIRE(q.size() == 0);
+}
+
 enum enqueue_mode : int {
     enqueue_if_have_room,
     enqueue,
@@ -1,5 +1,9 @@
 #include <catch2/catch_all.hpp>
 #include "base/file_base.h"
+#include "base/buffered_file.h"
+#ifndef _WIN32
+    #include "base/aio_file.h"
+#endif
 #include "file_utils.h"
 
 #ifdef _WIN32
@@ -51,4 +55,121 @@ TEST_CASE("test_reopen", "[file_base]") {
 
     learnlog::base::file_base::open(&fp, fname, true);
     REQUIRE(learnlog::base::file_base::size(fp, fname) == 0);
-}
\ No newline at end of file
+}
+
+static learnlog::base::file_buffer_options buffer_opts(size_t size, int interval_ms = 0) {
+    learnlog::base::file_buffer_options opts;
+    opts.buffer_size = size;
+    opts.flush_interval = std::chrono::milliseconds(interval_ms);
+    return opts;
+}
+
+TEST_CASE("test_buffered_file", "[file_base]") {
+    clean_test_tmp();
+
+    learnlog::filename_t fname(FILENAME);
+    learnlog::base::buffered_file file(buffer_opts(16));
+    file.open(fname, true);
+
+    // 缓冲区放得下时不写入文件
+    file.write("0123456789", 10);
+    REQUIRE(file.write_calls() == 0);
+    REQUIRE(get_filesize(FILENAME) == 0);
+    REQUIRE(file.size() == 10);
+
+    // 放不下时缓冲区与新数据一次写入
+    file.write("abcdefghij", 10);
+    REQUIRE(file.write_calls() == 1);
+    REQUIRE(file.buffered() == 0);
+    REQUIRE(file_content(FILENAME) == "0123456789abcdefghij");
+
+    file.write("xyz", 3);
+    file.flush();
+    REQUIRE(file.write_calls() == 2);
+    file.flush();
+    REQUIRE(file.write_calls() == 2);
+    REQUIRE(file_content(FILENAME) == "0123456789abcdefghijxyz");
+
+    // 关闭时写出缓冲区，重新打开时可以清空文件
+    file.write("!", 1);
+    file.close();
+    REQUIRE(get_filesize(FILENAME) == 24);
+    file.open(fname, true);
+    REQUIRE(file.size() == 0);
+
+#ifdef _WIN32
+    fname += L"/invalid";
+#else
+    fname += "/invalid";
+#endif
+    REQUIRE_THROWS_AS(file.open(fname), learnlog::learnlog_excpt);
+}
+
+TEST_CASE("test_buffered_file_interval", "[file_base]") {
+    clean_test_tmp();
+
+    learnlog::base::buffered_file file(buffer_opts(1024, 20));
+    file.open(FILENAME, true);
+    file.write("a", 1);
+    REQUIRE(file.buffered() == 1);
+
+    // 距上次写入文件超过 flush_interval 后，下一次写入时写入文件
+    learnlog::base::os::sleep_for_ms(40);
+    file.write("b", 1);
+    REQUIRE(file.buffered() == 0);
+    REQUIRE(file_content(FILENAME) == "ab");
+}
+
+#ifndef _WIN32
+void test_aio_file(bool use_io_uring) {
+    clean_test_tmp();
+
+    learnlog::base::aio_file_options opts;
+    opts.buffer_size = 16;
+    opts.buffer_count = 2;
+    opts.use_io_uring = use_io_uring;
+    learnlog::base::aio_file file(opts);
+    file.open(FILENAME, true);
+    if (!use_io_uring) {
+        REQUIRE_FALSE(file.uses_io_uring());
+    }
+
+    // 缓冲区写满前不提交
+    file.write("0123456789", 10);
+    REQUIRE(file.submit_calls() == 0);
+    REQUIRE(file.size() == 10);
+
+    // 写满的缓冲区被提交，数据跨越多个缓冲区，只有全部缓冲区在途时才等待
+    std::string expected = "0123456789";
+    for (int i = 0; i < 100; ++i) {
+        std::string line = fmt::format("line {}\n", i);
+        file.write(line.data(), line.size());
+        expected += line;
+    }
+    REQUIRE(file.size() == expected.size());
+    REQUIRE(file.submit_calls() == expected.size() / 16);
+    REQUIRE(file.in_flight() <= 2);
+
+    // flush() 只提交，drain() 等待全部写入完成
+    file.flush();
+    file.drain();
+    REQUIRE(file.in_flight() == 0);
+    REQUIRE(file_content(FILENAME) == expected);
+
+    // 重新打开时追加到文件末尾
+    file.close();
+    file.open(FILENAME);
+    REQUIRE(file.size() == expected.size());
+    std::string big(100, 'x');
+    file.write(big.data(), big.size());
+    file.close();
+    REQUIRE(file_content(FILENAME) == expected + big);
+
+    REQUIRE_THROWS_AS(file.open(std::string(FILENAME) + "/invalid"), learnlog::learnlog_excpt);
+}
+
+TEST_CASE("test_aio_file", "[file_base]") {
+    test_aio_file(true);
+    test_aio_file(false);
+}
+#endif
@@ -1,6 +1,8 @@
 #include <catch2/catch_all.hpp>
 #include "base/fmt_base.h"
 
+#include <string>
+
 using learnlog::fmt_string_view;
 using learnlog::fmt_memory_buf;
 
@@ -52,4 +54,129 @@ TEST_CASE("test_count_digits", "[fmt_base]") {
     test_count_digits<int>(1, 1);
     test_count_digits<double>(3.14, 1);
     test_count_digits<long long>(1e18 + 5, 19);
-}
\ No newline at end of file
+}
+
+// 查表实现之前的 fill_uint()，作为参照
+template <typename T>
+void reference_fill_uint(T n, size_t fill_len, fmt_memory_buf& dest_buf) {
+    using learnlog::base::fmt_base::fill_uint_;
+    using learnlog::base::fmt_base::append_int;
+    using learnlog::base::fmt_base::count_unsigned_digits;
+    switch (fill_len) {
+        case 2:
+            if (n < 100) {
+                dest_buf.push_back(static_cast<char>(n / 10 + '0'));
+                dest_buf.push_back(static_cast<char>(n % 10 + '0'));
+            }
+            else {
+                append_int(n, dest_buf);
+            }
+            break;
+        case 3:
+            if (n < 1000) {
+                dest_buf.push_back(static_cast<char>(n / 100 + '0'));
+                n = n % 100;
+                dest_buf.push_back(static_cast<char>(n / 10 + '0'));
+                dest_buf.push_back(static_cast<char>(n % 10 + '0'));
+            }
+            else {
+                append_int(n, dest_buf);
+            }
+            break;
+        default:
+            fill_uint_(n, count_unsigned_digits(n), fill_len, dest_buf);
+    }
+}
+
+// 与参照实现不一致的个数，每个 n 都检查，只在最后 REQUIRE 一次
+template <typename T>
+size_t count_fill_uint_mismatch(T begin, T end, T step, size_t fill_len) {
+    fmt_memory_buf buf;
+    fmt_memory_buf expected;
+    size_t mismatch = 0;
+    for (T n = begin; n < end; n += step) {
+        buf.clear();
+        expected.clear();
+        learnlog::base::fmt_base::fill_uint(n, fill_len, buf);
+        reference_fill_uint(n, fill_len, expected);
+        if (fmt_string_view(buf.data(), buf.size()) != fmt_string_view(expected.data(), expected.size())) {
+            ++mismatch;
+        }
+    }
+    return mismatch;
+}
+
+TEST_CASE("test_fill_uint_table", "[fmt_base]") {
+    // 2、3、4 位覆盖 [0, 10^(len+1))，6 位覆盖 [0, 2 * 10^6)，包括超出位数的情况
+    REQUIRE(count_fill_uint_mismatch<unsigned>(0, 1000, 1, 2) == 0);
+    REQUIRE(count_fill_uint_mismatch<unsigned>(0, 10000, 1, 3) == 0);
+    REQUIRE(count_fill_uint_mismatch<unsigned>(0, 100000, 1, 4) == 0);
+    REQUIRE(count_fill_uint_mismatch<unsigned>(0, 2000000, 1, 6) == 0);
+    // 9 位以素数步长遍历，并覆盖两端与 10^9 附近
+    REQUIRE(count_fill_uint_mismatch<uint64_t>(0, 10000000000ULL, 9973, 9) == 0);
+    REQUIRE(count_fill_uint_mismatch<uint64_t>(0, 100000, 1, 9) == 0);
+    REQUIRE(count_fill_uint_mismatch<uint64_t>(999900000, 1000100000, 1, 9) == 0);
+    // 其他长度与类型
+    REQUIRE(count_fill_uint_mismatch<size_t>(0, 100000, 1, 5) == 0);
+    REQUIRE(count_fill_uint_mismatch<int>(0, 100000, 1, 4) == 0);
+    REQUIRE(count_fill_uint_mismatch<uint64_t>(0, 18000000000000000000ULL, 999999999999999ULL, 9) == 0);
+
+    // 负数直接写入
+    test_fill_uint<int>(-1, 2, "-1");
+    test_fill_uint<int>(-12, 3, "-12");
+    test_fill_uint<long>(-123, 6, "-123");
+}
+
+TEST_CASE("test_write_fixed", "[fmt_base]") {
+    using namespace learnlog::base::fmt_base;
+    char out[9];
+    size_t mismatch = 0;
+    for (uint32_t n = 0; n < 1000000; ++n) {
+        write_fixed<6>(n, out);
+        mismatch += std::string(out, 6) != fmt::format("{:06}", n);
+        if (n < 10000) {
+            write_fixed<4>(n, out);
+            mismatch += std::string(out, 4) != fmt::format("{:04}", n);
+        }
+        if (n < 1000) {
+            write_fixed<3>(n, out);
+            mismatch += std::string(out, 3) != fmt::format("{:03}", n);
+        }
+        if (n < 100) {
+            write_fixed<2>(n, out);
+            mismatch += std::string(out, 2) != fmt::format("{:02}", n);
+        }
+    }
+    for (uint32_t n = 0; n < 1000000000; n += 9973) {
+        write_fixed<9>(n, out);
+        mismatch += std::string(out, 9) != fmt::format("{:09}", n);
+    }
+    write_fixed<9>(999999999, out);
+    mismatch += std::string(out, 9) != "999999999";
+    REQUIRE(mismatch == 0);
+}
+
+TEST_CASE("test_write_hms", "[fmt_base]") {
+    using namespace learnlog::base::fmt_base;
+    char out[18];
+    size_t mismatch = 0;
+    for (uint32_t h = 0; h < 24; ++h) {
+        for (uint32_t m = 0; m < 60; ++m) {
+            for (uint32_t sec = 0; sec < 61; ++sec) {
+                uint32_t frac = (h * 3600 + m * 60 + sec) * 11;
+                mismatch += write_hms<0>(h, m, sec, 0, out) != 8;
+                mismatch += std::string(out, 8) != fmt::format("{:02}:{:02}:{:02}", h, m, sec);
+                mismatch += write_hms<3>(h, m, sec, frac % 1000, out) != 12;
+                mismatch += std::string(out, 12) !=
+                            fmt::format("{:02}:{:02}:{:02}.{:03}", h, m, sec, frac % 1000);
+                mismatch += write_hms<6>(h, m, sec, frac, out) != 15;
+                mismatch += std::string(out, 15) !=
+                            fmt::format("{:02}:{:02}:{:02}.{:06}", h, m, sec, frac);
+                mismatch += write_hms<9>(h, m, sec, frac * 1000 + 999, out) != 18;
+                mismatch += std::string(out, 18) !=
+                            fmt::format("{:02}:{:02}:{:02}.{:09}", h, m, sec, frac * 1000 + 999);
+            }
+        }
+    }
+    REQUIRE(mismatch == 0);
+}
@@ -0,0 +1,198 @@
+#include <catch2/catch_all.hpp>
+
+// 编译期只保留 info 及以上级别的宏
+#define LEARNLOG_ACTIVE_LEVEL LEARNLOG_LEVEL_INFO
+
+#include "learnlog.h"
+#include "test_sink.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define LOGGER_NAME "test_macros_logger"
+
+// 文件名截取在编译期完成
+static_assert(learnlog::base::basename_pos("a/b/c.cpp", 0, 9) == 4, "unix path");
+static_assert(learnlog::base::basename_pos("C:\\src\\c.cpp", 0, 12) == 7, "windows path");
+static_assert(learnlog::base::basename_pos("c.cpp", 0, 5) == 0, "no directory");
+static_assert(learnlog::base::basename_pos("", 0, 0) == 0, "empty path");
+static_assert(learnlog::base::basename_pos("dir/", 0, 4) == 4, "trailing separator");
+
+#define LONG_DIR "0123456789012345678901234567890123456789012345678901234567890123456789/"
+#define LONG_PATH LONG_DIR LONG_DIR LONG_DIR LONG_DIR LONG_DIR LONG_DIR LONG_DIR LONG_DIR \
+                  LONG_DIR LONG_DIR "long.cpp"
+static_assert(learnlog::base::basename_pos(LONG_PATH, 0, sizeof(LONG_PATH) - 1) ==
+              sizeof(LONG_PATH) - 1 - 8, "long path");
+
+TEST_CASE("source_loc_macro", "[macros]") {
+    int line = __LINE__ + 1;
+    learnlog::source_loc loc = LEARNLOG_SOURCE_LOC;
+    REQUIRE(std::string(loc.filename) == "test_macros.cpp");
+    REQUIRE(loc.filename_len == std::string("test_macros.cpp").size());
+    REQUIRE(loc.filename_view() == learnlog::fmt_string_view("test_macros.cpp"));
+    REQUIRE(loc.line == line);
+    REQUIRE(loc.funcname != nullptr);
+
+    // 未给出长度时由 filename_view() 计算
+    learnlog::source_loc plain("dir/plain.cpp", 1, "f");
+    REQUIRE(plain.filename_view() == learnlog::fmt_string_view("dir/plain.cpp"));
+    REQUIRE(learnlog::source_loc{}.filename_view().size() == 0);
+}
+
+TEST_CASE("level_macros", "[macros]") {
+    learnlog::remove_all();
+
+    auto sink = std::make_shared<learnlog::sinks::test_sink_st>();
+    sink->set_pattern("%A:%B [%l] %v");
+    auto logger = std::make_shared<learnlog::logger>(LOGGER_NAME, sink);
+    logger->set_log_level(learnlog::level::trace);
+    learnlog::set_default_logger(logger);
+
+    // 低于 LEARNLOG_ACTIVE_LEVEL 的宏不会求值参数
+    int evaluated = 0;
+    LEARNLOG_TRACE("trace {}", ++evaluated);
+    LEARNLOG_DEBUG("debug {}", ++evaluated);
+    LEARNLOG_LOGGER_DEBUG(logger, "debug {}", ++evaluated);
+    REQUIRE(evaluated == 0);
+    REQUIRE(sink->msg_count() == 0);
+
+    int line = __LINE__ + 1;
+    LEARNLOG_INFO("info {}", ++evaluated);
+    LEARNLOG_WARN("warn");
+    LEARNLOG_LOGGER_ERROR(logger, "error {} {}", 1, 2);
+    LEARNLOG_CRITICAL(std::string("critical"));
+    REQUIRE(evaluated == 1);
+
+    auto msgs = sink->msgs();
+    REQUIRE(msgs.size() == 4);
+    REQUIRE(msgs[0] == "test_macros.cpp:" + std::to_string(line) + " [info] info 1" DEFAULT_EOL);
+    REQUIRE(msgs[1] == "test_macros.cpp:" + std::to_string(line + 1) + " [warn] warn" DEFAULT_EOL);
+    REQUIRE(msgs[2] == "test_macros.cpp:" + std::to_string(line + 2) + " [error] error 1 2" DEFAULT_EOL);
+    REQUIRE(msgs[3] == "test_macros.cpp:" + std::to_string(line + 3) + " [critical] critical" DEFAULT_EOL);
+
+    learnlog::remove_all();
+}
+
+static std::shared_ptr<learnlog::sinks::test_sink_mt> sampled_test_logger(learnlog::logger_shr_ptr& logger) {
+    learnlog::remove_all();
+    auto sink = std::make_shared<learnlog::sinks::test_sink_mt>();
+    sink->set_pattern("[%l] %v");
+    logger = std::make_shared<learnlog::logger>(LOGGER_NAME, sink);
+    logger->set_log_level(learnlog::level::trace);
+    learnlog::set_default_logger(logger);
+    return sink;
+}
+
+TEST_CASE("every_n_macros", "[macros]") {
+    learnlog::logger_shr_ptr logger;
+    auto sink = sampled_test_logger(logger);
+
+    int evaluated = 0;
+    for (int i = 1; i <= 10; ++i) {
+        LEARNLOG_EVERY_N(learnlog::level::error, 3, "call {} {}", i, ++evaluated);
+    }
+    // 被抑制的调用不求值参数
+    REQUIRE(evaluated == 4);
+    auto msgs = sink->msgs();
+    REQUIRE(msgs.size() == 4);
+    REQUIRE(msgs[0] == "[error] call 1 1" DEFAULT_EOL);
+    REQUIRE(msgs[1] == "[error] call 4 2 (suppressed 2 times)" DEFAULT_EOL);
+    REQUIRE(msgs[3] == "[error] call 10 4 (suppressed 2 times)" DEFAULT_EOL);
+
+    // 每个调用位置的计数相互独立；低于 LEARNLOG_ACTIVE_LEVEL 时不输出
+    for (int i = 0; i < 4; ++i) {
+        LEARNLOG_LOGGER_EVERY_N(logger, learnlog::level::warn, 2, i);
+        LEARNLOG_EVERY_N(learnlog::level::debug, 1, "debug {}", ++evaluated);
+    }
+    msgs = sink->msgs();
+    REQUIRE(msgs.size() == 6);
+    REQUIRE(msgs[4] == "[warn] 0" DEFAULT_EOL);
+    REQUIRE(msgs[5] == "[warn] 2 (suppressed 1 times)" DEFAULT_EOL);
+    REQUIRE(evaluated == 4);
+
+    learnlog::remove_all();
+}
+
+TEST_CASE("once_macros", "[macros]") {
+    learnlog::logger_shr_ptr logger;
+    auto sink = sampled_test_logger(logger);
+
+    for (int i = 0; i < 5; ++i) {
+        LEARNLOG_ONCE(learnlog::level::warn, "once {}", i);
+        LEARNLOG_LOGGER_ONCE(logger, learnlog::level::info, std::string("logger once"));
+    }
+    auto msgs = sink->msgs();
+    REQUIRE(msgs.size() == 2);
+    REQUIRE(msgs[0] == "[warn] once 0" DEFAULT_EOL);
+    REQUIRE(msgs[1] == "[info] logger once" DEFAULT_EOL);
+
+    learnlog::remove_all();
+}
+
+TEST_CASE("every_ms_macros", "[macros]") {
+    learnlog::logger_shr_ptr logger;
+    auto sink = sampled_test_logger(logger);
+
+    for (int round = 0; round < 2; ++round) {
+        for (int i = 0; i < 3; ++i) {
+            LEARNLOG_EVERY_MS(learnlog::level::error, 50, "round {} call {}", round, i);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    }
+    auto msgs = sink->msgs();
+    REQUIRE(msgs.size() == 2);
+    REQUIRE(msgs[0] == "[error] round 0 call 0" DEFAULT_EOL);
+    REQUIRE(msgs[1] == "[error] round 1 call 0 (suppressed 2 times)" DEFAULT_EOL);
+
+    learnlog::remove_all();
+}
+
+TEST_CASE("rate_limit_macros", "[macros]") {
+    learnlog::logger_shr_ptr logger;
+    auto sink = sampled_test_logger(logger);
+
+    // 突发 3 条之后，每秒 1 条的速率在短时间内不再放行
+    for (int i = 0; i < 10; ++i) {
+        LEARNLOG_LOGGER_RATE_LIMIT(logger, learnlog::level::error, 1, 3, "burst {}", i);
+    }
+    auto msgs = sink->msgs();
+    REQUIRE(msgs.size() == 3);
+    REQUIRE(msgs[2] == "[error] burst 2" DEFAULT_EOL);
+
+    // 速率足够高时，等待后补充令牌，并报告被抑制的次数
+    for (int round = 0; round < 2; ++round) {
+        for (int i = 0; i < 5; ++i) {
+            LEARNLOG_RATE_LIMIT(learnlog::level::warn, 20, 1, "round {} call {}", round, i);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    }
+    msgs = sink->msgs();
+    REQUIRE(msgs.size() == 5);
+    REQUIRE(msgs[3] == "[warn] round 0 call 0" DEFAULT_EOL);
+    REQUIRE(msgs[4] == "[warn] round 1 call 0 (suppressed 4 times)" DEFAULT_EOL);
+
+    learnlog::remove_all();
+}
+
+TEST_CASE("every_n_macros_mt", "[macros]") {
+    learnlog::logger_shr_ptr logger;
+    auto sink = sampled_test_logger(logger);
+
+    // 多线程同时调用时放行的次数仍然精确
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&logger]() {
+            for (int i = 0; i < 1000; ++i) {
+                LEARNLOG_LOGGER_EVERY_N(logger, learnlog::level::info, 100, "mt {}", i);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    REQUIRE(sink->msg_count() == 40);
+
+    learnlog::remove_all();
+}
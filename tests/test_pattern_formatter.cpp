@@ -1,9 +1,14 @@
 #include <catch2/catch_all.hpp>
 #include "definitions.h"
 #include "sinks/formatters/pattern_formatter.h"
+#include "sinks/formatters/static_pattern_formatter.h"
+#include "sinks/formatters/json_formatter.h"
 
 #include <string>
 #include <iostream>
+#include <vector>
+#include <random>
+#include <algorithm>
 
 using namespace learnlog;
 using namespace sinks;
@@ -102,6 +107,442 @@ TEST_CASE("clone_custom_formatter", "[pattern_formatter]") {
     REQUIRE(fmt_string_view(buf1.data(), buf1.size()) == fmt_string_view(buf2.data(), buf2.size()));
 }
 
+// 逐个 flag_formatter 派生类格式化的结果，作为编译后指令的对照
+static std::unique_ptr<flag_formatter> make_flag_formatter(char flag, const spaces_info& sp_info) {
+    switch (flag) {
+        case '+': return learnlog::make_unique<full_formatter>(sp_info);
+        case 'n': return learnlog::make_unique<name_formatter>(sp_info);
+        case 'l': return learnlog::make_unique<level_formatter>(sp_info);
+        case 'a': return learnlog::make_unique<a_formatter>(sp_info);
+        case 'b': return learnlog::make_unique<b_formatter>(sp_info);
+        case 'c': return learnlog::make_unique<c_formatter>(sp_info);
+        case 'y': return learnlog::make_unique<y_formatter>(sp_info);
+        case 'm': return learnlog::make_unique<m_formatter>(sp_info);
+        case 'd': return learnlog::make_unique<d_formatter>(sp_info);
+        case 'H': return learnlog::make_unique<H_formatter>(sp_info);
+        case 'M': return learnlog::make_unique<M_formatter>(sp_info);
+        case 'S': return learnlog::make_unique<S_formatter>(sp_info);
+        case 'E': return learnlog::make_unique<E_formatter>(sp_info);
+        case 'F': return learnlog::make_unique<F_formatter>(sp_info);
+        case 'G': return learnlog::make_unique<G_formatter>(sp_info);
+        case 'T': return learnlog::make_unique<T_formatter>(sp_info);
+        case 'W': return learnlog::make_unique<duration_formatter<nanoseconds> >(sp_info);
+        case 'X': return learnlog::make_unique<duration_formatter<microseconds> >(sp_info);
+        case 'Y': return learnlog::make_unique<duration_formatter<milliseconds> >(sp_info);
+        case 'Z': return learnlog::make_unique<duration_formatter<seconds> >(sp_info);
+        case 'p': return learnlog::make_unique<p_formatter>(sp_info);
+        case 't': return learnlog::make_unique<t_formatter>(sp_info);
+        case 'v': return learnlog::make_unique<v_formatter>(sp_info);
+        case '^': return learnlog::make_unique<color_start_formatter>(sp_info);
+        case '$': return learnlog::make_unique<color_end_formatter>(sp_info);
+        case '@': return learnlog::make_unique<source_loc_formatter>(sp_info);
+        case 'A': return learnlog::make_unique<source_filename_formatter>(sp_info);
+        case 'B': return learnlog::make_unique<source_linenum_formatter>(sp_info);
+        case 'C': return learnlog::make_unique<source_funcname_formatter>(sp_info);
+        default: return nullptr;
+    }
+}
+
+TEST_CASE("compiled_program", "[pattern_formatter]") {
+    const std::string flags = "+nlabcymdHMSEFGTWXYZptv^$@ABC";
+    const std::vector<std::pair<std::string, spaces_info> > spaces{
+        {"", spaces_info{}},
+        {"12", spaces_info{12, spaces_info::fill_side::left, false}},
+        {"-12", spaces_info{12, spaces_info::fill_side::right, false}},
+        {"=13", spaces_info{13, spaces_info::fill_side::center, false}},
+        {"2!", spaces_info{2, spaces_info::fill_side::left, true}},
+        {"-2!", spaces_info{2, spaces_info::fill_side::right, true}},
+        {"=3!", spaces_info{3, spaces_info::fill_side::center, true}}
+    };
+    // 消息时间早于格式化器的创建时间，时间间隔均为 0
+    auto msg_time = sys_clock::now() - std::chrono::hours(30);
+    std::vector<source_loc> locs{source_loc("learnlog.cpp", 123, "helloworld"), source_loc{}};
+
+    for (auto &loc : locs) {
+        for (char flag : flags) {
+            for (auto &sp : spaces) {
+                std::string pattern = std::string("[%") + sp.first + flag + "] %%x";
+                pattern_formatter compiled(pattern);
+                auto legacy = make_flag_formatter(flag, sp.second);
+
+                base::log_msg msg1(msg_time, loc, level::level_enum::warn, "message", "test_logger");
+                base::log_msg msg2(msg_time, loc, level::level_enum::warn, "message", "test_logger");
+                fmt_memory_buf buf1;
+                compiled.format(msg1, buf1);
+
+                fmt_memory_buf buf2;
+                std::tm msg_tm = base::os::time_point_to_tm(msg2.time);
+                buf2.push_back('[');
+                legacy->format(msg2, msg_tm, buf2);
+                base::fmt_base::append_string_view("] %x", buf2);
+                base::fmt_base::append_string_view(DEFAULT_EOL, buf2);
+
+                INFO("pattern: " << pattern);
+                REQUIRE(std::string(buf1.data(), buf1.size()) == std::string(buf2.data(), buf2.size()));
+                REQUIRE(msg1.color_index_start == msg2.color_index_start);
+                REQUIRE(msg1.color_index_end == msg2.color_index_end);
+            }
+        }
+    }
+}
+
+TEST_CASE("literal_runs", "[pattern_formatter]") {
+    // '%%'、未知格式字符、末尾单独的 '%' 都按原样处理
+    REQUIRE(get_format_str("hello", "100%% [%q] %5k %v%", "") == "100% [%q] %k hello");
+    REQUIRE(get_format_str("hello", "%v %-", "|") == "hello |");
+
+    // 自定义格式字符覆盖预设格式字符，并保留空格填充信息
+    pattern_formatter p("");
+    p.add_custom_flag<custom_formatter_test>('v');
+    p.set_pattern("[%-8v][%v]");
+    base::log_msg msg(level::level_enum::info, "hello world", "test_logger");
+    fmt_memory_buf buf;
+    p.format(msg, buf);
+    REQUIRE(std::string(buf.data(), buf.size()) == "[hello   ][hello]" + std::string(DEFAULT_EOL));
+}
+
+LEARNLOG_STATIC_PATTERN(static_pattern_default, "[%y-%m-%d %T.%E] [%n] [%^%l%$] %v");
+LEARNLOG_STATIC_PATTERN(static_pattern_full, "%+");
+LEARNLOG_STATIC_PATTERN(static_pattern_time, "%c | %a %b | %H:%M:%S.%F.%G | %p %t | %@ %A:%B %C");
+LEARNLOG_STATIC_PATTERN(static_pattern_spaces, "[%-8l] [%=12n] [%5!v] [%10T] [%-3!A] %% %q %5k %X %W%");
+LEARNLOG_STATIC_PATTERN(static_pattern_tail, "100%% %v %=");
+LEARNLOG_STATIC_PATTERN(static_pattern_literal, "no flags at all");
+LEARNLOG_STATIC_PATTERN(static_pattern_empty, "");
+LEARNLOG_STATIC_PATTERN(static_pattern_iso, "%I | %J | %K | %L | %z | [%-32J] [%3!z]");
+LEARNLOG_STATIC_PATTERN(static_pattern_after_elapsed, "%X %Y [%n] %v");
+
+// 同一格式模板的 static_pattern_formatter 与 pattern_formatter 输出逐字节一致
+template <typename Pattern>
+static void check_static_pattern(const std::string& eol) {
+    auto msg_time = sys_clock::now() - std::chrono::hours(30);
+    std::vector<source_loc> locs{source_loc("learnlog.cpp", 123, "helloworld"), source_loc{}};
+    pattern_formatter dynamic_formatter(Pattern::value(), eol);
+    static_pattern_formatter<Pattern> static_formatter(eol);
+    auto static_clone = static_formatter.clone();
+
+    for (auto &loc : locs) {
+        base::log_msg msg1(msg_time, loc, level::level_enum::error, "message", "test_logger");
+        base::log_msg msg2(msg_time, loc, level::level_enum::error, "message", "test_logger");
+        base::log_msg msg3(msg_time, loc, level::level_enum::error, "message", "test_logger");
+        fmt_memory_buf buf1;
+        fmt_memory_buf buf2;
+        fmt_memory_buf buf3;
+        dynamic_formatter.format(msg1, buf1);
+        static_formatter.format(msg2, buf2);
+        static_clone->format(msg3, buf3);
+
+        INFO("pattern: " << Pattern::value());
+        REQUIRE(std::string(buf1.data(), buf1.size()) == std::string(buf2.data(), buf2.size()));
+        REQUIRE(std::string(buf1.data(), buf1.size()) == std::string(buf3.data(), buf3.size()));
+        REQUIRE(msg1.color_index_start == msg2.color_index_start);
+        REQUIRE(msg1.color_index_end == msg2.color_index_end);
+    }
+}
+
+TEST_CASE("static_pattern_formatter", "[pattern_formatter]") {
+    check_static_pattern<static_pattern_default>(DEFAULT_EOL);
+    check_static_pattern<static_pattern_full>(DEFAULT_EOL);
+    check_static_pattern<static_pattern_time>("\r\n");
+    check_static_pattern<static_pattern_spaces>(DEFAULT_EOL);
+    check_static_pattern<static_pattern_tail>("");
+    check_static_pattern<static_pattern_literal>(DEFAULT_EOL);
+    check_static_pattern<static_pattern_empty>(DEFAULT_EOL);
+    check_static_pattern<static_pattern_iso>(DEFAULT_EOL);
+    check_static_pattern<static_pattern_after_elapsed>(DEFAULT_EOL);
+
+    REQUIRE(std::string(static_pattern_formatter<static_pattern_full>::pattern()) == "%+");
+}
+
+// 时间在不同秒之间前后跳动，两个格式化器交替格式化，共用的缓存每次都要得到正确的日期时间
+TEST_CASE("time_cache", "[pattern_formatter]") {
+    pattern_formatter f1("%y-%m-%d %T.%E|%c", "");
+    pattern_formatter f2("%+", "");
+    sys_clock::time_point now = sys_clock::now();
+    std::vector<sys_clock::time_point> tps{
+        now, now + milliseconds(1), now + seconds(1), now - seconds(1),
+        now + std::chrono::hours(24 * 40), now, now - std::chrono::hours(24 * 400)
+    };
+
+    for (auto &tp : tps) {
+        base::log_msg msg(tp, source_loc{}, level::info, "message", "");
+        std::tm tm = base::os::time_point_to_tm(tp);
+        char expected_dt[64];
+        std::strftime(expected_dt, sizeof(expected_dt), "%Y-%m-%d %H:%M:%S", &tm);
+        char expected_c_tail[64];
+        std::strftime(expected_c_tail, sizeof(expected_c_tail), "%d %H:%M:%S %Y", &tm);
+        std::string expected_c = fmt::format("{} {} {}", weekday_name[static_cast<size_t>(tm.tm_wday)],
+                                             month_name[static_cast<size_t>(tm.tm_mon)], expected_c_tail);
+        auto ms = base::fmt_base::precise_time<milliseconds>(tp).count();
+
+        fmt_memory_buf buf1;
+        fmt_memory_buf buf2;
+        f1.format(msg, buf1);
+        f2.format(msg, buf2);
+        REQUIRE(std::string(buf1.data(), buf1.size()) ==
+                fmt::format("{}.{:03}|{}", expected_dt, ms, expected_c));
+        REQUIRE(std::string(buf2.data(), buf2.size()) ==
+                fmt::format("[{}.{:03}] [info] message", expected_dt, ms));
+
+        time_cache cache;
+        const cached_time& ct = cache.get(tp);
+        REQUIRE(ct.tm.tm_sec == tm.tm_sec);
+        REQUIRE(std::string(ct.datetime_view().data(), ct.datetime_view().size()) == expected_dt);
+#ifndef _WIN32
+        REQUIRE(ct.utc_offset == tm.tm_gmtoff);
+#endif
+    }
+}
+
+// 标准的逐字节转义，作为各指令集的参照
+std::string reference_json_escape(const std::string& str) {
+    std::string result;
+    for (char ch : str) {
+        unsigned char uch = static_cast<unsigned char>(ch);
+        switch (ch) {
+            case '"': result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\b': result += "\\b"; break;
+            case '\f': result += "\\f"; break;
+            case '\n': result += "\\n"; break;
+            case '\r': result += "\\r"; break;
+            case '\t': result += "\\t"; break;
+            default:
+                if (uch < 0x20) {
+                    result += fmt::format("\\u{:04x}", uch);
+                }
+                else {
+                    result += ch;
+                }
+        }
+    }
+    return result;
+}
+
+std::string json_escape_str(const std::string& str, json_escape_isa isa) {
+    fmt_memory_buf buf;
+    escape_json(str, buf, isa);
+    return std::string(buf.data(), buf.size());
+}
+
+// 每个字节值出现在 16 / 32 字节块的各个位置，以及块边界附近的长度
+TEST_CASE("json_escape", "[json_formatter]") {
+    const json_escape_isa isas[] = {json_escape_isa::scalar, json_escape_isa::sse2,
+                                    json_escape_isa::avx2};
+    const size_t lens[] = {0, 1, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100};
+    for (json_escape_isa isa : isas) {
+        for (int byte = 0; byte < 256; ++byte) {
+            for (size_t len : lens) {
+                for (size_t pos = 0; pos < len; ++pos) {
+                    std::string str(len, 'a');
+                    str[pos] = static_cast<char>(byte);
+                    REQUIRE(json_escape_str(str, isa) == reference_json_escape(str));
+                }
+            }
+        }
+
+        std::mt19937 rng(12345);
+        const char alphabet[] = "abc \"\\\n\t\x01\x1f\x7f\x80\xe4\xb8\xad";
+        for (int i = 0; i < 2000; ++i) {
+            std::string str(static_cast<size_t>(rng() % 200), ' ');
+            for (char &ch : str) {
+                ch = alphabet[rng() % (sizeof(alphabet) - 1)];
+            }
+            REQUIRE(json_escape_str(str, isa) == reference_json_escape(str));
+        }
+    }
+    REQUIRE(json_escape_str("", best_json_escape_isa()).empty());
+}
+
+TEST_CASE("json_formatter", "[json_formatter]") {
+    json_formatter f;
+    sys_clock::time_point tp = sys_clock::now();
+    source_loc loc("dir/main.cpp", 12, "main");
+    base::log_msg msg(tp, loc, level::warn, "say \"hi\"\n", "json\\logger");
+
+    std::tm tm = base::os::time_point_to_tm(tp);
+    char expected_dt[64];
+    std::strftime(expected_dt, sizeof(expected_dt), "%Y-%m-%dT%H:%M:%S", &tm);
+    auto us = base::fmt_base::precise_time<microseconds>(tp).count();
+    time_cache cache;
+    long offset = cache.get(tp).utc_offset;
+    std::string expected_time = fmt::format("{}.{:06}{}{:02}:{:02}", expected_dt, us,
+                                            offset < 0 ? '-' : '+',
+                                            std::labs(offset) / 3600, std::labs(offset) % 3600 / 60);
+
+    fmt_memory_buf buf;
+    f.format(msg, buf);
+    std::string expected = fmt::format(
+        "{{\"time\":\"{}\",\"level\":\"warn\",\"logger\":\"json\\\\logger\",\"tid\":{},"
+        "\"file\":\"dir/main.cpp\",\"line\":12,\"func\":\"main\","
+        "\"message\":\"say \\\"hi\\\"\\n\"}}\n", expected_time, msg.tid);
+    REQUIRE(std::string(buf.data(), buf.size()) == expected);
+    REQUIRE(std::string(buf.data() + msg.color_index_start,
+                        msg.color_index_end - msg.color_index_start) == "warn");
+
+    // 没有发生位置时省略 file / line / func
+    base::log_msg no_loc(tp, source_loc{}, level::info, "m", "");
+    buf.clear();
+    f.format(no_loc, buf);
+    REQUIRE(std::string(buf.data(), buf.size()) ==
+            fmt::format("{{\"time\":\"{}\",\"level\":\"info\",\"logger\":\"\",\"tid\":{},"
+                        "\"message\":\"m\"}}\n", expected_time, no_loc.tid));
+
+    // clone 与各指令集输出一致，指纹只与 eol 有关
+    auto cloned = f.clone();
+    json_formatter scalar("\n", json_escape_isa::scalar);
+    fmt_memory_buf cloned_buf;
+    fmt_memory_buf scalar_buf;
+    cloned->format(msg, cloned_buf);
+    scalar.format(msg, scalar_buf);
+    buf.clear();
+    f.format(msg, buf);
+    REQUIRE(std::string(cloned_buf.data(), cloned_buf.size()) == std::string(buf.data(), buf.size()));
+    REQUIRE(std::string(scalar_buf.data(), scalar_buf.size()) == std::string(buf.data(), buf.size()));
+    REQUIRE(f.fingerprint() != 0);
+    REQUIRE(f.fingerprint() == cloned->fingerprint());
+    REQUIRE(f.fingerprint() == scalar.fingerprint());
+    REQUIRE(f.fingerprint() != json_formatter("\r\n").fingerprint());
+    REQUIRE(f.fingerprint() != pattern_formatter("%+", "\n").fingerprint());
+}
+
+std::tm reference_gmtime(std::time_t t) {
+    std::tm tm{};
+#ifdef _WIN32
+    ::gmtime_s(&tm, &t);
+#else
+    ::gmtime_r(&t, &tm);
+#endif
+    return tm;
+}
+
+// 与 gmtime_r() 对比，覆盖闰年、世纪年与 1970 年之前
+TEST_CASE("civil_from_days", "[time_zone]") {
+    auto same_tm = [](const std::tm& a, const std::tm& b) {
+        return a.tm_year == b.tm_year && a.tm_mon == b.tm_mon && a.tm_mday == b.tm_mday &&
+               a.tm_hour == b.tm_hour && a.tm_min == b.tm_min && a.tm_sec == b.tm_sec &&
+               a.tm_wday == b.tm_wday && a.tm_yday == b.tm_yday;
+    };
+#ifdef _WIN32
+    const long long first = 0;
+#else
+    const long long first = -4000000000LL;       // 1843 年
+#endif
+    const long long last = 13000000000LL;         // 2381 年
+    size_t mismatch = 0;
+    for (long long t = first; t < last; t += 86400 * 3 + 3607) {
+        std::time_t tt = static_cast<std::time_t>(t);
+        mismatch += !same_tm(base::os::time_t_to_tm_offset(tt, 0), reference_gmtime(tt));
+    }
+    REQUIRE(mismatch == 0);
+
+    // 逐小时覆盖 2000 年（闰年）与 2100 年（非闰年）前后
+    const long long ranges[][2] = {{915148800LL, 1009843200LL}, {4070908800LL, 4165516800LL}};
+    for (auto &range : ranges) {
+        for (long long t = range[0]; t < range[1]; t += 3599) {
+            std::time_t tt = static_cast<std::time_t>(t);
+            mismatch += !same_tm(base::os::time_t_to_tm_offset(tt, 0), reference_gmtime(tt));
+        }
+    }
+    REQUIRE(mismatch == 0);
+
+    // 固定偏移等同于平移后的 UTC
+    const long offsets[] = {-43200, -12600, -3600, 0, 3600, 19800, 28800, 50400};
+    for (long offset : offsets) {
+        for (long long t = 0; t < 4000000000LL; t += 86400 * 17 + 1234) {
+            std::time_t tt = static_cast<std::time_t>(t);
+            mismatch += !same_tm(base::os::time_t_to_tm_offset(tt, offset), reference_gmtime(tt + offset));
+        }
+    }
+    REQUIRE(mismatch == 0);
+}
+
+// UTC 与固定偏移不经过 localtime_r()，%I/%J/%K/%L/%z 按 RFC 3339 输出
+TEST_CASE("time_zone", "[time_zone]") {
+    const std::string pattern = "%y-%m-%d %T|%I|%J|%K|%L|%z";
+    sys_clock::time_point tp = sys_clock::now();
+    std::time_t tt = sys_clock::to_time_t(tp);
+    auto ns = base::fmt_base::precise_time<nanoseconds>(tp).count();
+
+    struct zone_case {
+        time_zone zone;
+        long offset;
+        std::string offset_str;
+    };
+    std::vector<zone_case> cases{
+        {time_zone::utc(), 0, "Z"},
+        {time_zone::fixed(19800), 19800, "+05:30"},
+        {time_zone::fixed(-3600), -3600, "-01:00"},
+        {time_zone::fixed(0), 0, "+00:00"}
+    };
+    std::vector<size_t> fingerprints;
+    for (auto &zcase : cases) {
+        std::tm tm = reference_gmtime(tt + zcase.offset);
+        char dt[32];
+        std::strftime(dt, sizeof(dt), "%Y-%m-%d %H:%M:%S", &tm);
+        char iso[32];
+        std::strftime(iso, sizeof(iso), "%Y-%m-%dT%H:%M:%S", &tm);
+        std::string expected = fmt::format("{}|{}{}|{}.{:03}{}|{}.{:06}{}|{}.{:09}{}|{}",
+                                           dt, iso, zcase.offset_str,
+                                           iso, ns / 1000000, zcase.offset_str,
+                                           iso, ns / 1000, zcase.offset_str,
+                                           iso, ns, zcase.offset_str, zcase.offset_str);
+
+        pattern_formatter f(pattern, "");
+        f.set_time_zone(zcase.zone);
+        REQUIRE(f.get_time_zone() == zcase.zone);
+        base::log_msg msg(tp, source_loc{}, level::info, "message", "");
+        fmt_memory_buf buf;
+        f.format(msg, buf);
+        REQUIRE(std::string(buf.data(), buf.size()) == expected);
+
+        auto cloned = f.clone();
+        fmt_memory_buf cloned_buf;
+        cloned->format(msg, cloned_buf);
+        REQUIRE(std::string(cloned_buf.data(), cloned_buf.size()) == expected);
+        REQUIRE(cloned->fingerprint() == f.fingerprint());
+
+        static_pattern_formatter<static_pattern_iso> static_formatter;
+        pattern_formatter dynamic_formatter(static_pattern_iso::value());
+        static_formatter.set_time_zone(zcase.zone);
+        dynamic_formatter.set_time_zone(zcase.zone);
+        fmt_memory_buf static_buf;
+        fmt_memory_buf dynamic_buf;
+        static_formatter.format(msg, static_buf);
+        dynamic_formatter.format(msg, dynamic_buf);
+        REQUIRE(std::string(static_buf.data(), static_buf.size()) ==
+                std::string(dynamic_buf.data(), dynamic_buf.size()));
+        REQUIRE(static_formatter.fingerprint() == dynamic_formatter.fingerprint());
+
+        fingerprints.push_back(f.fingerprint());
+    }
+
+    // 不同时区的输出不同，指纹也不同
+    fingerprints.push_back(pattern_formatter(pattern, "").fingerprint());
+    std::sort(fingerprints.begin(), fingerprints.end());
+    REQUIRE(std::unique(fingerprints.begin(), fingerprints.end()) == fingerprints.end());
+
+    // 本地时间的 %z 与 tm_gmtoff 一致
+    pattern_formatter local("%z", "");
+    base::log_msg msg(tp, source_loc{}, level::info, "message", "");
+    fmt_memory_buf buf;
+    local.format(msg, buf);
+    long offset = base::os::utc_offset_secs(base::os::time_point_to_tm(tp), tt);
+    REQUIRE(std::string(buf.data(), buf.size()) ==
+            fmt::format("{}{:02}:{:02}", offset < 0 ? '-' : '+',
+                        std::labs(offset) / 3600, std::labs(offset) % 3600 / 60));
+
+    // json_formatter 在 UTC 下以 "Z" 结尾
+    json_formatter json;
+    json.set_time_zone(time_zone::utc());
+    buf.clear();
+    json.format(msg, buf);
+    std::tm tm = reference_gmtime(tt);
+    char iso[32];
+    std::strftime(iso, sizeof(iso), "%Y-%m-%dT%H:%M:%S", &tm);
+    REQUIRE(std::string(buf.data(), buf.size()).find(fmt::format("{{\"time\":\"{}.{:06}Z\"", iso, ns / 1000)) == 0);
+    REQUIRE(json.fingerprint() != json_formatter().fingerprint());
+}
+
 TEST_CASE("pattern_stdout", "[pattern_formatter]") {
     std::cout << get_format_str("==== pattern formatter tests ====", "%=64v");
     std::cout << get_format_str("0", "pattern='': ");
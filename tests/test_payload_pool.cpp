@@ -0,0 +1,103 @@
+#include <catch2/catch_all.hpp>
+#include "base/payload_pool.h"
+#include "base/async_msg.h"
+
+#include <thread>
+
+using learnlog::base::payload_pool;
+using learnlog::base::payload_allocator;
+
+TEST_CASE("reuse_block_in_same_class", "[payload_pool]") {
+    payload_pool pool;
+
+    char* p1 = pool.allocate(300);
+    REQUIRE(pool.miss_count() == 1);
+    pool.deallocate(p1, 300);
+
+    // 300 与 500 同属 512 字节等级，复用同一内存块
+    char* p2 = pool.allocate(500);
+    REQUIRE(p2 == p1);
+    REQUIRE(pool.hit_count() == 1);
+
+    // 600 属于 1024 字节等级，需要重新申请
+    char* p3 = pool.allocate(600);
+    REQUIRE(p3 != p1);
+    REQUIRE(pool.miss_count() == 2);
+    pool.deallocate(p2, 500);
+    pool.deallocate(p3, 600);
+
+    pool.reset_counts();
+    REQUIRE(pool.hit_count() == 0);
+    REQUIRE(pool.miss_count() == 0);
+}
+
+TEST_CASE("oversized_block", "[payload_pool]") {
+    payload_pool pool;
+    size_t n = payload_pool::max_class_size + 1;
+
+    char* p1 = pool.allocate(n);
+    p1[n - 1] = 'x';
+    pool.deallocate(p1, n);
+    char* p2 = pool.allocate(n);
+    pool.deallocate(p2, n);
+
+    REQUIRE(pool.hit_count() == 0);
+    REQUIRE(pool.miss_count() == 2);
+}
+
+TEST_CASE("recycle_across_threads", "[payload_pool]") {
+    payload_pool pool;
+    size_t block_num = 64;
+    std::vector<char*> blocks;
+
+    // 生产者申请，另一个线程归还，生产者再次申请时全部命中
+    for (size_t i = 0; i < block_num; i++) {
+        blocks.push_back(pool.allocate(1025 + i));
+    }
+    std::thread consumer([&pool, &blocks] {
+        for (size_t i = 0; i < blocks.size(); i++) {
+            pool.deallocate(blocks[i], 1025 + i);
+        }
+    });
+    consumer.join();
+
+    for (size_t i = 0; i < block_num; i++) {
+        blocks[i] = pool.allocate(2048);
+    }
+    REQUIRE(pool.hit_count() == block_num);
+    REQUIRE(pool.miss_count() == block_num);
+    for (auto p : blocks) {
+        pool.deallocate(p, 2048);
+    }
+}
+
+TEST_CASE("async_msg_payload", "[payload_pool]") {
+    payload_pool pool;
+    std::string long_msg(1000, 'a');
+    std::string short_msg(10, 'b');
+
+    {
+        learnlog::base::log_msg msg(learnlog::level::info, long_msg, "logger");
+        learnlog::base::async_msg amsg(0, learnlog::base::async_msg_type::log, msg,
+                                       payload_allocator(&pool));
+        learnlog::base::async_msg moved;
+        moved = std::move(amsg);
+        REQUIRE(std::string(moved.msg.data(), moved.msg.size()) == long_msg);
+        REQUIRE(std::string(moved.logger_name.data(), moved.logger_name.size()) == "logger");
+    }
+    {
+        learnlog::base::log_msg msg(learnlog::level::info, short_msg, "logger");
+        learnlog::base::async_msg amsg(0, learnlog::base::async_msg_type::log, msg,
+                                       payload_allocator(&pool));
+        REQUIRE(std::string(amsg.msg.data(), amsg.msg.size()) == short_msg);
+    }
+    {
+        learnlog::base::log_msg msg(learnlog::level::info, long_msg, "logger");
+        learnlog::base::async_msg amsg(0, learnlog::base::async_msg_type::log, msg,
+                                       payload_allocator(&pool));
+    }
+
+    // 内联缓冲区能放下的消息不经过内存池
+    REQUIRE(pool.miss_count() == 1);
+    REQUIRE(pool.hit_count() == 1);
+}
@@ -53,5 +53,73 @@ private:
 using test_sink_mt = test_sink<std::mutex>;
 using test_sink_st = test_sink<base::null_mutex>;
 
+// 支持直接输出 logger 已格式化好的日志消息，记录每条消息及其颜色区间内的文字
+template <typename Mutex>
+class formatted_test_sink : public basic_sink<Mutex> {
+public:
+    formatted_test_sink() { basic_sink<Mutex>::enable_formatted_output_(); }
+
+    std::vector<std::string> msgs() {
+        std::lock_guard<Mutex> lock(basic_sink<Mutex>::mutex_);
+        return log_msgs_;
+    }
+
+    std::vector<std::string> colored() {
+        std::lock_guard<Mutex> lock(basic_sink<Mutex>::mutex_);
+        return colored_;
+    }
+
+private:
+    void output_(const base::log_msg &msg) override {
+        msg.color_index_start = 0;
+        msg.color_index_end = 0;
+        fmt_memory_buf buf;
+        basic_sink<Mutex>::formatter_->format(msg, buf);
+        output_formatted_(msg, fmt_string_view(buf.data(), buf.size()));
+    }
+
+    void output_formatted_(const base::log_msg &msg, fmt_string_view formatted) override {
+        log_msgs_.emplace_back(formatted.data(), formatted.size());
+        colored_.emplace_back(formatted.data() + msg.color_index_start,
+                              msg.color_index_end - msg.color_index_start);
+    }
+
+    void flush_() override {}
+
+    std::vector<std::string> log_msgs_;
+    std::vector<std::string> colored_;
+};
+
+using formatted_test_sink_mt = formatted_test_sink<std::mutex>;
+using formatted_test_sink_st = formatted_test_sink<base::null_mutex>;
+
+// 在 pattern_formatter 的输出前加上前缀，不共享格式化结果
+class prefix_formatter : public pattern_formatter {
+public:
+    explicit prefix_formatter(std::string pattern) : pattern_formatter(std::move(pattern)) {}
+
+    void format(const base::log_msg& msg, fmt_memory_buf& dest_buf) override {
+        base::fmt_base::append_string_view("PREFIX ", dest_buf);
+        pattern_formatter::format(msg, dest_buf);
+    }
+};
+
+// 记录 format() 调用次数的 pattern_formatter，输出不变，与同一模板的 pattern_formatter 共享格式化结果
+class counting_formatter : public pattern_formatter {
+public:
+    counting_formatter(std::string pattern, std::atomic<size_t>* counter)
+        : pattern_formatter(std::move(pattern)), counter_(counter) {}
+
+    void format(const base::log_msg& msg, fmt_memory_buf& dest_buf) override {
+        counter_->fetch_add(1, std::memory_order_relaxed);
+        pattern_formatter::format(msg, dest_buf);
+    }
+
+    size_t fingerprint() const override { return pattern_fingerprint_(); }
+
+private:
+    std::atomic<size_t>* counter_;
+};
+
 }   // namespace sinks
 }   // namespace learnlog
\ No newline at end of file
@@ -8,16 +8,30 @@
 #include "sinks/std_color_sinks.h"
 #include "sinks/basic_file_sink.h"
 #include "sinks/rolling_file_sink.h"
+#include "sinks/time_rolling_file_sink.h"
+#ifndef _WIN32
+    #include "sinks/mmap_file_sink.h"
+    #include "sinks/aio_file_sink.h"
+    #include "async_logger.h"
+    #include "base/lockfree_thread_pool.h"
+#endif
 #include "base/static_mutex.h"
+#include "test_sink.h"
 
 #include <functional>
 
 #ifdef _WIN32
     #define B_FNAME L"test_tmp/basic_file_sink_test.txt"
     #define R_FNAME L"test_tmp/rolling_file_sink_test.txt"
+    #define T_FNAME L"test_tmp/time_rolling_%Y%m%d_%H.txt"
+    #define TF_FNAME L"test_tmp/time_rolling_fixed.txt"
 #else
     #define B_FNAME "test_tmp/basic_file_sink_test.txt"
     #define R_FNAME "test_tmp/rolling_file_sink_test.txt"
+    #define T_FNAME "test_tmp/time_rolling_%Y%m%d_%H.txt"
+    #define TF_FNAME "test_tmp/time_rolling_fixed.txt"
+    #define M_FNAME "test_tmp/mmap_file_sink_test.txt"
+    #define A_FNAME "test_tmp/aio_file_sink_test.txt"
 #endif
 
 using learnlog::filename_t;
@@ -118,6 +132,219 @@ TEST_CASE("basic_file_sink", "[sinks]") {
                         DEFAULT_EOL, DEFAULT_EOL, DEFAULT_EOL));
 }
 
+TEST_CASE("basic_file_sink_batch", "[sinks]") {
+    clean_test_tmp();
+    auto file_sink = std::make_shared<learnlog::sinks::basic_file_sink_st>(B_FNAME, true);
+    file_sink->set_pattern("[%l] %v");
+
+    learnlog::base::log_msg msg1(learnlog::level::info, "hello", "batch");
+    learnlog::base::log_msg msg2(learnlog::level::warn, "world", "batch");
+    const learnlog::base::log_msg* msgs[] = {&msg1, &msg2};
+    file_sink->log_batch(msgs, 2);
+    file_sink->flush();
+
+    REQUIRE(file_content(B_FNAME) == 
+            fmt::format("[info] hello{}[warn] world{}", DEFAULT_EOL, DEFAULT_EOL));
+}
+
+TEST_CASE("basic_file_sink_buffered", "[sinks]") {
+    clean_test_tmp();
+    learnlog::base::file_buffer_options opts;
+    opts.buffer_size = 64;
+    {
+        auto file_sink = std::make_shared<learnlog::sinks::basic_file_sink_st>(B_FNAME, true, opts);
+        learnlog::logger file_logger("buffered file sink test logger", file_sink);
+        file_logger.set_pattern("[%l] %v");
+
+        file_logger.info("hello");
+        REQUIRE(get_filesize(B_FNAME) == 0);
+        file_logger.flush();
+        REQUIRE(file_content(B_FNAME) == fmt::format("[info] hello{}", DEFAULT_EOL));
+
+        // 超过缓冲区容量的消息与缓冲区中的消息按顺序写入
+        file_logger.warn("world");
+        file_logger.info(std::string(100, 'a'));
+        REQUIRE(file_content(B_FNAME) == 
+                fmt::format("[info] hello{0}[warn] world{0}[info] {1}{0}", 
+                            DEFAULT_EOL, std::string(100, 'a')));
+        file_logger.error("bye");
+    }
+    // 析构时写出缓冲区
+    std::ifstream ifs(B_FNAME);
+    REQUIRE(count_lines(ifs) == 4);
+
+    auto file_logger = learnlog::basic_file_logger_mt("buffered_file_logger", B_FNAME, true, opts);
+    file_logger->info("factory");
+    file_logger->flush();
+    REQUIRE(file_content(B_FNAME).find("factory") != std::string::npos);
+    learnlog::base::registry::instance().remove_logger("buffered_file_logger");
+
+    // _mt 版本定时写出缓冲区，之后没有新的写入也会写入文件
+    opts.flush_interval = std::chrono::milliseconds(20);
+    auto timed_sink = std::make_shared<learnlog::sinks::basic_file_sink_mt>(B_FNAME, true, opts);
+    learnlog::logger timed_logger("timed buffered file sink test logger", timed_sink);
+    timed_logger.set_pattern("[%l] %v");
+    timed_logger.info("timed");
+    for (int i = 0; i < 100 && get_filesize(B_FNAME) == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    REQUIRE(file_content(B_FNAME) == fmt::format("[info] timed{}", DEFAULT_EOL));
+}
+
+#ifndef _WIN32
+TEST_CASE("mmap_file_sink", "[sinks]") {
+    clean_test_tmp();
+    std::string expected;
+    {
+        // 以最小的块（一页）写入，日志跨越多个块
+        auto mmap_sink = std::make_shared<learnlog::sinks::mmap_file_sink_st>(M_FNAME, true, 1);
+        learnlog::logger mmap_logger("mmap file sink test logger", mmap_sink);
+        mmap_logger.set_pattern("[%l] %v");
+        for (size_t i = 0; i < 500; ++i) {
+            mmap_logger.info("mmap line {}", i);
+            expected += fmt::format("[info] mmap line {}{}", i, DEFAULT_EOL);
+        }
+        mmap_logger.info(std::string(10000, 'a'));
+        expected += fmt::format("[info] {}{}", std::string(10000, 'a'), DEFAULT_EOL);
+
+        // 运行期间文件包含预分配的部分，已写入的内容可以直接读到
+        REQUIRE(mmap_sink->size() == expected.size());
+        REQUIRE(get_filesize(M_FNAME) >= expected.size());
+        REQUIRE(file_content(M_FNAME).compare(0, expected.size(), expected) == 0);
+        mmap_sink->sync();
+    }
+    // 析构时截断为实际写入的长度
+    REQUIRE(file_content(M_FNAME) == expected);
+
+    // 追加写入时跳过上次未正常关闭时遗留的 '\0'
+    {
+        std::ofstream ofs(M_FNAME, std::ios_base::binary | std::ios_base::app);
+        ofs << std::string(5000, '\0');
+    }
+    {
+        auto mmap_logger = learnlog::mmap_file_logger_st("mmap_file_logger", M_FNAME);
+        mmap_logger->info("appended");
+        learnlog::base::registry::instance().remove_logger("mmap_file_logger");
+    }
+    std::string content = file_content(M_FNAME);
+    REQUIRE(content.size() > expected.size());
+    REQUIRE(content.compare(0, expected.size(), expected) == 0);
+    REQUIRE(content.find('\0') == std::string::npos);
+    REQUIRE(content.find("appended") != std::string::npos);
+}
+
+TEST_CASE("mmap_file_sink_mt", "[sinks]") {
+    clean_test_tmp();
+    size_t thread_num = 8;
+    size_t msg_num = 2000;
+    {
+        auto mmap_sink = std::make_shared<learnlog::sinks::mmap_file_sink_mt>(M_FNAME, true, 4096);
+        learnlog::logger mmap_logger("mmap file sink mt test logger", mmap_sink);
+        mmap_logger.set_pattern("%t %v");
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < thread_num; ++t) {
+            threads.emplace_back([&mmap_logger, msg_num]() {
+                for (size_t i = 0; i < msg_num; ++i) {
+                    mmap_logger.info("line {}", i);
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+    std::ifstream ifs(M_FNAME, std::ios_base::binary);
+    REQUIRE(count_lines(ifs) == thread_num * msg_num);
+}
+
+TEST_CASE("aio_file_sink", "[sinks]") {
+    for (bool use_io_uring : {true, false}) {
+        clean_test_tmp();
+        learnlog::base::aio_file_options opts;
+        opts.buffer_size = 4096;
+        opts.buffer_count = 3;
+        opts.use_io_uring = use_io_uring;
+        std::string expected;
+        {
+            auto aio_sink = std::make_shared<learnlog::sinks::aio_file_sink_st>(A_FNAME, true, opts);
+            learnlog::logger aio_logger("aio file sink test logger", aio_sink);
+            aio_logger.set_pattern("[%l] %v");
+            for (size_t i = 0; i < 1000; ++i) {
+                aio_logger.info("aio line {}", i);
+                expected += fmt::format("[info] aio line {}{}", i, DEFAULT_EOL);
+            }
+            aio_logger.info(std::string(10000, 'a'));
+            expected += fmt::format("[info] {}{}", std::string(10000, 'a'), DEFAULT_EOL);
+            REQUIRE(aio_sink->size() == expected.size());
+
+            // flush() 只提交，drain() 后日志都已写入文件
+            aio_logger.flush();
+            aio_sink->drain();
+            REQUIRE(file_content(A_FNAME) == expected);
+            aio_logger.info("last line");
+            expected += fmt::format("[info] last line{}", DEFAULT_EOL);
+        }
+        // 析构时等待全部写入完成
+        REQUIRE(file_content(A_FNAME) == expected);
+    }
+
+    {
+        auto aio_logger = learnlog::aio_file_logger_st("aio_file_logger", A_FNAME);
+        aio_logger->info("appended");
+        learnlog::base::registry::instance().remove_logger("aio_file_logger");
+    }
+    REQUIRE(file_content(A_FNAME).find("appended") != std::string::npos);
+}
+
+// 写入错误延迟到析构时才发现，析构函数只输出异常信息，不终止进程
+TEST_CASE("aio_file_sink_write_error", "[sinks]") {
+    if (!learnlog::base::os::dir_exist("/dev/full")) {
+        return;
+    }
+    for (bool use_io_uring : {true, false}) {
+        learnlog::base::aio_file_options opts;
+        opts.use_io_uring = use_io_uring;
+        REQUIRE_NOTHROW([&opts] {
+            auto aio_sink = std::make_shared<learnlog::sinks::aio_file_sink_st>("/dev/full", false, opts);
+            learnlog::logger aio_logger("aio file sink error test logger", aio_sink);
+            aio_logger.info("lost line");
+        }());
+    }
+}
+
+TEST_CASE("aio_file_sink_async", "[sinks]") {
+    clean_test_tmp();
+    size_t thread_num = 4;
+    size_t msg_num = 5000;
+    {
+        // 异步 logger 的后台线程只把日志复制到缓冲区并提交，不等待磁盘
+        learnlog::base::aio_file_options opts;
+        opts.buffer_size = 16 * 1024;
+        auto aio_sink = std::make_shared<learnlog::sinks::aio_file_sink_mt>(A_FNAME, true, opts);
+        auto tp = std::make_shared<learnlog::base::lockfree_thread_pool>(1024, 1);
+        auto aio_logger = std::make_shared<learnlog::async_logger>("aio async logger", aio_sink, tp);
+        aio_logger->set_pattern("%t %v");
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < thread_num; ++t) {
+            threads.emplace_back([&aio_logger, msg_num]() {
+                for (size_t i = 0; i < msg_num; ++i) {
+                    aio_logger->info("line {}", i);
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        aio_logger->flush();
+    }
+    // logger、线程池与 sink 依次析构后，全部日志已写入文件
+    std::ifstream ifs(A_FNAME, std::ios_base::binary);
+    REQUIRE(count_lines(ifs) == thread_num * msg_num);
+}
+#endif
+
 TEST_CASE("rolling_file_sink", "[sinks]") {
     std::string txt = "hello world!";
     size_t file_size = 32;
@@ -151,6 +378,251 @@ TEST_CASE("rolling_file_sink", "[sinks]") {
     REQUIRE(file_content(roll_sink->get_rolling_filename(3)) == expected_3);
 }
 
+TEST_CASE("rolling_file_sink_background", "[sinks]") {
+    clean_test_tmp();
+    size_t file_size = 64;
+    size_t file_num = 3;
+    std::string line = fmt::format("line 00{}", DEFAULT_EOL);
+    size_t lines_per_file = file_size / line.size();
+    learnlog::filename_t last_fname;
+    {
+        auto roll_sink = std::make_shared<learnlog::sinks::rolling_file_sink_mt>(R_FNAME,
+                                                                                 file_size,
+                                                                                 file_num);
+        learnlog::logger roll_logger("rolling file sink background test logger", roll_sink);
+        roll_logger.set_pattern("%v");
+
+        // 写满 file_num 个文件后，最后一个文件被重新写入
+        size_t msg_num = lines_per_file * (file_num + 1) - 1;
+        for (size_t i = 0; i < msg_num; ++i) {
+            roll_logger.info("line {:02d}", i);
+        }
+        roll_logger.flush();
+
+        for (size_t f = 1; f < file_num; ++f) {
+            std::string expected;
+            for (size_t i = (f - 1) * lines_per_file; i < f * lines_per_file; ++i) {
+                expected += fmt::format("line {:02d}{}", i, DEFAULT_EOL);
+            }
+            REQUIRE(file_content(roll_sink->get_rolling_filename(f)) == expected);
+        }
+        std::string expected_last;
+        for (size_t i = file_num * lines_per_file; i < msg_num; ++i) {
+            expected_last += fmt::format("line {:02d}{}", i, DEFAULT_EOL);
+        }
+        last_fname = roll_sink->get_rolling_filename(file_num);
+        REQUIRE(file_content(last_fname) == expected_last);
+    }
+
+    // 析构时删除后台线程准备好、未使用的临时文件
+#ifdef _WIN32
+    REQUIRE_FALSE(learnlog::base::os::dir_exist(last_fname + L".tmp"));
+#else
+    REQUIRE_FALSE(learnlog::base::os::dir_exist(last_fname + ".tmp"));
+#endif
+    REQUIRE(learnlog::base::os::dir_exist(last_fname));
+}
+
+// 后台线程还没有准备好下一个文件时析构（刚创建、刚滚动），析构函数不等待后台线程
+TEST_CASE("rolling_file_sink_destroy", "[sinks]") {
+    clean_test_tmp();
+    for (size_t i = 0; i < 20; ++i) {
+        learnlog::sinks::rolling_file_sink_mt roll_sink(R_FNAME, 1024, 3);
+    }
+    learnlog::filename_t first_fname;
+    for (size_t i = 0; i < 20; ++i) {
+        auto roll_sink = std::make_shared<learnlog::sinks::rolling_file_sink_mt>(R_FNAME, 16, 3);
+        first_fname = roll_sink->get_rolling_filename(1);
+        learnlog::logger roll_logger("rolling file sink destroy test logger", roll_sink);
+        roll_logger.set_pattern("%v");
+        roll_logger.info("first line {:02d}", i);
+        roll_logger.info("rolled line {:02d}", i);
+    }
+    REQUIRE(learnlog::base::os::dir_exist(first_fname));
+}
+
+// 两天后本地时间 10:30 对应的时间点，晚于 sink 创建时算出的下一次滚动时刻
+static learnlog::sys_clock::time_point future_local_tp() {
+    std::tm tm = learnlog::base::os::time_point_to_tm(learnlog::sys_clock::now());
+    tm.tm_mday += 2;
+    tm.tm_hour = 10;
+    tm.tm_min = 30;
+    tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+    return learnlog::sys_clock::from_time_t(std::mktime(&tm));
+}
+
+TEST_CASE("time_rolling_file_sink", "[sinks]") {
+    using std::chrono::minutes;
+    using learnlog::base::os::time_point_to_tm;
+    clean_test_tmp();
+
+    auto tp = future_local_tp();
+    std::tm tm = time_point_to_tm(tp);
+    auto time_sink = std::make_shared<learnlog::sinks::time_rolling_file_sink_st>(
+        T_FNAME, learnlog::sinks::rolling_period::hourly);
+    std::tm fixed_tm{};
+    fixed_tm.tm_year = 2024 - 1900;
+    fixed_tm.tm_mon = 2;
+    fixed_tm.tm_mday = 4;
+    fixed_tm.tm_hour = 5;
+#ifdef _WIN32
+    REQUIRE(time_sink->calc_filename(fixed_tm) == L"test_tmp/time_rolling_20240304_05.txt");
+#else
+    REQUIRE(time_sink->calc_filename(fixed_tm) == "test_tmp/time_rolling_20240304_05.txt");
+#endif
+    learnlog::logger time_logger("time rolling file sink test logger", time_sink);
+    time_logger.set_pattern("%v");
+
+    learnlog::source_loc loc{};
+    time_logger.log(tp, loc, learnlog::level::info, "a");
+    time_logger.log(tp + minutes(20), loc, learnlog::level::info, "b");
+    time_logger.log(tp + minutes(40), loc, learnlog::level::info, "c");
+    time_logger.log(tp + minutes(60 * 24), loc, learnlog::level::info, "d");
+    time_logger.flush();
+
+    REQUIRE(file_content(time_sink->calc_filename(tm)) ==
+            fmt::format("a{}b{}", DEFAULT_EOL, DEFAULT_EOL));
+    REQUIRE(file_content(time_sink->calc_filename(time_point_to_tm(tp + minutes(40)))) ==
+            fmt::format("c{}", DEFAULT_EOL));
+    REQUIRE(time_sink->filename() == time_sink->calc_filename(time_point_to_tm(tp + minutes(60 * 24))));
+    REQUIRE(file_content(time_sink->filename()) == fmt::format("d{}", DEFAULT_EOL));
+}
+
+TEST_CASE("time_rolling_file_sink_max_files", "[sinks]") {
+    using std::chrono::hours;
+    using learnlog::base::os::time_point_to_tm;
+    clean_test_tmp();
+
+    size_t max_files = 2;
+    auto tp = future_local_tp();
+    auto time_sink = std::make_shared<learnlog::sinks::time_rolling_file_sink_st>(
+        T_FNAME, learnlog::sinks::rolling_period::hourly, max_files);
+    filename_t first_fname = time_sink->filename();
+    learnlog::logger time_logger("time rolling file sink max files test logger", time_sink);
+    time_logger.set_pattern("%v");
+
+    learnlog::source_loc loc{};
+    for (int i = 0; i < 3; ++i) {
+        time_logger.log(tp + hours(i), loc, learnlog::level::info, "x");
+    }
+    time_logger.flush();
+
+    // 只保留最近的 max_files 个文件
+    REQUIRE_FALSE(learnlog::base::os::dir_exist(first_fname));
+    REQUIRE_FALSE(learnlog::base::os::dir_exist(time_sink->calc_filename(time_point_to_tm(tp))));
+    REQUIRE(learnlog::base::os::dir_exist(time_sink->calc_filename(time_point_to_tm(tp + hours(1)))));
+    REQUIRE(learnlog::base::os::dir_exist(time_sink->filename()));
+}
+
+// 启动时跳过缺失的周期，停止运行前留下的旧文件仍会被删除
+TEST_CASE("time_rolling_file_sink_max_files_gap", "[sinks]") {
+    using std::chrono::hours;
+    using learnlog::base::os::time_point_to_tm;
+    clean_test_tmp();
+
+    size_t max_files = 2;
+    auto tp = future_local_tp();
+    auto now = learnlog::sys_clock::now();
+    auto time_sink = std::make_shared<learnlog::sinks::time_rolling_file_sink_st>(
+        T_FNAME, learnlog::sinks::rolling_period::hourly);
+    filename_t old_fname = time_sink->calc_filename(time_point_to_tm(now - hours(3)));
+    FILE* fp = nullptr;
+    learnlog::base::file_base::open(&fp, old_fname);
+    learnlog::base::file_base::close(&fp, old_fname);
+    time_sink.reset();
+
+    time_sink = std::make_shared<learnlog::sinks::time_rolling_file_sink_st>(
+        T_FNAME, learnlog::sinks::rolling_period::hourly, max_files);
+    learnlog::logger time_logger("time rolling file sink gap test logger", time_sink);
+    time_logger.set_pattern("%v");
+    time_logger.log(tp, learnlog::source_loc{}, learnlog::level::info, "x");
+    time_logger.flush();
+
+    REQUIRE_FALSE(learnlog::base::os::dir_exist(old_fname));
+    REQUIRE(learnlog::base::os::dir_exist(time_sink->filename()));
+}
+
+// 模板中不包含时间字段时，滚动不会用 truncate 清空正在写入的文件
+TEST_CASE("time_rolling_file_sink_fixed_name_truncate", "[sinks]") {
+    using std::chrono::hours;
+    clean_test_tmp();
+
+    auto tp = future_local_tp();
+    auto time_sink = std::make_shared<learnlog::sinks::time_rolling_file_sink_st>(
+        TF_FNAME, learnlog::sinks::rolling_period::hourly, 0, true);
+    learnlog::logger time_logger("time rolling file sink truncate test logger", time_sink);
+    time_logger.set_pattern("%v");
+
+    learnlog::source_loc loc{};
+    time_logger.log(tp, loc, learnlog::level::info, "a");
+    time_logger.log(tp + hours(1), loc, learnlog::level::info, "b");
+    time_logger.log(tp + hours(24), loc, learnlog::level::info, "c");
+    time_logger.flush();
+
+    REQUIRE(time_sink->filename() == TF_FNAME);
+    REQUIRE(file_content(TF_FNAME) == fmt::format("a{}b{}c{}", DEFAULT_EOL, DEFAULT_EOL, DEFAULT_EOL));
+}
+
+// formatter 指纹相同的 sink 共享格式化结果，每条消息只格式化一次，颜色区间保持正确
+TEST_CASE("shared_formatting", "[sinks]") {
+    using namespace learnlog::sinks;
+    std::atomic<size_t> format_cnt{0};
+    std::ostringstream oss;
+    auto sink1 = std::make_shared<formatted_test_sink_st>();
+    auto sink2 = std::make_shared<formatted_test_sink_st>();
+    auto sink3 = std::make_shared<ostream_sink_st>(oss);
+    sink2->set_level(learnlog::level::warn);
+    for (auto sink : std::vector<learnlog::sink_shr_ptr>{sink1, sink2, sink3}) {
+        sink->set_formatter(learnlog::make_unique<counting_formatter>("[%^%l%$] %v", &format_cnt));
+    }
+    REQUIRE(sink1->formatter_fingerprint() != 0);
+    REQUIRE(sink1->formatter_fingerprint() == sink3->formatter_fingerprint());
+
+    learnlog::logger shared_logger("shared formatting test logger", {sink1, sink2, sink3});
+    shared_logger.set_log_level(learnlog::level::trace);
+    shared_logger.info("hello");
+    shared_logger.warn("world");
+    REQUIRE(format_cnt == 2);
+
+    std::string info_msg = fmt::format("[info] hello{}", DEFAULT_EOL);
+    std::string warn_msg = fmt::format("[warn] world{}", DEFAULT_EOL);
+    REQUIRE(sink1->msgs() == std::vector<std::string>{info_msg, warn_msg});
+    REQUIRE(sink1->colored() == std::vector<std::string>{"info", "warn"});
+    REQUIRE(sink2->msgs() == std::vector<std::string>{warn_msg});
+    REQUIRE(sink2->colored() == std::vector<std::string>{"warn"});
+    REQUIRE(oss.str() == info_msg + warn_msg);
+
+    // 模板不同或含有时间间隔时不共享
+    sink3->set_pattern("%v");
+    shared_logger.info("a");
+    REQUIRE(format_cnt == 3);
+    REQUIRE(oss.str() == info_msg + warn_msg + fmt::format("a{}", DEFAULT_EOL));
+    sink1->set_pattern("%X %v");
+    sink2->set_pattern("%X %v");
+    REQUIRE(sink1->formatter_fingerprint() == 0);
+
+    // 覆写 format() 的派生类不与 pattern_formatter 共享格式化结果
+    std::ostringstream prefix_oss;
+    std::ostringstream plain_oss;
+    auto prefix_sink = std::make_shared<ostream_sink_st>(prefix_oss);
+    auto plain_sink = std::make_shared<ostream_sink_st>(plain_oss);
+    prefix_sink->set_formatter(learnlog::make_unique<prefix_formatter>("%v"));
+    plain_sink->set_formatter(learnlog::make_unique<learnlog::sinks::pattern_formatter>("%v"));
+    REQUIRE(prefix_sink->formatter_fingerprint() == 0);
+    learnlog::logger prefix_logger("prefix formatter test logger", {plain_sink, prefix_sink});
+    prefix_logger.info("hello");
+    REQUIRE(plain_oss.str() == fmt::format("hello{}", DEFAULT_EOL));
+    REQUIRE(prefix_oss.str() == fmt::format("PREFIX hello{}", DEFAULT_EOL));
+
+    // 指纹由完整的格式配置决定，不同模板的指纹一定不同
+    learnlog::sinks::pattern_formatter f1("%v");
+    learnlog::sinks::pattern_formatter f2("%v");
+    learnlog::sinks::pattern_formatter f3("%v ");
+    REQUIRE(f1.fingerprint() == f2.fingerprint());
+    REQUIRE(f1.fingerprint() != f3.fingerprint());
+}
+
 TEST_CASE("multithread", "[sinks]") {
     clean_test_tmp();
     size_t roll_size = 1024;
@@ -0,0 +1,93 @@
+#include <catch2/catch_all.hpp>
+#include "base/spsc_queue.h"
+
+#include <thread>
+#include <vector>
+
+using q_type = learnlog::base::spsc_queue<size_t>;
+
+TEST_CASE("capacity_round_up", "[spsc_queue]") {
+    q_type q1(1);
+    q_type q2(100);
+    q_type q3(128);
+
+    REQUIRE(q1.capacity() == 2);
+    REQUIRE(q2.capacity() == 128);
+    REQUIRE(q3.capacity() == 128);
+}
+
+TEST_CASE("full_enqueue_empty_dequeue", "[spsc_queue]") {
+    q_type q(8);
+    size_t items[8] = {0};
+
+    REQUIRE(q.try_dequeue_bulk(items, 8) == 0);
+    for (size_t i = 0; i < 8; i++) {
+        REQUIRE(q.try_enqueue(std::move(i)));
+    }
+    size_t extra = 8;
+    REQUIRE_FALSE(q.try_enqueue(std::move(extra)));
+    REQUIRE(q.size_approx() == 8);
+
+    REQUIRE(q.try_dequeue_bulk(items, 3) == 3);
+    REQUIRE(items[0] == 0);
+    REQUIRE(items[2] == 2);
+    REQUIRE(q.try_dequeue_bulk(items, 8) == 5);
+    REQUIRE(items[0] == 3);
+    REQUIRE(items[4] == 7);
+    REQUIRE(q.empty());
+}
+
+TEST_CASE("wrap_around", "[spsc_queue]") {
+    q_type q(4);
+    size_t items[4] = {0};
+    size_t expected = 0;
+
+    for (size_t i = 0; i < 100; i++) {
+        size_t item = i;
+        REQUIRE(q.try_enqueue(std::move(item)));
+        if (i % 3 == 2) {
+            size_t cnt = q.try_dequeue_bulk(items, 4);
+            for (size_t j = 0; j < cnt; j++) {
+                REQUIRE(items[j] == expected++);
+            }
+        }
+    }
+    size_t cnt = q.try_dequeue_bulk(items, 4);
+    for (size_t j = 0; j < cnt; j++) {
+        REQUIRE(items[j] == expected++);
+    }
+    REQUIRE(expected == 100);
+}
+
+TEST_CASE("producer_consumer_order", "[spsc_queue]") {
+    q_type q(64);
+    size_t item_num = 20000;
+    std::vector<size_t> received;
+    received.reserve(item_num);
+
+    std::thread consumer([&q, &received, item_num] {
+        size_t items[16];
+        while (received.size() < item_num) {
+            size_t cnt = q.try_dequeue_bulk(items, 16);
+            for (size_t i = 0; i < cnt; i++) {
+                received.push_back(items[i]);
+            }
+            if (cnt == 0) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    for (size_t i = 0; i < item_num; i++) {
+        size_t item = i;
+        while (!q.try_enqueue(std::move(item))) {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+
+    std::vector<size_t> expected(item_num);
+    for (size_t i = 0; i < item_num; i++) {
+        expected[i] = i;
+    }
+    REQUIRE(received == expected);
+}